@@ -0,0 +1,286 @@
+#include "analysis_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+
+namespace fs = std::filesystem;
+
+static const uint32_t kCacheMagic = 0x43414A44; // "DJAC" in memory order
+static const uint32_t kCacheVersion = 2;
+static const char* const kEntryExtension = ".djac";
+static const size_t kFingerprintSpan = 64 * 1024;
+
+static const uint32_t kHasBeatgrid = 1;
+static const uint32_t kHasKey = 2;
+static const uint32_t kHasGain = 4;
+
+// Entry file header, in native byte order (the cache never leaves the
+// machine). Waveform level i is levelCount[i] WaveformPoints at byte
+// levelOffset[i].
+struct CacheFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t fingerprint;
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t frameCount;
+    int32_t sampleRate;
+    uint32_t flags;
+    BeatGrid beatgrid;
+    KeyEstimate key;
+    TrackGain gain;
+    uint64_t waveformFrames;
+    uint64_t levelOffset[WaveformPyramid::kLevels];
+    uint64_t levelCount[WaveformPyramid::kLevels];
+};
+
+static_assert(sizeof(CacheFileHeader) % 8 == 0, "CacheFileHeader must pack to whole words");
+
+// 64-bit FNV-1a
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t length) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+AnalysisCache::AnalysisCache() : max_bytes_(0), known_bytes_(0), scanned_(false) {
+}
+
+void AnalysisCache::setDirectory(const std::string& directory, uint64_t maxBytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    directory_ = directory;
+    max_bytes_ = maxBytes;
+    scanned_ = false;
+}
+
+bool AnalysisCache::isEnabled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !directory_.empty();
+}
+
+std::string AnalysisCache::defaultDirectory() {
+#ifdef _WIN32
+    const char* base = std::getenv("LOCALAPPDATA");
+    if (!base || !*base) return "";
+    return (fs::path(base) / "DJAudioEngine" / "AnalysisCache").string();
+#else
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg) return (fs::path(xdg) / "dj-audio-engine" / "analysis").string();
+    const char* home = std::getenv("HOME");
+    if (!home || !*home) return "";
+    return (fs::path(home) / ".cache" / "dj-audio-engine" / "analysis").string();
+#endif
+}
+
+std::string AnalysisCache::entryPath(const std::string& directory, const CacheKey& key) const {
+    // Both in the name, so copies with different times keep their own entries
+    char name[48];
+    snprintf(name, sizeof(name), "%016llx-%016llx%s", static_cast<unsigned long long>(key.fingerprint),
+             static_cast<unsigned long long>(key.mtime), kEntryExtension);
+    return (fs::path(directory) / name).string();
+}
+
+bool AnalysisCache::makeKey(const std::string& filepath, CacheKey& key) const {
+    key = CacheKey();
+    std::error_code error;
+    uint64_t size = fs::file_size(filepath, error);
+    if (error) return false;
+    fs::file_time_type mtime = fs::last_write_time(filepath, error);
+    if (error) return false;
+
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file) return false;
+    std::vector<char> buffer(kFingerprintSpan);
+    uint64_t hash = hashBytes(0xCBF29CE484222325ull, &size, sizeof(size));
+
+    size_t head = static_cast<size_t>(std::min<uint64_t>(size, kFingerprintSpan));
+    file.read(buffer.data(), head);
+    hash = hashBytes(hash, buffer.data(), static_cast<size_t>(file.gcount()));
+    if (size > kFingerprintSpan) {
+        size_t tail = static_cast<size_t>(std::min<uint64_t>(size - kFingerprintSpan, kFingerprintSpan));
+        file.seekg(static_cast<std::streamoff>(size - tail));
+        file.read(buffer.data(), tail);
+        hash = hashBytes(hash, buffer.data(), static_cast<size_t>(file.gcount()));
+    }
+    if (file.bad()) return false;
+
+    key.fingerprint = hash;
+    key.size = size;
+    key.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+    key.valid = true;
+    return true;
+}
+
+bool AnalysisCache::lookup(const CacheKey& key, CachedAnalysis& analysis) {
+    std::string directory;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        directory = directory_;
+    }
+    if (directory.empty() || !key.valid) return false;
+
+    std::string path = entryPath(directory, key);
+    MappedFile mapping;
+    if (!mapping.open(path) || mapping.size() < sizeof(CacheFileHeader)) return false;
+
+    CacheFileHeader header;
+    memcpy(&header, mapping.data(), sizeof(header));
+    if (header.magic != kCacheMagic || header.version != kCacheVersion ||
+        header.fingerprint != key.fingerprint || header.sourceSize != key.size ||
+        header.sourceMtime != key.mtime) {
+        return false;
+    }
+
+    const WaveformPoint* levels[WaveformPyramid::kLevels];
+    size_t counts[WaveformPyramid::kLevels];
+    for (int level = 0; level < WaveformPyramid::kLevels; level++) {
+        uint64_t offset = header.levelOffset[level];
+        uint64_t count = header.levelCount[level];
+        if (offset > mapping.size() || count > (mapping.size() - offset) / sizeof(WaveformPoint)) return false;
+        levels[level] = reinterpret_cast<const WaveformPoint*>(mapping.data() + offset);
+        counts[level] = static_cast<size_t>(count);
+    }
+    std::shared_ptr<WaveformPyramid> waveform = std::make_shared<WaveformPyramid>();
+    waveform->restore(static_cast<size_t>(header.waveformFrames), levels, counts);
+
+    analysis.frameCount = header.frameCount;
+    analysis.sampleRate = header.sampleRate;
+    analysis.waveform = waveform;
+    analysis.beatgrid = header.beatgrid;
+    analysis.hasBeatgrid = (header.flags & kHasBeatgrid) != 0;
+    analysis.key = header.key;
+    analysis.hasKey = (header.flags & kHasKey) != 0;
+    analysis.gain = header.gain;
+    analysis.hasGain = (header.flags & kHasGain) != 0;
+
+    // Mark as recently used
+    std::error_code error;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+    return true;
+}
+
+bool AnalysisCache::store(const CacheKey& key, const CachedAnalysis& analysis) {
+    std::string directory;
+    uint64_t maxBytes = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        directory = directory_;
+        maxBytes = max_bytes_;
+    }
+    if (directory.empty() || !key.valid) return false;
+
+    std::error_code error;
+    fs::create_directories(directory, error);
+    if (error) return false;
+
+    CacheFileHeader header = {};
+    header.magic = kCacheMagic;
+    header.version = kCacheVersion;
+    header.fingerprint = key.fingerprint;
+    header.sourceSize = key.size;
+    header.sourceMtime = key.mtime;
+    header.frameCount = analysis.frameCount;
+    header.sampleRate = analysis.sampleRate;
+    header.flags = (analysis.hasBeatgrid ? kHasBeatgrid : 0) | (analysis.hasKey ? kHasKey : 0) |
+                   (analysis.hasGain ? kHasGain : 0);
+    header.beatgrid = analysis.beatgrid;
+    header.key = analysis.key;
+    header.gain = analysis.gain;
+
+    const WaveformPyramid* waveform = analysis.waveform.get();
+    uint64_t offset = sizeof(CacheFileHeader);
+    if (waveform) {
+        header.waveformFrames = waveform->frameCount();
+        for (int level = 0; level < WaveformPyramid::kLevels; level++) {
+            header.levelOffset[level] = offset;
+            header.levelCount[level] = waveform->pointCount(level);
+            offset += waveform->pointCount(level) * sizeof(WaveformPoint);
+        }
+    }
+
+    // Each writer has its own temporary file, so two loads of the same track
+    // never interleave their bytes
+    std::string path = entryPath(directory, key);
+    std::string temporary = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (waveform) {
+            for (int level = 0; level < WaveformPyramid::kLevels; level++) {
+                file.write(reinterpret_cast<const char*>(waveform->points(level)),
+                           waveform->pointCount(level) * sizeof(WaveformPoint));
+            }
+        }
+        if (!file) {
+            file.close();
+            fs::remove(temporary, error);
+            return false;
+        }
+    }
+    fs::rename(temporary, path, error);
+    if (error) {
+        // On Windows an entry that is mapped right now can't be replaced
+        fs::remove(temporary, error);
+        return false;
+    }
+
+    // Scanning the directory costs a stat per entry, so it only happens on
+    // the first store and when the running tally says the budget may be
+    // exceeded. Replaced entries and other writers only make the tally high,
+    // which brings the next scan forward.
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (directory != directory_) return true;
+    known_bytes_ += offset;
+    if (!scanned_ || known_bytes_ > maxBytes) {
+        known_bytes_ = evict(directory, maxBytes);
+        scanned_ = true;
+    }
+    return true;
+}
+
+// Delete the least recently used entries until the rest fit in maxBytes;
+// returns the size of what is left
+uint64_t AnalysisCache::evict(const std::string& directory, uint64_t maxBytes) {
+    struct Entry {
+        fs::path path;
+        uint64_t size;
+        fs::file_time_type used;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+
+    std::error_code error;
+    for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        if (it->path().extension() != kEntryExtension) continue;
+        std::error_code entryError;
+        Entry entry;
+        entry.path = it->path();
+        entry.size = it->file_size(entryError);
+        entry.used = it->last_write_time(entryError);
+        if (entryError) continue;
+        total += entry.size;
+        entries.push_back(entry);
+    }
+    if (total <= maxBytes) return total;
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    for (const Entry& entry : entries) {
+        if (total <= maxBytes) break;
+        if (fs::remove(entry.path, error)) {
+            total -= entry.size;
+        }
+    }
+    return total;
+}
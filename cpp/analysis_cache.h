@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "beat_analyzer.h"
+#include "gain_analyzer.h"
+#include "key_detector.h"
+#include "waveform.h"
+
+// Identity of a source file as the cache sees it. The fingerprint covers
+// the size and the first and last 64 KiB; size and modification time catch
+// edits in between. The path is not part of it, so a moved file, or a copy
+// that kept its modification time, still hits. A copy with a new time gets
+// an entry of its own.
+struct CacheKey {
+    uint64_t fingerprint = 0;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    bool valid = false;
+};
+
+// Everything worked out for a loaded track. frameCount and sampleRate are
+// those of the PCM as played (after any conversion at load), so the caller
+// can check the results line up with the track it has now.
+struct CachedAnalysis {
+    uint64_t frameCount = 0;
+    int32_t sampleRate = 0;
+    std::shared_ptr<const WaveformPyramid> waveform;
+    BeatGrid beatgrid = {};
+    bool hasBeatgrid = false;
+    KeyEstimate key = {};
+    bool hasKey = false;
+    TrackGain gain = {}; // Filled in by dj_analyze, not at load
+    bool hasGain = false;
+};
+
+// Directory of analysis results, one file per track named after its
+// fingerprint and modification time. Each file is a fixed header followed
+// by the waveform levels and is read through a mapping, with no parsing
+// beyond checking the header. Files are written under a temporary name and
+// renamed into place, so a reader never sees half an entry. A hit refreshes
+// the file's modification time, and once the entries written since the last
+// scan could push the directory past its budget, the least recently used
+// files are deleted until it fits.
+//
+// Safe to use from several threads; nothing here may run on the audio thread.
+class AnalysisCache {
+public:
+    // A 6-minute track takes about 3 MB, nearly all waveform levels
+    static constexpr uint64_t kDefaultMaxBytes = 4ull << 30;
+
+    AnalysisCache();
+
+    // An empty directory disables the cache
+    void setDirectory(const std::string& directory, uint64_t maxBytes);
+    bool isEnabled() const;
+
+    // Per-user cache location for this platform, or "" if there is none
+    static std::string defaultDirectory();
+
+    bool makeKey(const std::string& filepath, CacheKey& key) const;
+    bool lookup(const CacheKey& key, CachedAnalysis& analysis);
+    bool store(const CacheKey& key, const CachedAnalysis& analysis);
+
+private:
+    uint64_t evict(const std::string& directory, uint64_t maxBytes);
+    std::string entryPath(const std::string& directory, const CacheKey& key) const;
+
+    mutable std::mutex mutex_;
+    std::string directory_;
+    uint64_t max_bytes_;
+    uint64_t known_bytes_; // Directory size at the last scan plus stores since
+    bool scanned_;
+};
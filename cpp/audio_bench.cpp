@@ -0,0 +1,1044 @@
+// Micro-benchmarks for the native audio engine.
+// Build with -DDJ_BUILD_BENCHMARKS=ON in a Release configuration, then run
+// `audio_bench` for everything or `audio_bench <name>...` for selected benchmarks.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "analysis_cache.h"
+#include "audio_processor.h"
+#include "beat_analyzer.h"
+#include "deck_mixer.h"
+#include "key_detector.h"
+#include "pcm_convert.h"
+#include "resampler.h"
+#include "sample_page_cache.h"
+#include "wav_reader.h"
+#include "waveform.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Best-of-N wall time of `fn` in seconds
+static double timeBest(int runs, const std::function<void()>& fn) {
+    double best = 1e30;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+static std::string tempPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+static void writeU16(std::ofstream& out, uint16_t value) {
+    out.write(reinterpret_cast<const char*>(&value), 2);
+}
+
+static void writeU32(std::ofstream& out, uint32_t value) {
+    out.write(reinterpret_cast<const char*>(&value), 4);
+}
+
+// Write a sine sweep WAV with a LIST chunk ahead of the data, like most DAW exports
+static void writeTestWav(const std::string& path, SampleFormat format, int channels,
+                         int sampleRate, double seconds) {
+    size_t frames = static_cast<size_t>(seconds * sampleRate);
+    int sampleBytes = bytesPerSample(format);
+    uint32_t dataSize = static_cast<uint32_t>(frames * channels * sampleBytes);
+    const char listChunk[] = "INFOISFT\x06\0\0\0bench\0";
+    uint32_t listSize = sizeof(listChunk) - 1;
+
+    std::ofstream out(path, std::ios::binary);
+    out.write("RIFF", 4);
+    writeU32(out, 4 + (8 + 16) + (8 + listSize) + (8 + dataSize));
+    out.write("WAVEfmt ", 8);
+    writeU32(out, 16);
+    writeU16(out, format == SampleFormat::Float32 ? 3 : 1);
+    writeU16(out, channels);
+    writeU32(out, sampleRate);
+    writeU32(out, sampleRate * channels * sampleBytes);
+    writeU16(out, channels * sampleBytes);
+    writeU16(out, sampleBytes * 8);
+    out.write("LIST", 4);
+    writeU32(out, listSize);
+    out.write(listChunk, listSize);
+    out.write("data", 4);
+    writeU32(out, dataSize);
+
+    std::vector<char> block(channels * sampleBytes);
+    for (size_t i = 0; i < frames; i++) {
+        double value = 0.5 * sin(2.0 * M_PI * (110.0 + i * 0.001) * i / sampleRate);
+        for (int ch = 0; ch < channels; ch++) {
+            char* p = block.data() + ch * sampleBytes;
+            if (format == SampleFormat::Float32) {
+                float sample = static_cast<float>(value);
+                memcpy(p, &sample, 4);
+            } else {
+                int32_t sample = static_cast<int32_t>(value * 2147483647.0);
+                uint32_t bits = static_cast<uint32_t>(sample) >> (32 - sampleBytes * 8);
+                memcpy(p, &bits, sampleBytes);
+            }
+        }
+        out.write(block.data(), block.size());
+    }
+}
+
+// The loader as it was before the RIFF walker and SIMD kernels: read the data
+// chunk into a byte vector, then push_back one converted sample at a time.
+// Only 16/32-bit integer PCM is supported, as before. The header is located
+// with the new parser since the old one stopped at byte 44.
+static bool legacyLoadWav(const std::string& path, std::vector<float>& left, std::vector<float>& right) {
+    WavInfo info;
+    std::string error;
+    {
+        MappedFile mapping;
+        if (!mapping.open(path) || !parseWavHeader(mapping.data(), mapping.size(), info, error)) {
+            return false;
+        }
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    file.seekg(info.dataOffset);
+    std::vector<char> audioData(info.dataSize);
+    file.read(audioData.data(), info.dataSize);
+
+    left.clear();
+    right.clear();
+    if (info.bitsPerSample == 16) {
+        int16_t* samples = reinterpret_cast<int16_t*>(audioData.data());
+        for (size_t i = 0; i + 1 < info.dataSize / 2; i += 2) {
+            left.push_back(static_cast<float>(samples[i]) / 32768.0f);
+            right.push_back(static_cast<float>(samples[i + 1]) / 32768.0f);
+        }
+    } else if (info.bitsPerSample == 32 && info.formatTag == 1) {
+        int32_t* samples = reinterpret_cast<int32_t*>(audioData.data());
+        for (size_t i = 0; i + 1 < info.dataSize / 4; i += 2) {
+            left.push_back(static_cast<float>(samples[i]) / 2147483648.0f);
+            right.push_back(static_cast<float>(samples[i + 1]) / 2147483648.0f);
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Load throughput of the decode-up-front WAV path, in MB/s of PCM data
+static void benchWavLoad() {
+    struct Case {
+        const char* name;
+        SampleFormat format;
+    };
+    const Case cases[] = {
+        {"int16", SampleFormat::Int16},
+        {"int24", SampleFormat::Int24},
+        {"int32", SampleFormat::Int32},
+        {"float32", SampleFormat::Float32},
+    };
+    const double seconds = 120.0;
+
+    printf("WAV load, %.0f s stereo 44.1 kHz, kernels: %s\n", seconds, pcmKernelName());
+    printf("  %-8s %12s %12s %12s\n", "format", "legacy", "1 thread", "all threads");
+
+    for (const Case& c : cases) {
+        std::string path = tempPath(std::string("dj_bench_") + c.name + ".wav");
+        writeTestWav(path, c.format, 2, 44100, seconds);
+        double megabytes = seconds * 44100 * 2 * bytesPerSample(c.format) / 1e6;
+
+        std::vector<float> left, right;
+        char legacy[32] = "n/a";
+        if (legacyLoadWav(path, left, right)) {
+            double t = timeBest(3, [&] { legacyLoadWav(path, left, right); });
+            snprintf(legacy, sizeof(legacy), "%.0f MB/s", megabytes / t);
+        }
+
+        std::string error;
+        double single = timeBest(3, [&] {
+            AudioFile file;
+            readWavFile(path, file, SampleStorage::Float, 1, error);
+        });
+        double parallel = timeBest(3, [&] {
+            AudioFile file;
+            readWavFile(path, file, SampleStorage::Float, 0, error);
+        });
+
+        char singleText[32], parallelText[32];
+        snprintf(singleText, sizeof(singleText), "%.0f MB/s", megabytes / single);
+        snprintf(parallelText, sizeof(parallelText), "%.0f MB/s", megabytes / parallel);
+        printf("  %-8s %12s %12s %12s\n", c.name, legacy, singleText, parallelText);
+
+        std::filesystem::remove(path);
+    }
+}
+
+static const char* qualityName(ResampleQuality quality) {
+    switch (quality) {
+        case ResampleQuality::Draft: return "draft";
+        case ResampleQuality::Standard: return "standard";
+        default: return "high";
+    }
+}
+
+// Sample-rate conversion cost: streaming 48 kHz tracks into a 44.1 kHz stream
+// in callback-sized blocks (CPU per deck as a share of real time), and
+// converting a decoded track once at load
+static void benchResample() {
+    const int sourceRate = 48000;
+    const int outputRate = 44100;
+    const size_t block = 512;
+    const double seconds = 30.0;
+    const double step = static_cast<double>(sourceRate) / outputRate;
+    const ResampleQuality tiers[] = {ResampleQuality::Draft, ResampleQuality::Standard, ResampleQuality::High};
+
+    AudioFile track;
+    size_t frames = static_cast<size_t>(seconds * sourceRate);
+    track.leftChannel.resize(frames);
+    track.rightChannel.resize(frames);
+    for (size_t i = 0; i < frames; i++) {
+        track.leftChannel[i] = static_cast<float>(0.5 * sin(2.0 * M_PI * 1000.0 * i / sourceRate));
+        track.rightChannel[i] = track.leftChannel[i];
+    }
+    track.frameCount = frames;
+    track.sampleRate = sourceRate;
+    track.channels = 2;
+    track.loaded = true;
+
+    printf("Resample 48 kHz -> 44.1 kHz, %zu-frame blocks, %.0f s track\n", block, seconds);
+    printf("  %-9s %5s %12s %14s %14s\n", "tier", "taps", "ns/frame", "CPU per deck", "load-time");
+
+    for (ResampleQuality quality : tiers) {
+        std::shared_ptr<const SincFilterBank> bank = getSincFilterBank(quality, step);
+        StreamResampler resampler;
+        resampler.prepare(block, step);
+        resampler.setFilterBank(bank.get());
+
+        std::vector<float> outLeft(block), outRight(block);
+        size_t outputFrames = static_cast<size_t>(frames / step) - block;
+        double streaming = timeBest(3, [&] {
+            resampler.reset();
+            size_t position = 0;
+            for (size_t done = 0; done < outputFrames; done += block) {
+                position += resampler.process(track, position, step, outLeft.data(), outRight.data(), block);
+            }
+        });
+
+        std::vector<float> left, right;
+        double load = timeBest(3, [&] {
+            resampleStereo(track.leftChannel, track.rightChannel, left, right, step, quality);
+        });
+
+        double nsPerFrame = streaming * 1e9 / outputFrames;
+        double cpuShare = 100.0 * streaming / (static_cast<double>(outputFrames) / outputRate);
+        char cpuText[32], loadText[32];
+        snprintf(cpuText, sizeof(cpuText), "%.2f %%", cpuShare);
+        snprintf(loadText, sizeof(loadText), "%.0fx realtime", seconds / load);
+        printf("  %-9s %5d %12.1f %14s %14s\n", qualityName(quality), bank->taps(), nsPerFrame, cpuText, loadText);
+    }
+}
+
+// Per-sample cubic interpolation straight off the track, with bounds checks on
+// every tap: what a playhead without block processing costs
+static size_t naiveCubic(const AudioFile& track, size_t position, double& frac, double step,
+                         float* outLeft, float* outRight, size_t frames) {
+    auto tap = [&](const std::vector<float>& channel, long index) {
+        return (index < 0 || index >= static_cast<long>(track.frameCount)) ? 0.0f : channel[index];
+    };
+    double start = frac;
+    for (size_t n = 0; n < frames; n++) {
+        double offset = start + n * step;
+        long i = static_cast<long>(position) + static_cast<long>(offset);
+        float f = static_cast<float>(offset - std::floor(offset));
+        float w0 = -0.5f * f * f * f + f * f - 0.5f * f;
+        float w1 = 1.5f * f * f * f - 2.5f * f * f + 1.0f;
+        float w2 = -1.5f * f * f * f + 2.0f * f * f + 0.5f * f;
+        float w3 = 0.5f * f * f * f - 0.5f * f * f;
+        outLeft[n] = w0 * tap(track.leftChannel, i - 1) + w1 * tap(track.leftChannel, i) +
+                     w2 * tap(track.leftChannel, i + 1) + w3 * tap(track.leftChannel, i + 2);
+        outRight[n] = w0 * tap(track.rightChannel, i - 1) + w1 * tap(track.rightChannel, i) +
+                      w2 * tap(track.rightChannel, i + 1) + w3 * tap(track.rightChannel, i + 2);
+    }
+    double advance = start + frames * step;
+    size_t whole = static_cast<size_t>(advance);
+    frac = advance - whole;
+    return whole;
+}
+
+// Fractional playhead cost with two decks at the ends of the pitch range
+// (+1 and -1 octave), 44.1 kHz tracks into a 44.1 kHz stream
+static void benchPlayhead() {
+    const int rate = 44100;
+    const size_t block = 256;
+    const double seconds = 20.0;
+    const double steps[2] = {2.0, 0.5};
+
+    AudioFile track;
+    size_t frames = static_cast<size_t>(seconds * rate * 2);
+    track.leftChannel.resize(frames);
+    track.rightChannel.resize(frames);
+    for (size_t i = 0; i < frames; i++) {
+        track.leftChannel[i] = static_cast<float>(0.5 * sin(2.0 * M_PI * 440.0 * i / rate));
+        track.rightChannel[i] = track.leftChannel[i];
+    }
+    track.frameCount = frames;
+    track.sampleRate = rate;
+    track.channels = 2;
+    track.loaded = true;
+
+    SincBankLadder ladder;
+    ladder.build(ResampleQuality::Standard, 2.0);
+
+    printf("Playhead, 2 decks at +1/-1 octave, %zu-frame blocks\n", block);
+    printf("  %-14s %14s %14s\n", "interpolator", "ns/frame/deck", "CPU (2 decks)");
+
+    const size_t outputFrames = static_cast<size_t>(seconds * rate);
+    std::vector<float> outLeft(block), outRight(block);
+    auto report = [&](const char* name, double elapsed) {
+        double nsPerFrame = elapsed * 1e9 / (outputFrames * 2);
+        char cpuText[32];
+        snprintf(cpuText, sizeof(cpuText), "%.2f %%", 100.0 * elapsed / seconds);
+        printf("  %-14s %14.1f %14s\n", name, nsPerFrame, cpuText);
+    };
+
+    double naive = timeBest(3, [&] {
+        for (double step : steps) {
+            size_t position = 0;
+            double frac = 0.0;
+            for (size_t done = 0; done < outputFrames; done += block) {
+                position += naiveCubic(track, position, frac, step, outLeft.data(), outRight.data(), block);
+            }
+        }
+    });
+    report("naive cubic", naive);
+
+    const struct {
+        const char* name;
+        InterpolationMode mode;
+    } modes[] = {
+        {"linear", InterpolationMode::Linear},
+        {"cubic", InterpolationMode::Cubic},
+        {"sinc standard", InterpolationMode::Sinc},
+    };
+    for (const auto& m : modes) {
+        StreamResampler playheads[2];
+        for (int deck = 0; deck < 2; deck++) {
+            playheads[deck].prepare(block, 2.0);
+            playheads[deck].setMode(m.mode);
+            playheads[deck].setFilterBank(ladder.select(steps[deck]));
+        }
+        double elapsed = timeBest(3, [&] {
+            for (int deck = 0; deck < 2; deck++) {
+                playheads[deck].reset();
+                size_t position = 0;
+                for (size_t done = 0; done < outputFrames; done += block) {
+                    position += playheads[deck].process(track, position, steps[deck],
+                                                        outLeft.data(), outRight.data(), block);
+                }
+            }
+        });
+        report(m.name, elapsed);
+    }
+}
+
+// Key-lock cost per 128-frame block with two decks stretching at once,
+// against the block's real-time deadline. Reports the worst block as well as
+// the mean, since a stretcher that is cheap on average but bursty would glitch.
+static void benchKeyLock() {
+    const int rate = 44100;
+    const int block = 128;
+    const int blocks = 20000;
+    const double deadlineUs = 1e6 * block / rate;
+    const float tempoPairs[][2] = {{1.06f, 0.94f}, {2.0f, 0.5f}};
+
+    // Chord plus noise bursts, so the similarity search has real work to do
+    size_t sourceFrames = static_cast<size_t>(rate) * 60;
+    std::vector<float> source(sourceFrames);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < sourceFrames; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        float noise = ((seed >> 9) / 4194304.0f - 1.0f) * ((i / 11025) % 4 == 0 ? 0.3f : 0.0f);
+        source[i] = 0.2f * static_cast<float>(sin(2.0 * M_PI * 220.0 * i / rate) +
+                                              sin(2.0 * M_PI * 277.2 * i / rate) +
+                                              sin(2.0 * M_PI * 329.6 * i / rate)) + noise;
+    }
+
+    printf("Key-lock, 2 decks, %d-frame blocks (deadline %.0f us)\n", block, deadlineUs);
+    printf("  %-12s %10s %10s %10s %12s\n", "tempos", "mean us", "p99 us", "max us", "max/deadline");
+
+    for (const auto& tempos : tempoPairs) {
+        TimeStretcher stretchers[2] = {TimeStretcher(rate, block, 2.0f), TimeStretcher(rate, block, 2.0f)};
+        size_t positions[2] = {0, 0};
+        std::vector<float> outLeft(block), outRight(block);
+        std::vector<double> times(blocks);
+
+        for (int b = 0; b < blocks; b++) {
+            auto start = std::chrono::steady_clock::now();
+            for (int deck = 0; deck < 2; deck++) {
+                stretchers[deck].setTempo(tempos[deck]);
+                int wanted = stretchers[deck].inputWanted(block);
+                if (positions[deck] + wanted > sourceFrames) positions[deck] = 0;
+                const float* input = source.data() + positions[deck];
+                stretchers[deck].write(input, input, wanted);
+                positions[deck] += wanted;
+                stretchers[deck].process(outLeft.data(), outRight.data(), block);
+            }
+            std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+            times[b] = elapsed.count();
+        }
+
+        double mean = 0.0;
+        for (double t : times) mean += t;
+        mean /= blocks;
+        std::sort(times.begin(), times.end());
+        double p99 = times[blocks * 99 / 100];
+        double worst = times.back();
+
+        char name[32];
+        snprintf(name, sizeof(name), "%.2f/%.2f", tempos[0], tempos[1]);
+        printf("  %-12s %10.1f %10.1f %10.1f %11.1f%%\n", name, mean, p99, worst, 100.0 * worst / deadlineUs);
+    }
+}
+
+// DelayLine as it was before power-of-two masking: a modulo on every access
+class LegacyDelayLine {
+public:
+    explicit LegacyDelayLine(int maxDelay) : buffer(maxDelay, 0.0f), maxDelay(maxDelay) {}
+    void write(float sample) {
+        buffer[writePos] = sample;
+        writePos = (writePos + 1) % maxDelay;
+    }
+    float read(int delay) { return buffer[(writePos - delay + maxDelay) % maxDelay]; }
+    int getMaxDelay() const { return maxDelay; }
+
+private:
+    std::vector<float> buffer;
+    int maxDelay;
+    int writePos = 0;
+};
+
+// The per-sample processor as it was before the stereo block rewrite: mono
+// process() run once per channel over shared filter and delay state
+class LegacyProcessor {
+public:
+    explicit LegacyProcessor(int sampleRate)
+        : sampleRate(sampleRate),
+          flangerDelayLine(static_cast<int>(sampleRate * 0.01f)),
+          echoDelayLine(sampleRate * 2),
+          reverbDelayLine(sampleRate) {
+        lowFilter.setLowshelf(320.0f, 0.707f, 3.0f, sampleRate);
+        midFilter.setPeaking(1000.0f, 0.707f, -3.0f, sampleRate);
+        highFilter.setHighshelf(3200.0f, 0.707f, 3.0f, sampleRate);
+        filterEffect.setLowpass(1000.0f, 0.707f, sampleRate);
+    }
+
+    bool effects = false;
+
+    void process(const float* input, float* output, int numSamples) {
+        for (int i = 0; i < numSamples; i++) {
+            float sample = lowFilter.process(input[i]);
+            sample = midFilter.process(sample);
+            sample = highFilter.process(sample);
+            if (effects) {
+                flangerPhase += 0.1f;
+                if (flangerPhase > 2.0f * M_PI) flangerPhase -= 2.0f * M_PI;
+                int delaySamples = (int)((0.003f + 0.002f * sinf(flangerPhase)) * sampleRate);
+                delaySamples = std::max(1, std::min(delaySamples, flangerDelayLine.getMaxDelay() - 1));
+                float delayed = flangerDelayLine.read(delaySamples);
+                flangerDelayLine.write(sample);
+                sample = sample + delayed * 0.5f;
+
+                sample = filterEffect.process(sample);
+
+                delayed = echoDelayLine.read((int)(0.3f * sampleRate));
+                echoDelayLine.write(sample + delayed * 0.3f);
+                sample = sample + delayed * 0.4f;
+
+                float reverbSum = (reverbDelayLine.read((int)(0.05f * sampleRate)) +
+                                   reverbDelayLine.read((int)(0.1f * sampleRate)) +
+                                   reverbDelayLine.read((int)(0.15f * sampleRate))) * 0.33f;
+                reverbDelayLine.write(sample + reverbSum * 0.2f);
+                sample = sample + reverbSum * 0.3f;
+            }
+            output[i] = sample * 0.8f;
+        }
+    }
+
+private:
+    int sampleRate;
+    BiquadFilter lowFilter, midFilter, highFilter, filterEffect;
+    LegacyDelayLine flangerDelayLine, echoDelayLine, reverbDelayLine;
+    float flangerPhase = 0.0f;
+};
+
+// Deck processor cost per stereo frame, legacy per-sample path against the
+// stereo block path, at common buffer sizes
+static void benchProcessor() {
+    const int rate = 44100;
+    const int totalFrames = rate * 20;
+    const int blockSizes[] = {64, 128, 512};
+
+    std::vector<float> inLeft(512), inRight(512), outLeft(512), outRight(512);
+    for (int i = 0; i < 512; i++) {
+        inLeft[i] = static_cast<float>(sin(2.0 * M_PI * 440.0 * i / rate));
+        inRight[i] = static_cast<float>(cos(2.0 * M_PI * 440.0 * i / rate));
+    }
+
+    printf("Deck processor, stereo, ns per frame\n");
+    printf("  %-18s %6s %10s %10s %8s\n", "chain", "block", "legacy", "stereo", "speedup");
+
+    for (int withEffects = 0; withEffects < 2; withEffects++) {
+        for (int block : blockSizes) {
+            LegacyProcessor legacy(rate);
+            legacy.effects = withEffects != 0;
+            double legacyTime = timeBest(3, [&] {
+                for (int done = 0; done < totalFrames; done += block) {
+                    legacy.process(inLeft.data(), outLeft.data(), block);
+                    legacy.process(inRight.data(), outRight.data(), block);
+                }
+            });
+
+            AudioProcessor processor(rate);
+            processor.setVolume(0.8f);
+            processor.setEQ(0, 0.25f);
+            processor.setEQ(1, -0.25f);
+            processor.setEQ(2, 0.25f);
+            for (int effect = 0; effect < 4; effect++) {
+                processor.setEffect(effect, withEffects != 0);
+            }
+            double stereoTime = timeBest(3, [&] {
+                for (int done = 0; done < totalFrames; done += block) {
+                    processor.processStereo(inLeft.data(), inRight.data(), outLeft.data(), outRight.data(), block);
+                }
+            });
+
+            printf("  %-18s %6d %10.1f %10.1f %7.2fx\n", withEffects ? "EQ + all effects" : "EQ only", block,
+                   legacyTime * 1e9 / totalFrames, stereoTime * 1e9 / totalFrames, legacyTime / stereoTime);
+        }
+    }
+}
+
+// Flanger and echo inner loops on one channel: modulo-indexed integer taps
+// read sample by sample, against masked cubic taps (flanger) and block
+// reads/writes (echo)
+static void benchDelay() {
+    const int rate = 44100;
+    const int block = 256;
+    const int totalFrames = rate * 30;
+
+    std::vector<float> input(block), output(block), delays(block), scratch(block), feedback(block);
+    for (int i = 0; i < block; i++) {
+        input[i] = static_cast<float>(sin(2.0 * M_PI * 440.0 * i / rate));
+    }
+
+    auto flangerDelays = [&](float& phase) {
+        for (int i = 0; i < block; i++) {
+            phase += 0.1f;
+            if (phase > 2.0f * M_PI) phase -= 2.0f * M_PI;
+            delays[i] = (0.003f + 0.002f * sinf(phase)) * rate;
+        }
+    };
+
+    LegacyDelayLine legacyFlanger(rate / 100);
+    float legacyPhase = 0.0f;
+    double flangerBefore = timeBest(3, [&] {
+        for (int done = 0; done < totalFrames; done += block) {
+            flangerDelays(legacyPhase);
+            for (int i = 0; i < block; i++) {
+                int delay = std::max(1, std::min(static_cast<int>(delays[i]), legacyFlanger.getMaxDelay() - 1));
+                float delayed = legacyFlanger.read(delay);
+                legacyFlanger.write(input[i]);
+                output[i] = input[i] + delayed * 0.5f;
+            }
+        }
+    });
+
+    DelayLine flanger(rate / 100);
+    float phase = 0.0f;
+    double flangerAfter = timeBest(3, [&] {
+        for (int done = 0; done < totalFrames; done += block) {
+            flangerDelays(phase);
+            for (int i = 0; i < block; i++) {
+                float delayed = flanger.readCubic(delays[i]);
+                flanger.write(input[i]);
+                output[i] = input[i] + delayed * 0.5f;
+            }
+        }
+    });
+
+    const int echoDelay = static_cast<int>(0.3f * rate);
+    LegacyDelayLine legacyEcho(rate * 2);
+    double echoBefore = timeBest(3, [&] {
+        for (int done = 0; done < totalFrames; done += block) {
+            for (int i = 0; i < block; i++) {
+                float delayed = legacyEcho.read(echoDelay);
+                legacyEcho.write(input[i] + delayed * 0.3f);
+                output[i] = input[i] + delayed * 0.4f;
+            }
+        }
+    });
+
+    DelayLine echo(rate * 2);
+    double echoAfter = timeBest(3, [&] {
+        for (int done = 0; done < totalFrames; done += block) {
+            echo.readBlock(echoDelay, scratch.data(), block);
+            for (int i = 0; i < block; i++) {
+                feedback[i] = input[i] + scratch[i] * 0.3f;
+                output[i] = input[i] + scratch[i] * 0.4f;
+            }
+            echo.writeBlock(feedback.data(), block);
+        }
+    });
+
+    printf("Delay lines, one channel, %d-frame blocks, ns per sample\n", block);
+    printf("  %-28s %10s %10s %8s\n", "path", "before", "after", "speedup");
+    printf("  %-28s %10.2f %10.2f %7.2fx\n", "flanger (int -> cubic tap)",
+           flangerBefore * 1e9 / totalFrames, flangerAfter * 1e9 / totalFrames, flangerBefore / flangerAfter);
+    printf("  %-28s %10.2f %10.2f %7.2fx\n", "echo (per sample -> block)",
+           echoBefore * 1e9 / totalFrames, echoAfter * 1e9 / totalFrames, echoBefore / echoAfter);
+}
+
+// Reverb cost per stereo frame: the old three-tap feedback reverb (one delay
+// line per channel, read a block at a time) against the 8-line FDN
+static void benchReverb() {
+    const int rate = 44100;
+    const int block = 128;
+    const int totalFrames = rate * 30;
+
+    std::vector<float> left(block), right(block), wetLeft(block), wetRight(block), taps(block * 3);
+    for (int i = 0; i < block; i++) {
+        left[i] = static_cast<float>(sin(2.0 * M_PI * 440.0 * i / rate));
+        right[i] = left[i];
+    }
+
+    DelayLine toyLines[2] = {DelayLine(rate), DelayLine(rate)};
+    const int toyDelays[3] = {rate / 20, rate / 10, rate * 3 / 20};
+    double toy = timeBest(3, [&] {
+        for (int done = 0; done < totalFrames; done += block) {
+            float* channels[2] = {left.data(), right.data()};
+            float* wet[2] = {wetLeft.data(), wetRight.data()};
+            for (int ch = 0; ch < 2; ch++) {
+                for (int t = 0; t < 3; t++) {
+                    toyLines[ch].readBlock(toyDelays[t], taps.data() + t * block, block);
+                }
+                for (int i = 0; i < block; i++) {
+                    float sum = (taps[i] + taps[block + i] + taps[2 * block + i]) * 0.33f;
+                    taps[i] = channels[ch][i] + sum * 0.2f;
+                    wet[ch][i] = sum * 0.3f;
+                }
+                toyLines[ch].writeBlock(taps.data(), block);
+            }
+        }
+    });
+
+    FdnReverb fdn(rate);
+    double network = timeBest(3, [&] {
+        for (int done = 0; done < totalFrames; done += block) {
+            fdn.process(left.data(), right.data(), wetLeft.data(), wetRight.data(), block);
+        }
+    });
+
+    printf("Reverb, stereo, %d-frame blocks, ns per frame\n", block);
+    printf("  %-24s %10.2f\n", "3-tap toy", toy * 1e9 / totalFrames);
+    printf("  %-24s %10.2f\n", "8-line FDN", network * 1e9 / totalFrames);
+}
+
+// Callback cost against the number of playing decks, through the same
+// DeckMixer loop the engine runs: decoded tracks, EQ engaged, either at unit
+// rate (direct reads) or pitched (sinc playhead)
+static void benchDecks() {
+    const int rate = 44100;
+    const int block = 256;
+    const int blocks = 2000;
+    const double deadlineUs = 1e6 * block / rate;
+    const int deckCounts[] = {1, 2, 4, 8};
+
+    AudioFile track;
+    track.frameCount = static_cast<size_t>(rate) * 20;
+    track.leftChannel.resize(track.frameCount);
+    track.rightChannel.resize(track.frameCount);
+    for (size_t i = 0; i < track.frameCount; i++) {
+        track.leftChannel[i] = 0.3f * static_cast<float>(sin(2.0 * M_PI * 220.0 * i / rate));
+        track.rightChannel[i] = 0.3f * static_cast<float>(sin(2.0 * M_PI * 330.0 * i / rate));
+    }
+    track.sampleRate = rate;
+    track.loaded = true;
+
+    SincBankLadder ladder;
+    ladder.build(ResampleQuality::Standard, 2.0);
+    MixSettings settings;
+    settings.ladder = &ladder;
+
+    printf("Deck mixer, %d-frame callbacks (deadline %.0f us)\n", block, deadlineUs);
+    printf("  %-8s %6s %10s %10s %12s %12s\n", "decks", "pitch", "mean us", "p99 us", "us per deck", "p99/deadline");
+
+    for (float pitch : {0.0f, 0.03f}) {
+        for (int deckCount : deckCounts) {
+            std::unique_ptr<DeckMixer> mixer(new DeckMixer());
+            mixer->prepare(rate, block, 2.0, 1.0f);
+            for (int deck = 0; deck < deckCount; deck++) {
+                DeckState& state = mixer->deck(deck);
+                state.track.store(&track);
+                state.frames.store(track.frameCount);
+                state.controls.playing = true;
+                state.controls.pitch = pitch;
+                state.processor->setEQ(0, 0.5f);
+                state.processor->setEQ(2, -0.5f);
+            }
+
+            std::vector<float> out(block * 2);
+            std::vector<double> times(blocks);
+            for (int b = 0; b < blocks; b++) {
+                auto start = std::chrono::steady_clock::now();
+                std::fill(out.begin(), out.end(), 0.0f);
+                mixer->render(out.data(), 0, block, settings);
+                std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+                times[b] = elapsed.count();
+            }
+
+            double mean = 0.0;
+            for (double t : times) mean += t;
+            mean /= blocks;
+            std::sort(times.begin(), times.end());
+            double p99 = times[blocks * 99 / 100];
+            printf("  %-8d %6.2f %10.1f %10.1f %12.1f %11.1f%%\n", deckCount, pitch, mean, p99,
+                   mean / deckCount, 100.0 * p99 / deadlineUs);
+        }
+    }
+}
+
+// What each sample storage costs: memory per hour of audio, and the read a
+// deck does every callback (256 frames, stepping through a 60 s track). Paged
+// reads are from resident pages; a mapping's memory is the OS page cache's.
+static void benchStorage() {
+    struct Case {
+        const char* name;
+        SampleFormat format;
+        int channels;
+    };
+    const Case cases[] = {
+        {"int16 stereo", SampleFormat::Int16, 2},
+        {"int24 stereo", SampleFormat::Int24, 2},
+        {"int16 mono", SampleFormat::Int16, 1},
+    };
+    const SampleStorage storages[] = {SampleStorage::Float, SampleStorage::Compact, SampleStorage::Mapped,
+                                      SampleStorage::Paged};
+    const char* const storageNames[] = {"mapped", "compact", "paged", "float"};
+    const int rate = 44100;
+    const double seconds = 60.0;
+    const size_t block = 256;
+
+    printf("Sample storage, %.0f s 44.1 kHz tracks, %zu-frame reads, kernels: %s\n", seconds, block, pcmKernelName());
+    printf("  %-13s %-8s %12s %14s\n", "format", "storage", "MB per hour", "ns per read");
+
+    for (const Case& c : cases) {
+        std::string path = tempPath("dj_bench_storage.wav");
+        writeTestWav(path, c.format, c.channels, rate, seconds);
+        for (SampleStorage storage : storages) {
+            SamplePageCache pages;
+            AudioFile track;
+            std::string error;
+            if (!readWavFile(path, track, storage, 0, error, nullptr, &pages)) {
+                printf("  %s\n", error.c_str());
+                continue;
+            }
+            if (track.isPaged()) pages.fill(*track.paged, 0, track.frameCount);
+
+            char memory[32];
+            double hours = seconds / 3600.0;
+            if (track.isMapped()) {
+                snprintf(memory, sizeof(memory), "(%.0f)", track.frameCount * track.frameStride / 1e6 / hours);
+            } else if (track.isPaged()) {
+                snprintf(memory, sizeof(memory), "budget");
+            } else {
+                snprintf(memory, sizeof(memory), "%.0f", track.byteSize() / 1e6 / hours);
+            }
+
+            std::vector<float> left(block), right(block);
+            size_t reads = track.frameCount / block;
+            double t = timeBest(5, [&] {
+                for (size_t i = 0; i < reads; i++) {
+                    track.readFrames(i * block, block, left.data(), right.data());
+                }
+            });
+            printf("  %-13s %-8s %12s %14.0f\n", c.name, storageNames[static_cast<int>(storage)], memory,
+                   t * 1e9 / reads);
+        }
+        std::filesystem::remove(path);
+    }
+}
+
+// Metering cost per stereo frame, and what metering every deck plus the
+// master bus adds to a callback
+static void benchMeter() {
+    const int rate = 44100;
+    const int block = 256;
+    const int totalFrames = rate * 30;
+    const double deadlineUs = 1e6 * block / rate;
+
+    std::vector<float> left(block), right(block), interleaved(block * 2);
+    uint32_t seed = 1;
+    for (int i = 0; i < block; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        left[i] = static_cast<float>(seed >> 8) / 16777216.0f - 0.5f;
+        right[i] = 0.5f * left[i] + 0.2f * static_cast<float>(sin(2.0 * M_PI * 1000.0 * i / rate));
+        interleaved[i * 2] = left[i];
+        interleaved[i * 2 + 1] = right[i];
+    }
+
+    LevelMeter meter(rate, block);
+    double planar = timeBest(3, [&] {
+        for (int done = 0; done < totalFrames; done += block) {
+            meter.process(left.data(), right.data(), block);
+        }
+    });
+    double packed = timeBest(3, [&] {
+        for (int done = 0; done < totalFrames; done += block) {
+            meter.processInterleaved(interleaved.data(), block);
+        }
+    });
+    double silent = timeBest(3, [&] {
+        for (int done = 0; done < totalFrames; done += block) {
+            meter.processSilence(block);
+        }
+    });
+
+    double blocks = static_cast<double>(totalFrames) / block;
+    double perCallbackUs = (kMaxDecks + 1) * planar * 1e6 / blocks;
+    printf("Level meter (peak, 4x true peak, RMS, R128 loudness), ns per stereo frame\n");
+    printf("  %-24s %10.2f\n", "planar", planar * 1e9 / totalFrames);
+    printf("  %-24s %10.2f\n", "interleaved", packed * 1e9 / totalFrames);
+    printf("  %-24s %10.2f\n", "stopped deck", silent * 1e9 / totalFrames);
+    printf("  %d meters per %d-frame callback: %.1f us, %.2f%% of the %.0f us deadline\n",
+           kMaxDecks + 1, block, perCallbackUs, 100.0 * perCallbackUs / deadlineUs, deadlineUs);
+}
+
+// Waveform pyramid for a 6-minute decoded track, as built at load
+static void benchWaveform() {
+    const int rate = 44100;
+    const size_t frames = static_cast<size_t>(rate) * 360;
+
+    AudioFile track;
+    track.frameCount = frames;
+    track.leftChannel.resize(frames);
+    track.rightChannel.resize(frames);
+    for (size_t i = 0; i < frames; i++) {
+        float beat = (i % (rate / 2) < 2000) ? 0.8f : 0.1f;
+        track.leftChannel[i] = beat * static_cast<float>(sin(2.0 * M_PI * 60.0 * i / rate));
+        track.rightChannel[i] = 0.2f * static_cast<float>(sin(2.0 * M_PI * 3000.0 * i / rate));
+    }
+    track.sampleRate = rate;
+    track.loaded = true;
+
+    unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    printf("Waveform pyramid, 6-minute track, %d levels\n", WaveformPyramid::kLevels);
+    printf("  %-24s %10s %10s\n", "threads", "ms", "KB");
+    for (unsigned threads : {1u, hardware}) {
+        WaveformPyramid waveform;
+        double seconds = timeBest(3, [&] { waveform.build(track, threads); });
+        printf("  %-24u %10.1f %10zu\n", threads, seconds * 1e3, waveform.byteSize() / 1024);
+        if (hardware == 1) break;
+    }
+}
+
+// Tempo analysis of a 6-minute track (128 BPM kick, off-beat hats and a
+// noise floor) on one core, split into the source pass and the analysis
+static void benchBeats() {
+    const int rate = 44100;
+    const double bpm = 128.0;
+    const size_t frames = static_cast<size_t>(rate) * 360;
+    const double beatLength = 60.0 * rate / bpm;
+
+    std::vector<float> left(frames, 0.0f), right(frames, 0.0f);
+    uint32_t seed = 1;
+    auto noise = [&seed] {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f - 0.5f;
+    };
+    for (int beat = 0; beat * beatLength < frames; beat++) {
+        size_t kick = static_cast<size_t>(beat * beatLength);
+        float gain = (beat % 4 == 0) ? 0.9f : 0.5f;
+        for (size_t i = 0; i < static_cast<size_t>(rate / 5) && kick + i < frames; i++) {
+            double t = static_cast<double>(i) / rate;
+            float sample = gain * static_cast<float>(exp(-t * 25.0) * sin(2.0 * M_PI * (50.0 + 80.0 * exp(-t * 40.0)) * t));
+            left[kick + i] += sample;
+            right[kick + i] += sample;
+        }
+        size_t hat = static_cast<size_t>((beat + 0.5) * beatLength);
+        for (size_t i = 0; i < static_cast<size_t>(rate / 40) && hat + i < frames; i++) {
+            float sample = 0.2f * static_cast<float>(exp(-200.0 * i / rate)) * noise();
+            left[hat + i] += sample;
+            right[hat + i] -= sample;
+        }
+    }
+    for (size_t i = 0; i < frames; i++) {
+        float floor = 0.02f * noise();
+        left[i] += floor;
+        right[i] += floor;
+    }
+
+    BeatAnalyzer analyzer;
+    BeatGrid grid = {};
+    bool found = false;
+    double source = timeBest(3, [&] { analyzer.setSource(left.data(), right.data(), frames, rate); });
+    double analysis = timeBest(3, [&] {
+        analyzer.setSource(left.data(), right.data(), frames, rate);
+        found = analyzer.analyze(grid);
+    }) - source;
+
+    printf("Beat analysis, 6-minute track at %.1f BPM\n", bpm);
+    printf("  %-24s %10.1f ms\n", "source pass", source * 1e3);
+    printf("  %-24s %10.1f ms\n", "analysis", analysis * 1e3);
+    if (found) {
+        printf("  detected %.3f BPM, confidence %.2f, first beat %.1f ms, downbeat %d, %d beats\n",
+               grid.bpm, grid.confidence, grid.firstBeat * 1e3 / rate, grid.firstDownbeat, grid.beatCount);
+    } else {
+        printf("  no tempo found\n");
+    }
+}
+
+// Key detection of a 6-minute track: an A minor i-iv-V-i progression with
+// bass, chords and a kick, timed as the source pass and the analysis
+static void benchKey() {
+    const int rate = 44100;
+    const size_t frames = static_cast<size_t>(rate) * 360;
+    const double barSeconds = 2.0;
+    const int roots[4] = {57, 62, 64, 57}; // A, D, E, A
+    const int thirds[4] = {3, 3, 4, 3};
+
+    std::vector<float> mono(frames, 0.0f);
+    size_t barFrames = static_cast<size_t>(barSeconds * rate);
+    for (size_t bar = 0; bar * barFrames < frames; bar++) {
+        int root = roots[bar % 4];
+        int notes[4] = {root - 12, root, root + thirds[bar % 4], root + 7};
+        for (size_t i = 0; i < barFrames && bar * barFrames + i < frames; i++) {
+            double t = static_cast<double>(i) / rate;
+            float envelope = static_cast<float>(exp(-t * 1.5));
+            float sample = 0.0f;
+            for (int note : notes) {
+                double frequency = 440.0 * pow(2.0, (note - 69) / 12.0);
+                sample += 0.1f * envelope * static_cast<float>(sin(2.0 * M_PI * frequency * t)
+                                                               + 0.5 * sin(4.0 * M_PI * frequency * t));
+            }
+            double beatTime = fmod(t, 0.5);
+            sample += 0.5f * static_cast<float>(exp(-beatTime * 25.0) * sin(2.0 * M_PI * 55.0 * beatTime));
+            mono[bar * barFrames + i] = sample;
+        }
+    }
+
+    KeyDetector detector;
+    KeyEstimate key = {};
+    bool found = false;
+    double source = timeBest(3, [&] { detector.setSource(mono.data(), mono.data(), frames, rate); });
+    double analysis = timeBest(3, [&] {
+        detector.setSource(mono.data(), mono.data(), frames, rate);
+        found = detector.analyze(key);
+    }) - source;
+
+    printf("Key detection, 6-minute track in A minor\n");
+    printf("  %-24s %10.1f ms\n", "source pass", source * 1e3);
+    printf("  %-24s %10.1f ms\n", "analysis", analysis * 1e3);
+    if (found) {
+        printf("  detected %s (%s), confidence %.2f\n", key.name, key.camelot, key.confidence);
+    } else {
+        printf("  no key found\n");
+    }
+}
+
+// Readying a mapped 6-minute WAV for a deck: building the waveform and the
+// analyzers' sources plus the analysis on a cold load, against fingerprinting
+// the file and reading everything back from the analysis cache
+static void benchCache() {
+    const double seconds = 360.0;
+    std::string path = tempPath("dj_bench_cache.wav");
+    std::string directory = tempPath("dj_bench_cache");
+    writeTestWav(path, SampleFormat::Int16, 2, 44100, seconds);
+    std::filesystem::remove_all(directory);
+
+    AnalysisCache cache;
+    cache.setDirectory(directory, 64ull << 20);
+    std::string error;
+    AudioFile track;
+    readWavFile(path, track, SampleStorage::Mapped, 0, error);
+
+    CacheKey key;
+    CachedAnalysis results;
+    double cold = timeBest(1, [&] {
+        std::shared_ptr<WaveformPyramid> waveform = std::make_shared<WaveformPyramid>();
+        waveform->build(track);
+        BeatAnalyzer beats;
+        KeyDetector keys;
+        beats.setSource(track);
+        keys.setSource(track);
+        results.frameCount = track.frameCount;
+        results.sampleRate = track.sampleRate;
+        results.waveform = waveform;
+        results.hasBeatgrid = beats.analyze(results.beatgrid);
+        results.hasKey = keys.analyze(results.key);
+    });
+    double store = timeBest(1, [&] {
+        cache.makeKey(path, key);
+        cache.store(key, results);
+    });
+    bool hit = false;
+    double warm = timeBest(5, [&] {
+        CachedAnalysis cached;
+        hit = cache.makeKey(path, key) && cache.lookup(key, cached);
+    });
+
+    printf("Analysis cache, mapped %.0f s WAV (%zu KB waveform)\n", seconds, results.waveform->byteSize() / 1024);
+    printf("  %-24s %10.1f ms\n", "cold: build + analyse", cold * 1e3);
+    printf("  %-24s %10.1f ms\n", "store entry", store * 1e3);
+    printf("  %-24s %10.2f ms%s\n", "warm: key + lookup", warm * 1e3, hit ? "" : " (miss!)");
+
+    track = AudioFile();
+    std::filesystem::remove(path);
+    std::filesystem::remove_all(directory);
+}
+
+struct Benchmark {
+    const char* name;
+    void (*run)();
+};
+
+static const Benchmark kBenchmarks[] = {
+    {"wav_load", benchWavLoad},
+    {"resample", benchResample},
+    {"playhead", benchPlayhead},
+    {"keylock", benchKeyLock},
+    {"processor", benchProcessor},
+    {"delay", benchDelay},
+    {"reverb", benchReverb},
+    {"decks", benchDecks},
+    {"storage", benchStorage},
+    {"meter", benchMeter},
+    {"waveform", benchWaveform},
+    {"beats", benchBeats},
+    {"key", benchKey},
+    {"cache", benchCache},
+};
+
+int main(int argc, char** argv) {
+    for (const Benchmark& benchmark : kBenchmarks) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; i++) {
+            selected |= strcmp(argv[i], benchmark.name) == 0;
+        }
+        if (selected) {
+            benchmark.run();
+            printf("\n");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include "audio_decoder.h"
+
+#include <algorithm>
+
+#include "flac_decoder.h"
+
+// Formats decoded by a third-party single-file decoder, each in its own
+// file; the build defines DJ_DECODE_MP3 and DJ_DECODE_VORBIS when it has them
+#ifdef DJ_DECODE_MP3
+std::unique_ptr<AudioDecoder> openMp3Decoder(const std::string& filepath, std::string& error);
+#endif
+#ifdef DJ_DECODE_VORBIS
+std::unique_ptr<AudioDecoder> openVorbisDecoder(const std::string& filepath, std::string& error);
+#endif
+
+static std::unique_ptr<AudioDecoder> openFlacDecoder(const std::string& filepath, std::string& error) {
+    std::unique_ptr<FlacDecoder> decoder(new FlacDecoder());
+    if (!decoder->open(filepath, error)) return nullptr;
+    return decoder;
+}
+
+struct DecoderFormat {
+    const char* extension;
+    std::unique_ptr<AudioDecoder> (*open)(const std::string& filepath, std::string& error);
+};
+
+static const DecoderFormat kFormats[] = {
+    {"flac", openFlacDecoder},
+#ifdef DJ_DECODE_MP3
+    {"mp3", openMp3Decoder},
+#endif
+#ifdef DJ_DECODE_VORBIS
+    {"ogg", openVorbisDecoder},
+#endif
+};
+
+static std::string lowerExtension(const std::string& filepath) {
+    size_t dot = filepath.find_last_of('.');
+    std::string extension = (dot == std::string::npos) ? "" : filepath.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension;
+}
+
+std::unique_ptr<AudioDecoder> openAudioDecoder(const std::string& filepath, std::string& error) {
+    std::string extension = lowerExtension(filepath);
+    for (const DecoderFormat& format : kFormats) {
+        if (extension == format.extension) {
+            return format.open(filepath, error);
+        }
+    }
+    error = "No decoder for ." + extension + " files";
+    return nullptr;
+}
+
+const std::vector<std::string>& decodableExtensions() {
+    static const std::vector<std::string> extensions = [] {
+        std::vector<std::string> list;
+        for (const DecoderFormat& format : kFormats) {
+            list.push_back(format.extension);
+        }
+        return list;
+    }();
+    return extensions;
+}
+
+bool isDecodableExtension(const std::string& extension) {
+    const std::vector<std::string>& extensions = decodableExtensions();
+    return std::find(extensions.begin(), extensions.end(), extension) != extensions.end();
+}
+
+void DecoderFrameReader::operator()(size_t start, size_t count, float* left, float* right) {
+    size_t decoded = 0;
+    if (start == position_ || decoder_.seek(start)) {
+        decoded = decoder_.read(count, left, right);
+    }
+    std::fill(left + decoded, left + count, 0.0f);
+    std::fill(right + decoded, right + count, 0.0f);
+    position_ = start + decoded;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Incremental decoder for one compressed audio file. Decoders produce
+// deinterleaved float frames at the file's own rate: mono is copied to both
+// channels and channels past the second are dropped. Not thread safe; each
+// reader opens its own.
+class AudioDecoder {
+public:
+    virtual ~AudioDecoder() {}
+
+    virtual int sampleRate() const = 0;
+    virtual int channels() const = 0;
+    virtual size_t frameCount() const = 0;
+    virtual const char* formatName() const = 0;
+
+    // Decode up to `count` frames from the current position; returns how many
+    // were decoded, which is fewer only at the end of the stream or on error
+    virtual size_t read(size_t count, float* left, float* right) = 0;
+    // Continue from `frame`; false if the stream can't get there
+    virtual bool seek(size_t frame) = 0;
+};
+
+// Decoder for `filepath` chosen by its extension, or null with `error` set.
+// FLAC is always built in; MP3 and Ogg Vorbis only when their decoders are
+// in third_party, and otherwise have no decoder.
+std::unique_ptr<AudioDecoder> openAudioDecoder(const std::string& filepath, std::string& error);
+
+// Lower-case extensions ("flac", ...) openAudioDecoder accepts
+const std::vector<std::string>& decodableExtensions();
+bool isDecodableExtension(const std::string& extension);
+
+// Adapts a decoder to the FrameReader callbacks of the analysers: reads in
+// order continue where the last one stopped, anything else seeks. Frames
+// past the end read as silence.
+class DecoderFrameReader {
+public:
+    explicit DecoderFrameReader(AudioDecoder& decoder) : decoder_(decoder), position_(0) {}
+
+    void operator()(size_t start, size_t count, float* left, float* right);
+
+private:
+    AudioDecoder& decoder_;
+    size_t position_;
+};
@@ -1,30 +1,34 @@
 #include "audio_engine.h"
+#include "audio_decoder.h"
+#include "decode_stream.h"
+#include "wav_reader.h"
 #include <iostream>
 #include <cstring>
+#include <new>
+#include <cmath>
 #include <chrono>
 #include <portaudio.h>
 #include <fstream>
 #include <algorithm>
 
+// Fastest a track can be read relative to the output (e.g. 192 kHz into 48 kHz)
+static const double kMaxSourceStep = 8.0;
+
+// Pitch is in octaves, clamped to +/- kMaxPitchOctaves (the UI range)
+static const float kMaxPitchOctaves = 1.0f;
+static const double kMaxReadStep = kMaxSourceStep * 2.0;
+
+// The time base of every timestamp the engine publishes
+static int64_t steadyClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 // Add M_PI definition for Windows
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-// Add a function to send logs to renderer (we'll implement this in the bridge)
-extern "C" {
-    // This will be called from the audio bridge
-    void (*logCallback)(const char* message) = nullptr;
-}
-
-// Helper function to log to both console and renderer
-void logMessage(const std::string& message) {
-    std::cout << message << std::endl;
-    if (logCallback) {
-        logCallback(message.c_str());
-    }
-}
-
 AudioEngine::AudioEngine() 
     : shared_state_(nullptr)
     , shared_memory_(nullptr)
@@ -32,6 +36,7 @@ AudioEngine::AudioEngine()
     , sample_rate_(44100)
     , buffer_size_(512)
     , audio_stream_(nullptr) {
+    analysis_cache_.setDirectory(AnalysisCache::defaultDirectory(), AnalysisCache::kDefaultMaxBytes);
 }
 
 AudioEngine::~AudioEngine() {
@@ -119,9 +124,28 @@ bool AudioEngine::initialize() {
     close(fd);
 #endif
     
-    // Initialize shared state
-    shared_state_ = static_cast<AudioState*>(shared_memory_);
-    memset(shared_state_, 0, sizeof(AudioState));
+    // Construct the shared state in place (never memset live atomics), then
+    // describe the layout and store the magic last, so a reader that sees the
+    // magic also sees a complete header
+    shared_state_ = new (shared_memory_) AudioState();
+    SharedStateHeader& header = shared_state_->header;
+    const char* base = reinterpret_cast<const char*>(shared_state_);
+    header.size = static_cast<uint32_t>(sizeof(AudioState));
+    header.controlsOffset = static_cast<uint32_t>(reinterpret_cast<const char*>(shared_state_->decks) - base);
+    header.masterOffset = static_cast<uint32_t>(reinterpret_cast<const char*>(&shared_state_->master) - base);
+    header.telemetryOffset = static_cast<uint32_t>(reinterpret_cast<const char*>(shared_state_->deckTelemetry) - base);
+    header.engineTelemetryOffset = static_cast<uint32_t>(reinterpret_cast<const char*>(&shared_state_->engine) - base);
+    header.ringOffset = static_cast<uint32_t>(reinterpret_cast<const char*>(&shared_state_->ring) - base);
+    header.magic.store(kSharedStateMagic, std::memory_order_release);
+    
+    // Per-deck state must exist before the callback can run
+    mixer_.prepare(sample_rate_, buffer_size_, kMaxReadStep, kMaxPitchOctaves);
+    master_meter_ = std::make_unique<LevelMeter>(sample_rate_, buffer_size_);
+    {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        sinc_ladders_[resample_quality_.load()].build(static_cast<ResampleQuality>(resample_quality_.load()),
+                                                       kMaxReadStep);
+    }
     
     // Set up audio stream with specific device
     PaStreamParameters outputParams;
@@ -148,6 +172,13 @@ bool AudioEngine::initialize() {
         return false;
     }
     
+    // Host APIs that don't fill in the callback's DAC time still report the
+    // stream's latency; failing that, assume one buffer
+    const PaStreamInfo* streamInfo = Pa_GetStreamInfo(audio_stream_);
+    double outputLatency = (streamInfo && streamInfo->outputLatency > 0.0)
+        ? streamInfo->outputLatency : static_cast<double>(buffer_size_) / sample_rate_;
+    output_latency_ns_ = static_cast<int64_t>(outputLatency * 1e9);
+    
     // Start audio stream
     err = Pa_StartStream(audio_stream_);
     if (err != paNoError) {
@@ -167,9 +198,13 @@ bool AudioEngine::initialize() {
     // Initialize audio buffer
     audio_buffer_.resize(buffer_size_ * 2); // Stereo
     
-    // Start audio thread
     running_ = true;
-    audio_thread_ = std::thread(&AudioEngine::audioThread, this);
+    housekeeping_thread_ = std::thread(&AudioEngine::housekeepingThread, this);
+    
+    // Two loaders, so a deck and a sample slot (or two decks) load side by side
+    loader_pool_.start(2);
+    // Tempo analysis queues behind its own thread so it never delays a load
+    analysis_pool_.start(1);
     
     std::cout << "Audio engine initialized successfully" << std::endl;
     return true;
@@ -177,9 +212,11 @@ bool AudioEngine::initialize() {
 
 void AudioEngine::shutdown() {
     running_ = false;
+    loader_pool_.stop();
+    analysis_pool_.stop();
     
-    if (audio_thread_.joinable()) {
-        audio_thread_.join();
+    if (housekeeping_thread_.joinable()) {
+        housekeeping_thread_.join();
     }
 
     if (audio_stream_) {
@@ -188,331 +225,697 @@ void AudioEngine::shutdown() {
         audio_stream_ = nullptr;
     }
     
+    // The callback has stopped, so every track can be freed here, and
+    // whatever it logged since the last housekeeping pass written out
+    releaseTracks();
+    rt_log_.drain();
+    
     Pa_Terminate();
     
     if (shared_memory_) {
+        // Tell readers the segment is no longer being updated
+        shared_state_->header.magic.store(0, std::memory_order_release);
+        shared_state_->~AudioState();
+        shared_state_ = nullptr;
 #ifdef _WIN32
         UnmapViewOfFile(shared_memory_);
 #else
         munmap(shared_memory_, shared_memory_size_);
         shm_unlink("/dj_audio_engine");
 #endif
+        shared_memory_ = nullptr;
     }
 }
 
 // Fix the setDeckPlaying function
 void AudioEngine::setDeckPlaying(int deck, bool playing) {
     if (!shared_state_) {
-        std::cout << "❌ setDeckPlaying: shared_state_ is null!" << std::endl;
+        logError("setDeckPlaying: engine not initialized");
         return;
     }
-    
-    std::cout << " C++ setDeckPlaying called: deck=" << deck << ", playing=" << (playing ? "true" : "false") << std::endl;
-    
-    if (deck >= 1 && deck <= 2) {
-        shared_state_->deck_playing[deck - 1].store(playing);
-        std::cout << "✅ C++ deck " << deck << " playing state set to: " << (playing ? "true" : "false") << std::endl;
-        
-        // Verify the value was set
-        bool actualValue = shared_state_->deck_playing[deck - 1].load();
-        std::cout << " Verified deck " << deck << " playing state: " << (actualValue ? "true" : "false") << std::endl;
-        
-        // Check if audio file is loaded
-        if (deck == 1) {
-            std::cout << " Deck 1 audio loaded: " << (deck1_audio_.loaded ? "true" : "false") << std::endl;
-            std::cout << " Deck 1 samples: " << deck1_audio_.leftChannel.size() << std::endl;
-        } else if (deck == 2) {
-            std::cout << " Deck 2 audio loaded: " << (deck2_audio_.loaded ? "true" : "false") << std::endl;
-            std::cout << " Deck 2 samples: " << deck2_audio_.leftChannel.size() << std::endl;
-        }
-    } else {
-        std::cout << "❌ Invalid deck number: " << deck << std::endl;
+    if (deck < 1 || deck > kMaxDecks) {
+        logError("setDeckPlaying: invalid deck number {}", deck);
+        return;
     }
+    
+    shared_state_->decks[deck - 1].playing.store(playing);
+    postParamEvent(ParamType::Playing, deck - 1, 0, playing ? 1.0f : 0.0f);
+    logDebug("Deck {} playing: {} ({} frames loaded)", deck, playing, mixer_.deck(deck - 1).frames.load());
 }
 
 void AudioEngine::setDeckVolume(int deck, float volume) {
-    if (deck == 1) {
-        shared_state_->deck1_volume = volume;
-    } else if (deck == 2) {
-        shared_state_->deck2_volume = volume;
-    }
+    if (!shared_state_ || deck < 1 || deck > kMaxDecks) return;
+    shared_state_->decks[deck - 1].volume = volume;
+    postParamEvent(ParamType::Volume, deck - 1, 0, volume);
 }
 
 void AudioEngine::setDeckPitch(int deck, float pitch) {
-    if (deck == 1) {
-        shared_state_->deck1_pitch = pitch;
-    } else if (deck == 2) {
-        shared_state_->deck2_pitch = pitch;
-    }
+    if (!shared_state_ || deck < 1 || deck > kMaxDecks) return;
+    shared_state_->decks[deck - 1].pitch = pitch;
+    postParamEvent(ParamType::Pitch, deck - 1, 0, pitch);
+}
+
+void AudioEngine::setDeckKeyLock(int deck, bool enabled) {
+    if (!shared_state_ || deck < 1 || deck > kMaxDecks) return;
+    shared_state_->decks[deck - 1].keyLock = enabled;
+    postParamEvent(ParamType::KeyLock, deck - 1, 0, enabled ? 1.0f : 0.0f);
+}
+
+void AudioEngine::setAnalysisCache(const std::string& directory, int maxMegabytes) {
+    analysis_cache_.setDirectory(directory, static_cast<uint64_t>(std::max(maxMegabytes, 0)) << 20);
+    logInfo("Analysis cache: {}", directory.empty() ? "off" : directory.c_str());
+}
+
+void AudioEngine::setDeckSync(int deck, bool enabled) {
+    if (!shared_state_ || deck < 1 || deck > kTrackDecks) return;
+    shared_state_->decks[deck - 1].sync = enabled;
+    postParamEvent(ParamType::Sync, deck - 1, 0, enabled ? 1.0f : 0.0f);
 }
 
-// Fix the setDeckPosition function
+// Sample slots have no tempo to follow, so only track decks can lead
+void AudioEngine::setSyncLeader(int deck) {
+    if (!shared_state_ || deck < 1 || deck > kTrackDecks) return;
+    shared_state_->master.syncLeader = deck;
+    postParamEvent(ParamType::SyncLeader, deck - 1, 0, 0.0f);
+}
+
+// Seeks are applied by the callback so they never race with its own position update
 void AudioEngine::setDeckPosition(int deck, float position) {
     if (!shared_state_) return;
     
-    if (deck >= 1 && deck <= 2) {
-        int deckIndex = deck - 1;
-        AudioFile* audioFile = (deckIndex == 0) ? &deck1_audio_ : &deck2_audio_;
-        
-        if (audioFile->loaded) {
-            int totalSamples = audioFile->leftChannel.size();
-            int newPosition = static_cast<int>(position * totalSamples);
-            if (deckIndex == 0) {
-                deck1_position_.store(newPosition);
-            } else {
-                deck2_position_.store(newPosition);
-            }
-        }
-    }
+    postParamEvent(ParamType::Position, deck - 1, 0, position);
 }
 
+// The fraction of the track being heard right now
 float AudioEngine::getDeckPosition(int deck) {
-    if (!shared_state_) return 0.0f;
-    
-    if (deck >= 1 && deck <= 2) {
-        int deckIndex = deck - 1;
-        AudioFile* audioFile = (deckIndex == 0) ? &deck1_audio_ : &deck2_audio_;
-        
-        if (audioFile->loaded) {
-            int totalSamples = audioFile->leftChannel.size();
-            size_t currentPos = (deckIndex == 0) ? deck1_position_.load() : deck2_position_.load();
-            return static_cast<float>(currentPos) / totalSamples;
-        }
-    }
-    
-    return 0.0f;
+    PlayheadClock clock;
+    if (!getDeckClock(deck, clock) || clock.durationFrames == 0) return 0.0f;
+    return static_cast<float>(playheadPositionAt(clock, steadyClockNs()) / clock.durationFrames);
+}
+
+bool AudioEngine::getDeckClock(int deck, PlayheadClock& clock) const {
+    if (!shared_state_ || deck < 1 || deck > kMaxDecks) return false;
+    clock = playheadClock(shared_state_->deckTelemetry[deck - 1].snapshot.load());
+    return true;
+}
+
+// Meters are read from the shared-memory snapshots, so polling them never
+// touches the audio thread's own state
+bool AudioEngine::getDeckMeter(int deck, MeterReading& reading) const {
+    if (!shared_state_ || deck < 1 || deck > kMaxDecks) return false;
+    reading = shared_state_->deckTelemetry[deck - 1].meter.load();
+    return true;
+}
+
+bool AudioEngine::getMasterMeter(MeterReading& reading) const {
+    if (!shared_state_) return false;
+    reading = shared_state_->engine.masterMeter.load();
+    return true;
+}
+
+int AudioEngine::getDeckLoadState(int deck) {
+    if (deck < 1 || deck > kMaxDecks) return LoadIdle;
+    return load_status_[deck - 1].state.load();
+}
+
+float AudioEngine::getDeckLoadProgress(int deck) {
+    if (deck < 1 || deck > kMaxDecks) return 0.0f;
+    return load_status_[deck - 1].progress.load();
+}
+
+bool AudioEngine::getDeckBeatgrid(int deck, BeatGrid& grid) {
+    if (deck < 1 || deck > kMaxDecks) return false;
+    TrackBeatgrid entry = load_status_[deck - 1].beatgrid.load();
+    if (!entry.track) return false;
+    grid = entry.grid;
+    return true;
 }
 
-// Fix the setDeckFile function
+bool AudioEngine::getDeckKey(int deck, KeyEstimate& key) {
+    if (deck < 1 || deck > kMaxDecks) return false;
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    const DeckLoadStatus& status = load_status_[deck - 1];
+    if (!status.hasKey) return false;
+    key = status.key;
+    return true;
+}
+
+float AudioEngine::getDeckPhaseError(int deck) const {
+    if (!shared_state_ || deck < 1 || deck > kMaxDecks) return 0.0f;
+    return shared_state_->deckTelemetry[deck - 1].snapshot.load().phaseError;
+}
+
+std::shared_ptr<const WaveformPyramid> AudioEngine::getDeckWaveform(int deck) {
+    if (deck < 1 || deck > kMaxDecks) return nullptr;
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    return load_status_[deck - 1].waveform;
+}
+
+// Queue a load on the loader pool; the deck keeps playing its current track
+// until the new one is ready
 void AudioEngine::setDeckFile(int deck, const std::string& filepath) {
     if (!shared_state_) {
-        std::cout << "❌ setDeckFile: shared_state_ is null!" << std::endl;
+        logError("setDeckFile: engine not initialized");
         return;
     }
     
-    std::cout << " Loading audio file for deck " << deck << ": " << filepath << std::endl;
+    logInfo("Loading audio file for deck {}: {}", deck, filepath.c_str());
     
-    if (deck >= 1 && deck <= 2) {
-        // Reset position when loading new file
-        if (deck == 1) {
-            deck1_position_.store(0);
-        } else {
-            deck2_position_.store(0);
+    if (deck >= 1 && deck <= kMaxDecks) {
+        int deckIndex = deck - 1;
+        DeckLoadStatus& status = load_status_[deckIndex];
+        uint32_t generation = status.generation.fetch_add(1) + 1;
+        status.progress.store(0.0f);
+        status.state.store(LoadLoading);
+        
+        bool queued = loader_pool_.submit([this, deckIndex, filepath, generation] {
+            loadDeckTrack(deckIndex, filepath, generation);
+        });
+        if (!queued) {
+            logError("Loader not running, cannot load deck {}", deck);
+            status.state.store(LoadFailed);
         }
+    }
+}
+
+// Play a sample slot from the start, restarting it if it is already playing
+void AudioEngine::triggerSample(int deck) {
+    if (!shared_state_ || deck < 1 || deck > kMaxDecks || !isSampleSlot(deck - 1)) return;
+    
+    beginParameterBatch();
+    postParamEvent(ParamType::Position, deck - 1, 0, 0.0f);
+    postParamEvent(ParamType::Playing, deck - 1, 0, 1.0f);
+    endParameterBatch();
+    shared_state_->decks[deck - 1].playing.store(true);
+}
+
+// Runs on a loader thread
+void AudioEngine::loadDeckTrack(int deckIndex, const std::string& filepath, uint32_t generation) {
+    DeckLoadStatus& status = load_status_[deckIndex];
+    std::unique_ptr<AudioFile> track(new AudioFile());
+    bool loaded = loadAudioFile(filepath, *track, &status.progress);
+    CacheKey cacheKey;
+    CachedAnalysis cached;
+    bool cacheHit = false;
+    std::shared_ptr<TrackAnalyzers> analyzers;
+    if (loaded) {
+        prepareTrackRate(*track);
         
-        // Load the audio file
-        AudioFile* audioFile = (deck == 1) ? &deck1_audio_ : &deck2_audio_;
-        if (loadAudioFile(filepath, *audioFile)) {
-            std::cout << "✅ Successfully loaded audio file for deck " << deck << std::endl;
+        // Cached results only count if they describe the frames as converted now
+        cacheHit = analysis_cache_.makeKey(filepath, cacheKey) && analysis_cache_.lookup(cacheKey, cached) &&
+                   cached.frameCount == track->frameCount && cached.sampleRate == track->sampleRate;
+        if (cacheHit) {
+            logDebug("Analysis cache hit, skipping waveform and analysis");
         } else {
-            std::cout << "❌ Failed to load audio file for deck " << deck << std::endl;
+            // Built from the final frames, so points and beats line up with deck
+            // positions. The analyzers keep their own reduced copies of the track,
+            // since the track itself belongs to the callback once published.
+            analyzers = std::make_shared<TrackAnalyzers>();
+            analyzers->cacheKey = cacheKey;
+            analyzers->results.frameCount = track->frameCount;
+            analyzers->results.sampleRate = track->sampleRate;
+            if (track->isStreamed()) {
+                // Decoding the whole track here would hold the deck back
+                analyzers->streamedPath = filepath;
+            } else {
+                // A paged track only holds the pages near its playhead, so
+                // scan a mapping of the file instead
+                const AudioFile* source = track.get();
+                AudioFile mapped;
+                std::string error;
+                if (track->isPaged() && readWavFile(filepath, mapped, SampleStorage::Mapped, 0, error)) {
+                    source = &mapped;
+                }
+                std::shared_ptr<WaveformPyramid> waveform = std::make_shared<WaveformPyramid>();
+                waveform->build(*source);
+                logDebug("Built waveform overview ({} KB)", waveform->byteSize() / 1024);
+                analyzers->beats.setSource(*source);
+                analyzers->key.setSource(*source);
+                analyzers->results.waveform = waveform;
+            }
         }
     }
+    
+    // Only the most recent request for a deck may publish
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    if (status.generation.load() != generation) {
+        return;
+    }
+    
+    if (!loaded) {
+        logError("Failed to load audio file for deck {}", deckIndex + 1);
+        status.state.store(LoadFailed);
+        return;
+    }
+    
+    // Replace the old grid before the callback can see the new track. A
+    // pending track the callback never picked up was never played; free it
+    // here.
+    AudioFile* published = track.get();
+    TrackBeatgrid entry = {};
+    if (cacheHit && cached.hasBeatgrid) {
+        entry.grid = cached.beatgrid;
+        entry.track = published;
+    }
+    status.beatgrid.store(entry);
+    status.key = cached.key;
+    status.hasKey = cacheHit && cached.hasKey;
+    AudioFile* superseded = status.pending.exchange(track.release(), std::memory_order_acq_rel);
+    delete superseded;
+    status.waveform = cacheHit ? cached.waveform : analyzers->results.waveform;
+    
+    status.progress.store(1.0f);
+    status.state.store(LoadReady);
+    logInfo("Loaded audio file for deck {}", deckIndex + 1);
+    
+    if (!cacheHit) {
+        analysis_pool_.submit([this, deckIndex, generation, published, analyzers] {
+            analyzeDeckTrack(deckIndex, generation, published, *analyzers);
+        });
+    }
 }
 
-void AudioEngine::setEffect(int deck, int effect, bool enabled) {
-    if (deck == 1) {
-        switch (effect) {
-            case 0: shared_state_->deck1_flanger = enabled; break;
-            case 1: shared_state_->deck1_filter = enabled; break;
-            case 2: shared_state_->deck1_echo = enabled; break;
-            case 3: shared_state_->deck1_reverb = enabled; break;
-        }
-    } else if (deck == 2) {
-        switch (effect) {
-            case 0: shared_state_->deck2_flanger = enabled; break;
-            case 1: shared_state_->deck2_filter = enabled; break;
-            case 2: shared_state_->deck2_echo = enabled; break;
-            case 3: shared_state_->deck2_reverb = enabled; break;
+// Runs on the analysis thread. `track` only identifies the published track
+// and is never dereferenced, as it may already have been retired. The
+// beatgrid is published first, since sync needs it; the key follows, and
+// then everything is saved to the analysis cache.
+void AudioEngine::analyzeDeckTrack(int deckIndex, uint32_t generation, const AudioFile* track,
+                                   TrackAnalyzers& analyzers) {
+    DeckLoadStatus& status = load_status_[deckIndex];
+    if (status.generation.load() != generation) return;
+    if (!analyzers.streamedPath.empty() && !prepareStreamedAnalysis(deckIndex, generation, analyzers)) return;
+    
+    CachedAnalysis& results = analyzers.results;
+    const BeatGrid& grid = results.beatgrid;
+    results.hasBeatgrid = analyzers.beats.analyze(results.beatgrid);
+    {
+        std::lock_guard<std::mutex> lock(publish_mutex_);
+        if (status.generation.load() != generation) return;
+        TrackBeatgrid entry = {};
+        if (results.hasBeatgrid) {
+            entry.grid = grid;
+            entry.track = track;
         }
+        status.beatgrid.store(entry);
     }
+    if (results.hasBeatgrid) {
+        logInfo("Deck {}: {} BPM (confidence {})", deckIndex + 1, grid.bpm, grid.confidence);
+    } else {
+        logInfo("Deck {}: no tempo found", deckIndex + 1);
+    }
+    
+    const KeyEstimate& key = results.key;
+    results.hasKey = analyzers.key.analyze(results.key);
+    {
+        std::lock_guard<std::mutex> lock(publish_mutex_);
+        if (status.generation.load() != generation) return;
+        status.key = key;
+        status.hasKey = results.hasKey;
+    }
+    if (results.hasKey) {
+        logInfo("Deck {}: {} ({}, confidence {})", deckIndex + 1, key.name, key.camelot, key.confidence);
+    } else {
+        logInfo("Deck {}: no key found", deckIndex + 1);
+    }
+    
+    analysis_cache_.store(analyzers.cacheKey, results);
 }
 
-void AudioEngine::setEQ(int deck, int band, float value) {
-    if (deck == 1) {
-        switch (band) {
-            case 0: shared_state_->deck1_low_eq = value; break;
-            case 1: shared_state_->deck1_mid_eq = value; break;
-            case 2: shared_state_->deck1_high_eq = value; break;
-        }
-    } else if (deck == 2) {
-        switch (band) {
-            case 0: shared_state_->deck2_low_eq = value; break;
-            case 1: shared_state_->deck2_mid_eq = value; break;
-            case 2: shared_state_->deck2_high_eq = value; break;
-        }
+// Runs on the analysis thread: one decoding pass for the waveform and one for
+// each analyzer's reduced copy, through a decoder of its own so the deck's
+// stream is left alone
+bool AudioEngine::prepareStreamedAnalysis(int deckIndex, uint32_t generation, TrackAnalyzers& analyzers) {
+    std::string error;
+    std::unique_ptr<AudioDecoder> decoder = openAudioDecoder(analyzers.streamedPath, error);
+    if (!decoder) {
+        logWarning("Streamed analysis: {}", error.c_str());
+        return false;
+    }
+    
+    size_t frames = analyzers.results.frameCount;
+    int rate = analyzers.results.sampleRate;
+    DecoderFrameReader reader(*decoder);
+    std::shared_ptr<WaveformPyramid> waveform = std::make_shared<WaveformPyramid>();
+    waveform->build(frames, rate, std::ref(reader));
+    {
+        DeckLoadStatus& status = load_status_[deckIndex];
+        std::lock_guard<std::mutex> lock(publish_mutex_);
+        if (status.generation.load() != generation) return false;
+        status.waveform = waveform;
+    }
+    logDebug("Built waveform overview ({} KB)", waveform->byteSize() / 1024);
+    analyzers.results.waveform = waveform;
+    
+    analyzers.beats.setSource(frames, rate, std::ref(reader));
+    analyzers.key.setSource(frames, rate, std::ref(reader));
+    return true;
+}
+
+void AudioEngine::setResampleQuality(int quality) {
+    quality = std::min(std::max(quality, static_cast<int>(ResampleQuality::Draft)),
+                       static_cast<int>(ResampleQuality::High));
+    
+    // The callback may read the ladder as soon as the tier is stored
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    if (!sinc_ladders_[quality].isBuilt()) {
+        sinc_ladders_[quality].build(static_cast<ResampleQuality>(quality), kMaxReadStep);
+    }
+    resample_quality_ = quality;
+}
+
+void AudioEngine::setSampleStorage(int storage) {
+    sample_storage_ = std::min(std::max(storage, static_cast<int>(SampleStorage::Mapped)),
+                               static_cast<int>(SampleStorage::Float));
+}
+
+void AudioEngine::setPageCacheSize(int megabytes) {
+    page_cache_.setBudget(static_cast<size_t>(std::max(megabytes, 0)) << 20);
+}
+
+void AudioEngine::setInterpolation(int mode) {
+    interpolation_mode_ = std::min(std::max(mode, static_cast<int>(InterpolationMode::Linear)),
+                                   static_cast<int>(InterpolationMode::Sinc));
+}
+
+// Match a track to the output rate. Tracks held as float are converted once
+// here; tracks read from PCM or a decoder (or all tracks with load-time
+// conversion off) are converted block by block by the deck's playhead in the
+// callback.
+void AudioEngine::prepareTrackRate(AudioFile& track) {
+    if (track.sampleRate == sample_rate_) return;
+    
+    double step = static_cast<double>(track.sampleRate) / sample_rate_;
+    if (step > kMaxSourceStep) {
+        logWarning("Sample rate {} Hz too high to play back", track.sampleRate);
+        return;
+    }
+    
+    ResampleQuality quality = static_cast<ResampleQuality>(resample_quality_.load());
+    if (track.isDecoded() && resample_at_load_.load()) {
+        std::vector<float> left, right;
+        resampleStereo(track.leftChannel, track.rightChannel, left, right, step, quality);
+        track.leftChannel.swap(left);
+        track.rightChannel.swap(right);
+        track.frameCount = track.leftChannel.size();
+        track.sampleRate = sample_rate_;
+        logDebug("Resampled track to {} Hz at load", sample_rate_);
+    } else {
+        logDebug("Track will be resampled from {} Hz while playing", track.sampleRate);
+    }
+}
+
+// Runs on the audio thread at the start of a block
+void AudioEngine::adoptPendingTrack(int deckIndex) {
+    std::atomic<AudioFile*>& pending = load_status_[deckIndex].pending;
+    if (pending.load(std::memory_order_relaxed) == nullptr) return;
+    
+    // Retire the outgoing track first; if the queue is full try again next block
+    DeckState& state = mixer_.deck(deckIndex);
+    AudioFile* outgoing = state.track.load(std::memory_order_relaxed);
+    if (outgoing && !retired_tracks_.push(outgoing)) return;
+    
+    AudioFile* incoming = pending.exchange(nullptr, std::memory_order_acq_rel);
+    state.track.store(incoming, std::memory_order_release);
+    state.frames.store(incoming->frameCount);
+    state.resampler.reset();
+    if (state.stretcher) state.stretcher->reset();
+    state.grid = BeatGrid{};
+    
+    // Reset position when loading new file
+    state.position.store(0);
+    
+    // Publish only after active_track_ no longer points at the outgoing track
+    retired_tracks_.publish();
+}
+
+void AudioEngine::releaseTracks() {
+    while (AudioFile* const* retired = retired_tracks_.front()) {
+        delete *retired;
+        retired_tracks_.pop();
+    }
+    for (int deck = 0; deck < kMaxDecks; deck++) {
+        delete load_status_[deck].pending.exchange(nullptr);
+        delete mixer_.deck(deck).track.exchange(nullptr);
+        mixer_.deck(deck).frames.store(0);
     }
 }
 
+void AudioEngine::setEffect(int deck, int effect, bool enabled) {
+    if (!shared_state_ || deck < 1 || deck > kMaxDecks || effect < 0 || effect >= 4) return;
+    shared_state_->decks[deck - 1].effects[effect] = enabled;
+    postParamEvent(ParamType::Effect, deck - 1, effect, enabled ? 1.0f : 0.0f);
+}
+
+void AudioEngine::setEQ(int deck, int band, float value) {
+    if (!shared_state_ || deck < 1 || deck > kMaxDecks || band < 0 || band >= 3) return;
+    shared_state_->decks[deck - 1].eq[band] = value;
+    postParamEvent(ParamType::EQ, deck - 1, band, value);
+}
+
 void AudioEngine::setCrossfader(float value) {
-    shared_state_->crossfader = value;
+    if (!shared_state_) return;
+    shared_state_->master.crossfader = value;
+    postParamEvent(ParamType::Crossfader, 0, 0, value);
 }
 
 void AudioEngine::setMasterVolume(float volume) {
-    shared_state_->master_volume = volume;
+    if (!shared_state_) return;
+    shared_state_->master.masterVolume = volume;
+    postParamEvent(ParamType::MasterVolume, 0, 0, volume);
 }
 
 void AudioEngine::setHeadphoneVolume(float volume) {
-    shared_state_->headphone_volume = volume;
+    if (!shared_state_) return;
+    shared_state_->master.headphoneVolume = volume;
+    postParamEvent(ParamType::HeadphoneVolume, 0, 0, volume);
 }
 
-void AudioEngine::audioThread() {
-    while (running_) {
-        processAudio();
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    }
+void AudioEngine::clearClipIndicators() {
+    postParamEvent(ParamType::ClearClip, 0, 0, 0.0f);
 }
 
-void AudioEngine::processAudio() {
-    // This is where you'd implement actual audio processing
-    // For now, just update positions using proper atomic operations
-    if (shared_state_->deck_playing[0].load()) {
-        float current_pos = shared_state_->deck1_position.load();
-        shared_state_->deck1_position.store(current_pos + 0.01f); // Simulate playback
+void AudioEngine::beginParameterBatch() {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    if (batch_depth_++ == 0) {
+        batch_time_ = estimateEventTime();
     }
-    if (shared_state_->deck_playing[1].load()) {
-        float current_pos = shared_state_->deck2_position.load();
-        shared_state_->deck2_position.store(current_pos + 0.01f);
+}
+
+void AudioEngine::endParameterBatch() {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    if (batch_depth_ > 0 && --batch_depth_ == 0) {
+        param_queue_.publish();
     }
 }
 
-bool AudioEngine::loadWavFile(const std::string& filepath, AudioFile& audioFile) {
-    std::ifstream file(filepath, std::ios::binary);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open file: " << filepath << std::endl;
-        return false;
+// Estimate the frame that is audible "now" from the last block start and add one
+// buffer, so every event lands with the same latency instead of buffer jitter
+uint64_t AudioEngine::estimateEventTime() {
+    uint64_t frame;
+    int64_t startNs;
+    do {
+        frame = frame_clock_.load(std::memory_order_acquire);
+        startNs = block_start_ns_.load(std::memory_order_acquire);
+    } while (frame != frame_clock_.load(std::memory_order_acquire));
+    
+    uint64_t time = frame + buffer_size_;
+    if (startNs != 0) {
+        int64_t elapsed = std::max<int64_t>(0, steadyClockNs() - startNs);
+        time += std::min<uint64_t>(elapsed * sample_rate_ / 1000000000LL, buffer_size_);
     }
     
-    std::cout << "📁 Opening WAV file: " << filepath << std::endl;
-    
-    // Read WAV header
-    char header[44];
-    file.read(header, 44);
-    
-    // Check RIFF header
-    if (strncmp(header, "RIFF", 4) != 0) {
-        std::cerr << "Not a valid WAV file (missing RIFF header)" << std::endl;
-        return false;
+    // Keep timestamps monotonic so the queue stays ordered
+    time = std::max(time, last_event_time_);
+    last_event_time_ = time;
+    return time;
+}
+
+void AudioEngine::postParamEvent(ParamType type, int deck, int index, float value) {
+    if (deck < 0 || deck >= kMaxDecks) return;
+    
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    ParamEvent event;
+    event.time = (batch_depth_ > 0) ? batch_time_ : estimateEventTime();
+    event.type = type;
+    event.deck = static_cast<uint8_t>(deck);
+    event.index = static_cast<uint8_t>(index);
+    event.value = value;
+    
+    if (!param_queue_.push(event)) {
+        logWarning("Parameter queue full, dropping event");
+        return;
     }
-    
-    // Check WAVE format
-    if (strncmp(header + 8, "WAVE", 4) != 0) {
-        std::cerr << "Not a valid WAV file (missing WAVE format)" << std::endl;
-        return false;
+    if (batch_depth_ == 0) {
+        param_queue_.publish();
     }
-    
-    std::cout << "✅ WAV file header validated" << std::endl;
-    
-    // Find fmt chunk
-    uint32_t chunkSize = 0;
-    uint32_t dataSize = 0;
-    uint32_t sampleRate = 0;
-    uint16_t channels = 0;
-    uint16_t bitsPerSample = 0;
-    
-    // Parse chunks
-    uint32_t offset = 12;
-    while (offset < 44) {
-        char chunkId[4];
-        memcpy(chunkId, header + offset, 4);
-        uint32_t chunkSize;
-        memcpy(&chunkSize, header + offset + 4, 4);
-        
-        if (strncmp(chunkId, "fmt ", 4) == 0) {
-            // Parse fmt chunk
-            uint16_t audioFormat;
-            memcpy(&audioFormat, header + offset + 8, 2);
-            memcpy(&channels, header + offset + 10, 2);
-            memcpy(&sampleRate, header + offset + 12, 4);
-            memcpy(&bitsPerSample, header + offset + 22, 2);
-            
-            std::cout << "WAV Format: " << audioFormat << ", Channels: " << channels 
-                      << ", Sample Rate: " << sampleRate << ", Bits: " << bitsPerSample << std::endl;
-        } else if (strncmp(chunkId, "data", 4) == 0) {
-            dataSize = chunkSize;
+}
+
+// Runs on the audio thread
+void AudioEngine::applyParamEvent(const ParamEvent& event) {
+    DeckState& state = mixer_.deck(event.deck);
+    DeckControls& controls = state.controls;
+    
+    switch (event.type) {
+        case ParamType::Playing:
+            controls.playing = event.value != 0.0f;
+            break;
+        case ParamType::Volume:
+            controls.volume = event.value;
+            break;
+        case ParamType::Pitch:
+            controls.pitch = event.value;
+            break;
+        case ParamType::Position: {
+            const AudioFile* audioFile = state.track.load(std::memory_order_relaxed);
+            if (audioFile) {
+                size_t totalSamples = audioFile->frameCount;
+                float position = std::min(std::max(event.value, 0.0f), 1.0f);
+                size_t newPosition = static_cast<size_t>(position * totalSamples);
+                state.position.store(newPosition);
+                state.resampler.reset();
+                if (state.stretcher) state.stretcher->reset();
+            }
             break;
         }
-        
-        offset += 8 + chunkSize;
-    }
-    
-    if (dataSize == 0) {
-        std::cerr << "No data chunk found in WAV file" << std::endl;
-        return false;
-    }
-    
-    std::cout << "📊 Data size: " << dataSize << " bytes" << std::endl;
-    
-    // Read audio data
-    std::vector<char> audioData(dataSize);
-    file.read(audioData.data(), dataSize);
-    file.close();
-    
-    std::cout << "📖 Read " << audioData.size() << " bytes of audio data" << std::endl;
-    
-    // Convert to float samples
-    audioFile.sampleRate = sampleRate;
-    audioFile.channels = channels;
-    audioFile.duration = static_cast<float>(dataSize) / (sampleRate * channels * (bitsPerSample / 8));
-    
-    if (channels == 1) {
-        // Mono
-        audioFile.leftChannel.reserve(dataSize / (bitsPerSample / 8));
-        audioFile.rightChannel.reserve(dataSize / (bitsPerSample / 8));
-        
-        if (bitsPerSample == 16) {
-            int16_t* samples = reinterpret_cast<int16_t*>(audioData.data());
-            int sampleCount = dataSize / 2;
-            
-            for (int i = 0; i < sampleCount; i++) {
-                float sample = static_cast<float>(samples[i]) / 32768.0f;
-                audioFile.leftChannel.push_back(sample);
-                audioFile.rightChannel.push_back(sample); // Duplicate for stereo
+        case ParamType::Effect:
+            if (event.index < 4) {
+                controls.effects[event.index] = event.value != 0.0f;
+                if (state.processor) state.processor->setEffect(event.index, controls.effects[event.index]);
             }
-        } else if (bitsPerSample == 32) {
-            int32_t* samples = reinterpret_cast<int32_t*>(audioData.data());
-            int sampleCount = dataSize / 4;
-            
-            for (int i = 0; i < sampleCount; i++) {
-                float sample = static_cast<float>(samples[i]) / 2147483648.0f;
-                audioFile.leftChannel.push_back(sample);
-                audioFile.rightChannel.push_back(sample); // Duplicate for stereo
+            break;
+        case ParamType::EQ:
+            if (event.index < 3) {
+                controls.eq[event.index] = event.value;
+                if (state.processor) state.processor->setEQ(event.index, event.value);
+            }
+            break;
+        case ParamType::Crossfader:
+            crossfader_ = event.value;
+            break;
+        case ParamType::MasterVolume:
+            master_volume_ = event.value;
+            break;
+        case ParamType::HeadphoneVolume:
+            headphone_volume_ = event.value;
+            break;
+        case ParamType::KeyLock:
+            // Start from an empty stretcher so no stale audio is replayed
+            controls.keyLock = event.value != 0.0f;
+            if (state.stretcher) state.stretcher->reset();
+            break;
+        case ParamType::Sync:
+            controls.sync = event.value != 0.0f;
+            break;
+        case ParamType::SyncLeader:
+            sync_leader_ = event.deck;
+            break;
+        case ParamType::ClearClip:
+            for (int deck = 0; deck < kMaxDecks; deck++) {
+                mixer_.deck(deck).meter->clearMaxTruePeak();
             }
+            master_meter_->clearMaxTruePeak();
+            break;
+    }
+}
+
+// Frees tracks retired by the callback, keeps the pages ahead of each mapped
+// or paged deck's playhead resident, so the callback converts from memory
+// instead of faulting on disk reads, and decodes ahead of each streamed deck
+void AudioEngine::housekeepingThread() {
+    const size_t lookaheadFrames = static_cast<size_t>(sample_rate_) * 4;
+    // Per deck and pass, so one deck catching up after a seek can't starve the others
+    const size_t decodeBudget = static_cast<size_t>(sample_rate_) / 2;
+    
+    while (running_) {
+        // Tracks are only ever deleted on this thread, so the pointers loaded
+        // below stay valid until the next iteration
+        while (AudioFile* const* retired = retired_tracks_.front()) {
+            delete *retired;
+            retired_tracks_.pop();
         }
-    } else if (channels == 2) {
-        // Stereo
-        audioFile.leftChannel.reserve(dataSize / (bitsPerSample / 8) / 2);
-        audioFile.rightChannel.reserve(dataSize / (bitsPerSample / 8) / 2);
+        rt_log_.drain();
         
-        if (bitsPerSample == 16) {
-            int16_t* samples = reinterpret_cast<int16_t*>(audioData.data());
-            int sampleCount = dataSize / 4; // 2 channels * 2 bytes per sample
-            
-            for (int i = 0; i < sampleCount; i += 2) {
-                float leftSample = static_cast<float>(samples[i]) / 32768.0f;
-                float rightSample = static_cast<float>(samples[i + 1]) / 32768.0f;
-                audioFile.leftChannel.push_back(leftSample);
-                audioFile.rightChannel.push_back(rightSample);
-            }
-        } else if (bitsPerSample == 32) {
-            int32_t* samples = reinterpret_cast<int32_t*>(audioData.data());
-            int sampleCount = dataSize / 8; // 2 channels * 4 bytes per sample
+        bool readingAhead = false;
+        for (int deck = 0; deck < kMaxDecks; deck++) {
+            const DeckState& state = mixer_.deck(deck);
+            const AudioFile* audioFile = state.track.load(std::memory_order_acquire);
+            if (!audioFile) continue;
             
-            for (int i = 0; i < sampleCount; i += 2) {
-                float leftSample = static_cast<float>(samples[i]) / 2147483648.0f;
-                float rightSample = static_cast<float>(samples[i + 1]) / 2147483648.0f;
-                audioFile.leftChannel.push_back(leftSample);
-                audioFile.rightChannel.push_back(rightSample);
+            if (audioFile->isStreamed()) {
+                audioFile->stream->service(decodeBudget);
+                readingAhead = true;
+            } else if (audioFile->isPaged()) {
+                size_t position = state.position.load();
+                page_cache_.fill(*audioFile->paged, position, position + lookaheadFrames);
+                readingAhead = true;
+            } else if (audioFile->isMapped()) {
+                size_t position = state.position.load();
+                size_t base = audioFile->pcmData - audioFile->mapping->data();
+                audioFile->mapping->prefetch(base + audioFile->byteOffset(position),
+                                             audioFile->byteOffset(lookaheadFrames));
             }
         }
+        // A seek on a streamed or paged deck plays silence until the next pass
+        std::this_thread::sleep_for(std::chrono::milliseconds(readingAhead ? 5 : 20));
+    }
+}
+
+bool AudioEngine::loadWavFile(const std::string& filepath, AudioFile& audioFile, std::atomic<float>* progress) {
+    // Only float storage converts up front; otherwise the PCM stays in the OS
+    // page cache, in memory or on disk and the deck converts it as it reads
+    static const char* const kStorageNames[] = {"mapped", "compact", "paged", "float"};
+    int storage = sample_storage_.load();
+    logDebug("Opening WAV file: {} ({})", filepath.c_str(), kStorageNames[storage]);
+    
+    std::string error;
+    if (!readWavFile(filepath, audioFile, static_cast<SampleStorage>(storage), 0, error, progress, &page_cache_)) {
+        logError("{}", error.c_str());
+        return false;
     }
     
+    logDebug("Loaded {} samples ({} channels, {} Hz, {} decode)", audioFile.frameCount, audioFile.channels,
+             audioFile.sampleRate, pcmKernelName());
+    if (audioFile.isPaged()) {
+        // So the deck starts from the top without waiting for the housekeeping thread
+        page_cache_.fill(*audioFile.paged, 0, static_cast<size_t>(audioFile.sampleRate) * 4);
+    }
+    if (audioFile.packedPcm || audioFile.isDecoded()) {
+        double megabytes = audioFile.byteSize() / 1e6;
+        double hours = audioFile.frameCount / (audioFile.sampleRate * 3600.0);
+        logDebug("{} MB of samples in memory ({} MB per hour)", megabytes, hours > 0 ? megabytes / hours : 0.0);
+    }
+    return true;
+}
+
+// Compressed files are decoded a few seconds ahead of the deck rather than up front
+bool AudioEngine::loadStreamedFile(const std::string& filepath, AudioFile& audioFile) {
+    std::string error;
+    std::unique_ptr<AudioDecoder> decoder = openAudioDecoder(filepath, error);
+    if (!decoder) {
+        logError("{}", error.c_str());
+        return false;
+    }
+    logDebug("Opening {} file: {} (streamed)", decoder->formatName(), filepath.c_str());
+    
+    int channels = decoder->channels();
+    std::shared_ptr<DecodeStream> stream = std::make_shared<DecodeStream>(std::move(decoder));
+    if (!stream->open()) {
+        logError("Could not decode {}", filepath.c_str());
+        return false;
+    }
+    audioFile.stream = stream;
+    audioFile.frameCount = stream->frameCount();
+    audioFile.sampleRate = stream->sampleRate();
+    audioFile.channels = channels;
+    audioFile.duration = static_cast<float>(audioFile.frameCount) / audioFile.sampleRate;
     audioFile.loaded = true;
-    std::cout << "✅ Loaded " << audioFile.leftChannel.size() << " samples" << std::endl;
+    
+    logDebug("Streaming {} samples ({} channels, {} Hz, {} KB decoded at a time)", audioFile.frameCount, channels,
+             audioFile.sampleRate, stream->byteSize() / 1024);
     return true;
 }
 
-bool AudioEngine::loadAudioFile(const std::string& filepath, AudioFile& audioFile) {
+bool AudioEngine::loadAudioFile(const std::string& filepath, AudioFile& audioFile, std::atomic<float>* progress) {
     // Reset audio file
     audioFile = AudioFile();
     
@@ -521,14 +924,110 @@ bool AudioEngine::loadAudioFile(const std::string& filepath, AudioFile& audioFil
     std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
     
     if (extension == "wav") {
-        return loadWavFile(filepath, audioFile);
+        return loadWavFile(filepath, audioFile, progress);
+    } else if (isDecodableExtension(extension)) {
+        return loadStreamedFile(filepath, audioFile);
     } else {
-        std::cerr << "Unsupported audio format: " << extension << std::endl;
+        logError("Unsupported audio format: {}", extension.c_str());
         return false;
     }
 }
 
-// Add debug messages to the audioCallback function
+// Mix frames [start, end) of the output buffer with the current controls
+void AudioEngine::renderSegment(float* out, unsigned long start, unsigned long end) {
+    MixSettings settings;
+    settings.mode = static_cast<InterpolationMode>(interpolation_mode_.load(std::memory_order_relaxed));
+    settings.ladder = &sinc_ladders_[resample_quality_.load(std::memory_order_relaxed)];
+    mixer_.render(out, start, end, settings);
+    
+    // Apply master volume
+    for (unsigned long i = start * 2; i < end * 2; i++) {
+        out[i] *= master_volume_;
+    }
+}
+
+// Runs on the audio thread at the end of every block. Snapshots are seqlock
+// writes and ring records are wait-free pushes, so readers in other
+// processes never block the callback. `audibleNs` is when the block's first
+// frame will be heard.
+void AudioEngine::publishTelemetry(uint64_t blockStart, unsigned long frames, int64_t audibleNs,
+                                   PaStreamCallbackFlags statusFlags) {
+    TelemetryRing& ring = shared_state_->ring;
+    uint64_t blockEnd = blockStart + frames;
+    int64_t blockEndNs = audibleNs + static_cast<int64_t>(frames) * 1000000000LL / sample_rate_;
+    
+    if (statusFlags & (paOutputUnderflow | paOutputOverflow)) {
+        xruns_++;
+        rt_log_.warning("Output {} at frame {} ({} so far)",
+                        (statusFlags & paOutputUnderflow) ? "underflow" : "overflow", blockStart, xruns_);
+        TelemetryRecord record = {};
+        record.frameClock = blockStart;
+        record.position = xruns_;
+        record.type = static_cast<uint16_t>(TelemetryType::Xrun);
+        record.deck = kTelemetryMasterDeck;
+        record.flags = static_cast<uint32_t>(statusFlags);
+        ring.push(record);
+    }
+    
+    for (int deck = 0; deck < kMaxDecks; deck++) {
+        const DeckState& state = mixer_.deck(deck);
+        const AudioFile* audioFile = state.track.load(std::memory_order_relaxed);
+        size_t position = state.position.load(std::memory_order_relaxed);
+        
+        if (state.ended) {
+            TelemetryRecord record = {};
+            record.frameClock = blockStart + state.endedAt;
+            record.type = static_cast<uint16_t>(TelemetryType::EndOfTrack);
+            record.deck = static_cast<uint16_t>(deck);
+            ring.push(record);
+        }
+        
+        // Playing decks, plus a final record from a sample slot that just stopped
+        if (audioFile && (state.controls.playing || state.ended)) {
+            TelemetryRecord record = {};
+            record.frameClock = blockEnd;
+            record.position = position;
+            record.type = static_cast<uint16_t>(TelemetryType::Deck);
+            record.deck = static_cast<uint16_t>(deck);
+            record.peak[0] = state.peak[0];
+            record.peak[1] = state.peak[1];
+            record.rate = state.rate;
+            ring.push(record);
+        }
+        
+        DeckTelemetry telemetry = {};
+        telemetry.frameClock = blockEnd;
+        telemetry.positionFrames = position;
+        telemetry.audibleTimeNs = blockEndNs;
+        telemetry.framesPerSecond = state.controls.playing ? static_cast<double>(state.rate) * sample_rate_ : 0.0;
+        telemetry.durationFrames = audioFile ? audioFile->frameCount : 0;
+        telemetry.sampleRate = audioFile ? audioFile->sampleRate : 0;
+        telemetry.playing = state.controls.playing ? 1 : 0;
+        telemetry.following = state.syncTempo > 0.0 ? 1 : 0;
+        telemetry.phaseError = state.phaseError;
+        shared_state_->deckTelemetry[deck].snapshot.store(telemetry);
+        shared_state_->deckTelemetry[deck].meter.store(state.meter->getReading());
+    }
+    
+    TelemetryRecord master = {};
+    master.frameClock = blockEnd;
+    master.type = static_cast<uint16_t>(TelemetryType::Master);
+    master.deck = kTelemetryMasterDeck;
+    master.peak[0] = master_meter_->getBlockPeak(0);
+    master.peak[1] = master_meter_->getBlockPeak(1);
+    ring.push(master);
+    shared_state_->engine.masterMeter.store(master_meter_->getReading());
+    
+    EngineTelemetry engine = {};
+    engine.frameClock = blockEnd;
+    engine.audibleTimeNs = blockEndNs;
+    engine.callbacks = callbacks_;
+    engine.xruns = xruns_;
+    engine.sampleRate = sample_rate_;
+    engine.bufferSize = buffer_size_;
+    shared_state_->engine.snapshot.store(engine);
+}
+
 int AudioEngine::audioCallback(const void* inputBuffer, void* outputBuffer,
                               unsigned long framesPerBuffer,
                               const PaStreamCallbackTimeInfo* timeInfo,
@@ -537,129 +1036,92 @@ int AudioEngine::audioCallback(const void* inputBuffer, void* outputBuffer,
     AudioEngine* engine = static_cast<AudioEngine*>(userData);
     float* out = static_cast<float*>(outputBuffer);
     
-    // Add debug counter (only log every 1000 calls to avoid spam)
-    static int callbackCount = 0;
-    static float phase = 0.0f;
-    callbackCount++;
+    uint64_t blockStart = engine->frame_clock_.load(std::memory_order_relaxed);
+    int64_t nowNs = steadyClockNs();
+    engine->block_start_ns_.store(nowNs, std::memory_order_release);
     
-    if (callbackCount % 1000 == 0) {
-        std::cout << "🔊 Audio callback #" << callbackCount << " - Deck1: " 
-                  << engine->shared_state_->deck_playing[0].load() 
-                  << ", Deck2: " << engine->shared_state_->deck_playing[1].load() << std::endl;
+    // When this block starts playing: the stream's own DAC time where the
+    // host provides a plausible one, otherwise its reported latency
+    int64_t delayNs = engine->output_latency_ns_;
+    if (timeInfo) {
+        double delay = timeInfo->outputBufferDacTime - timeInfo->currentTime;
+        if (delay > 0.0 && delay < 1.0) delayNs = static_cast<int64_t>(delay * 1e9);
+    }
+    int64_t audibleNs = nowNs + delayNs;
+    
+    // Callbacks wake up with scheduling jitter, but the DAC takes blocks at an
+    // even pace. Follow the measured time slowly so the playhead clock moves
+    // steadily, and jump to it after a gap (the first block, or an xrun).
+    int64_t blockNs = static_cast<int64_t>(framesPerBuffer) * 1000000000LL / engine->sample_rate_;
+    int64_t expectedNs = engine->next_audible_ns_;
+    if (expectedNs != 0 && std::abs(audibleNs - expectedNs) < blockNs) {
+        audibleNs = expectedNs + (audibleNs - expectedNs) / 16;
+    }
+    engine->next_audible_ns_ = audibleNs + blockNs;
+    
+    uint64_t callback = engine->callbacks_ + 1;
+    if (callback % 1000 == 0) {
+        engine->rt_log_.debug("Audio callback #{}: deck 1 playing {}, deck 2 playing {}", callback,
+                              engine->mixer_.deck(0).controls.playing, engine->mixer_.deck(1).controls.playing);
     }
     
     // Clear output buffer
     memset(out, 0, framesPerBuffer * 2 * sizeof(float));
+    engine->mixer_.beginBlock();
     
-    // Play deck 1
-    if (engine->shared_state_->deck_playing[0].load()) {
-        if (engine->deck1_audio_.loaded) {
-            // Play actual audio file
-            size_t currentPos = engine->deck1_position_.load();
-            size_t totalSamples = engine->deck1_audio_.leftChannel.size();
-            
-            if (callbackCount <= 5) {
-                std::cout << "🎵 Playing actual audio from deck 1 - Pos: " << currentPos 
-                          << ", Total: " << totalSamples << std::endl;
-            }
-            
-            // Play audio data
-            for (unsigned long i = 0; i < framesPerBuffer; i++) {
-                if (currentPos + i < totalSamples) {
-                    // Apply volume control
-                    float volume = engine->shared_state_->deck1_volume.load();
-                    
-                    out[i * 2] += engine->deck1_audio_.leftChannel[currentPos + i] * volume;
-                    out[i * 2 + 1] += engine->deck1_audio_.rightChannel[currentPos + i] * volume;
-                }
-            }
-            
-            // Update position
-            engine->deck1_position_.store(currentPos + framesPerBuffer);
-            
-            // Loop if we reach the end
-            if (currentPos + framesPerBuffer >= totalSamples) {
-                engine->deck1_position_.store(0);
-            }
-        } else {
-            // Play test tone only if no audio file loaded
-            float frequency = 440.0f; // A4 note
-            float sampleRate = 44100.0f;
-            
-            for (unsigned long i = 0; i < framesPerBuffer; i++) {
-                float sample = 0.1f * sin(phase); // Low volume test tone
-                out[i * 2] = sample;     // Left channel
-                out[i * 2 + 1] = sample; // Right channel
-                phase += 2.0f * M_PI * frequency / sampleRate;
-                
-                if (phase >= 2.0f * M_PI) {
-                    phase -= 2.0f * M_PI;
-                }
-            }
-            
-            if (callbackCount <= 5) {
-                std::cout << "🔊 Generating test tone for deck 1 (no audio file loaded)" << std::endl;
+    // Switch to freshly loaded tracks before any events refer to them, and
+    // pick up beatgrids as analysis finishes. A grid being written right now
+    // is simply taken next block.
+    for (int deck = 0; deck < kMaxDecks; deck++) {
+        engine->adoptPendingTrack(deck);
+        
+        DeckState& state = engine->mixer_.deck(deck);
+        TrackBeatgrid entry;
+        if (engine->load_status_[deck].beatgrid.tryLoad(entry)) {
+            state.grid = (entry.track && entry.track == state.track.load(std::memory_order_relaxed))
+                ? entry.grid : BeatGrid{};
+        }
+    }
+    engine->mixer_.syncDecks(engine->sync_leader_, framesPerBuffer);
+    
+    // Drain the parameter queue once per buffer, splitting the buffer at each
+    // event's frame so changes land sample-accurately. Events in the same batch
+    // share a timestamp and are therefore applied together.
+    unsigned long frame = 0;
+    while (frame < framesPerBuffer) {
+        unsigned long segmentEnd = framesPerBuffer;
+        while (const ParamEvent* event = engine->param_queue_.front()) {
+            uint64_t due = (event->time > blockStart) ? event->time - blockStart : 0;
+            if (due > frame) {
+                segmentEnd = static_cast<unsigned long>(std::min<uint64_t>(due, framesPerBuffer));
+                break;
             }
+            engine->applyParamEvent(*event);
+            engine->param_queue_.pop();
         }
+        
+        engine->renderSegment(out, frame, segmentEnd);
+        frame = segmentEnd;
     }
     
-    // Play deck 2
-    if (engine->shared_state_->deck_playing[1].load()) {
-        if (engine->deck2_audio_.loaded) {
-            // Play actual audio file
-            size_t currentPos = engine->deck2_position_.load();
-            size_t totalSamples = engine->deck2_audio_.leftChannel.size();
-            
-            if (callbackCount <= 5) {
-                std::cout << "🎵 Playing actual audio from deck 2 - Pos: " << currentPos 
-                          << ", Total: " << totalSamples << std::endl;
-            }
-            
-            // Play audio data
-            for (unsigned long i = 0; i < framesPerBuffer; i++) {
-                if (currentPos + i < totalSamples) {
-                    // Apply volume control
-                    float volume = engine->shared_state_->deck2_volume.load();
-                    
-                    out[i * 2] += engine->deck2_audio_.leftChannel[currentPos + i] * volume;
-                    out[i * 2 + 1] += engine->deck2_audio_.rightChannel[currentPos + i] * volume;
-                }
-            }
-            
-            // Update position
-            engine->deck2_position_.store(currentPos + framesPerBuffer);
-            
-            // Loop if we reach the end
-            if (currentPos + framesPerBuffer >= totalSamples) {
-                engine->deck2_position_.store(0);
-            }
-        } else {
-            // Play test tone only if no audio file loaded
-            float frequency = 880.0f; // A5 note (different from deck 1)
-            float sampleRate = 44100.0f;
-            
-            for (unsigned long i = 0; i < framesPerBuffer; i++) {
-                float sample = 0.1f * sin(phase + M_PI); // Different phase for deck 2
-                out[i * 2] += sample;     // Left channel
-                out[i * 2 + 1] += sample; // Right channel
-                phase += 2.0f * M_PI * frequency / sampleRate;
-                
-                if (phase >= 2.0f * M_PI) {
-                    phase -= 2.0f * M_PI;
-                }
-            }
-            
-            if (callbackCount <= 5) {
-                std::cout << "🔊 Generating test tone for deck 2 (no audio file loaded)" << std::endl;
+    if (callback <= 5) {
+        for (int deck = 0; deck < kMaxDecks; deck++) {
+            const DeckState& state = engine->mixer_.deck(deck);
+            if (!state.controls.playing) continue;
+            const AudioFile* audioFile = state.track.load(std::memory_order_relaxed);
+            if (audioFile) {
+                engine->rt_log_.debug("Deck {} playing at frame {} of {}", deck + 1,
+                                      state.position.load(std::memory_order_relaxed), audioFile->frameCount);
+            } else {
+                engine->rt_log_.debug("Deck {} playing with no track loaded", deck + 1);
             }
         }
     }
     
-    // Apply master volume
-    float masterVolume = engine->shared_state_->master_volume.load();
-    for (unsigned long i = 0; i < framesPerBuffer * 2; i++) {
-        out[i] *= masterVolume;
-    }
+    engine->master_meter_->processInterleaved(out, static_cast<int>(framesPerBuffer));
+    engine->callbacks_++;
+    engine->publishTelemetry(blockStart, framesPerBuffer, audibleNs, statusFlags);
+    engine->frame_clock_.store(blockStart + framesPerBuffer, std::memory_order_release);
     
     return paContinue;
 }
@@ -694,6 +1156,10 @@ extern "C" {
         static_cast<AudioEngine*>(engine)->setDeckPitch(deck, pitch);
     }
     
+    void AudioEngine_SetDeckKeyLock(void* engine, int deck, bool enabled) {
+        static_cast<AudioEngine*>(engine)->setDeckKeyLock(deck, enabled);
+    }
+    
     void AudioEngine_SetDeckPosition(void* engine, int deck, float position) {
         static_cast<AudioEngine*>(engine)->setDeckPosition(deck, position);
     }
@@ -702,6 +1168,114 @@ extern "C" {
         static_cast<AudioEngine*>(engine)->setDeckFile(deck, filepath);
     }
     
+    void AudioEngine_TriggerSample(void* engine, int deck) {
+        static_cast<AudioEngine*>(engine)->triggerSample(deck);
+    }
+    
+    void AudioEngine_SetMappedLoading(void* engine, bool enabled) {
+        static_cast<AudioEngine*>(engine)->setMappedLoading(enabled);
+    }
+    
+    void AudioEngine_SetSampleStorage(void* engine, int storage) {
+        static_cast<AudioEngine*>(engine)->setSampleStorage(storage);
+    }
+    
+    void AudioEngine_SetPageCacheSize(void* engine, int megabytes) {
+        static_cast<AudioEngine*>(engine)->setPageCacheSize(megabytes);
+    }
+    
+    void AudioEngine_SetResampleQuality(void* engine, int quality) {
+        static_cast<AudioEngine*>(engine)->setResampleQuality(quality);
+    }
+    
+    void AudioEngine_SetResampleAtLoad(void* engine, bool enabled) {
+        static_cast<AudioEngine*>(engine)->setResampleAtLoad(enabled);
+    }
+    
+    void AudioEngine_SetInterpolation(void* engine, int mode) {
+        static_cast<AudioEngine*>(engine)->setInterpolation(mode);
+    }
+    
+    void AudioEngine_SetAnalysisCache(void* engine, const char* directory, int maxMegabytes) {
+        static_cast<AudioEngine*>(engine)->setAnalysisCache(directory ? directory : "", maxMegabytes);
+    }
+    
+    void AudioEngine_SetDeckSync(void* engine, int deck, bool enabled) {
+        static_cast<AudioEngine*>(engine)->setDeckSync(deck, enabled);
+    }
+    
+    void AudioEngine_SetSyncLeader(void* engine, int deck) {
+        static_cast<AudioEngine*>(engine)->setSyncLeader(deck);
+    }
+    
+    float AudioEngine_GetDeckPhaseError(void* engine, int deck) {
+        return static_cast<AudioEngine*>(engine)->getDeckPhaseError(deck);
+    }
+    
+    int AudioEngine_GetDeckCount(void* engine) {
+        (void)engine;
+        return kMaxDecks;
+    }
+    
+    float AudioEngine_GetDeckPosition(void* engine, int deck) {
+        return static_cast<AudioEngine*>(engine)->getDeckPosition(deck);
+    }
+    
+    int64_t AudioEngine_GetClockNs() {
+        return steadyClockNs();
+    }
+    
+    bool AudioEngine_GetDeckClock(void* engine, int deck, PlayheadClock* clock) {
+        return clock && static_cast<AudioEngine*>(engine)->getDeckClock(deck, *clock);
+    }
+    
+    double AudioEngine_GetDeckAudiblePosition(void* engine, int deck, int64_t timeNs) {
+        PlayheadClock clock;
+        if (!static_cast<AudioEngine*>(engine)->getDeckClock(deck, clock)) return 0.0;
+        return playheadPositionAt(clock, timeNs);
+    }
+    
+    bool AudioEngine_GetDeckMeter(void* engine, int deck, MeterReading* reading) {
+        return reading && static_cast<AudioEngine*>(engine)->getDeckMeter(deck, *reading);
+    }
+    
+    bool AudioEngine_GetMasterMeter(void* engine, MeterReading* reading) {
+        return reading && static_cast<AudioEngine*>(engine)->getMasterMeter(*reading);
+    }
+    
+    void AudioEngine_ClearClipIndicators(void* engine) {
+        static_cast<AudioEngine*>(engine)->clearClipIndicators();
+    }
+    
+    int AudioEngine_GetDeckLoadState(void* engine, int deck) {
+        return static_cast<AudioEngine*>(engine)->getDeckLoadState(deck);
+    }
+    
+    float AudioEngine_GetDeckLoadProgress(void* engine, int deck) {
+        return static_cast<AudioEngine*>(engine)->getDeckLoadProgress(deck);
+    }
+    
+    bool AudioEngine_GetDeckBeatgrid(void* engine, int deck, BeatGrid* grid) {
+        return grid && static_cast<AudioEngine*>(engine)->getDeckBeatgrid(deck, *grid);
+    }
+    
+    bool AudioEngine_GetDeckKey(void* engine, int deck, KeyEstimate* key) {
+        return key && static_cast<AudioEngine*>(engine)->getDeckKey(deck, *key);
+    }
+    
+    int AudioEngine_GetWaveformPointCount(void* engine, int deck, int samplesPerPoint) {
+        std::shared_ptr<const WaveformPyramid> waveform = static_cast<AudioEngine*>(engine)->getDeckWaveform(deck);
+        if (!waveform || waveform->empty()) return 0;
+        return static_cast<int>(waveform->pointCount(waveform->levelFor(samplesPerPoint)));
+    }
+    
+    int AudioEngine_GetWaveformPoints(void* engine, int deck, int samplesPerPoint,
+                                      int first, int count, WaveformPoint* points) {
+        std::shared_ptr<const WaveformPyramid> waveform = static_cast<AudioEngine*>(engine)->getDeckWaveform(deck);
+        if (!waveform || !points || first < 0 || count <= 0) return 0;
+        return static_cast<int>(waveform->copyPoints(samplesPerPoint, first, count, points));
+    }
+    
     void AudioEngine_SetEffect(void* engine, int deck, int effect, bool enabled) {
         static_cast<AudioEngine*>(engine)->setEffect(deck, effect, enabled);
     }
@@ -721,4 +1295,12 @@ extern "C" {
     void AudioEngine_SetHeadphoneVolume(void* engine, float volume) {
         static_cast<AudioEngine*>(engine)->setHeadphoneVolume(volume);
     }
+    
+    void AudioEngine_BeginParameterBatch(void* engine) {
+        static_cast<AudioEngine*>(engine)->beginParameterBatch();
+    }
+    
+    void AudioEngine_EndParameterBatch(void* engine) {
+        static_cast<AudioEngine*>(engine)->endParameterBatch();
+    }
 }
\ No newline at end of file
@@ -13,21 +13,24 @@
 #else
 #include <sys/mman.h>
 #include <fcntl.h>
+#include <unistd.h>
 #endif
 
 #include <portaudio.h>
 
-// Audio file structure for loaded audio data
-struct AudioFile {
-    std::vector<float> leftChannel;
-    std::vector<float> rightChannel;
-    int sampleRate;
-    int channels;
-    float duration;
-    bool loaded;
-    
-    AudioFile() : sampleRate(44100), channels(2), duration(0.0f), loaded(false) {}
-};
+#include "analysis_cache.h"
+#include "audio_file.h"
+#include "audio_processor.h"
+#include "beat_analyzer.h"
+#include "deck_mixer.h"
+#include "key_detector.h"
+#include "param_queue.h"
+#include "resampler.h"
+#include "rt_log.h"
+#include "sample_page_cache.h"
+#include "shared_state.h"
+#include "task_pool.h"
+#include "waveform.h"
 
 // C-compatible exports for Koffi
 extern "C" {
@@ -43,8 +46,73 @@ extern "C" {
     void AudioEngine_SetDeckPlaying(void* engine, int deck, bool playing);
     void AudioEngine_SetDeckVolume(void* engine, int deck, float volume);
     void AudioEngine_SetDeckPitch(void* engine, int deck, float pitch);
+    void AudioEngine_SetDeckKeyLock(void* engine, int deck, bool enabled);
     void AudioEngine_SetDeckPosition(void* engine, int deck, float position);
     void AudioEngine_SetDeckFile(void* engine, int deck, const char* filepath);
+    void AudioEngine_TriggerSample(void* engine, int deck);
+    void AudioEngine_SetMappedLoading(void* engine, bool enabled);
+    // How WAV files keep their samples (SampleStorage in audio_file.h): 0
+    // mapped (the default), 1 compact in memory, 2 paged in from disk, 3
+    // float. SetMappedLoading(false) picks compact. Load-time resampling
+    // only applies to float tracks.
+    void AudioEngine_SetSampleStorage(void* engine, int storage);
+    // Memory the paged storage may use across all decks (at least 32 MB)
+    void AudioEngine_SetPageCacheSize(void* engine, int megabytes);
+    void AudioEngine_SetResampleQuality(void* engine, int quality);
+    void AudioEngine_SetResampleAtLoad(void* engine, bool enabled);
+    void AudioEngine_SetInterpolation(void* engine, int mode);
+    
+    // Directory for cached waveforms, beatgrids and keys, and its size limit.
+    // On by default in the per-user cache directory; null or "" turns it off.
+    void AudioEngine_SetAnalysisCache(void* engine, const char* directory, int maxMegabytes);
+    
+    // Beat sync: a synced deck follows the leader's tempo and beats (decks
+    // 1..4; the leader defaults to deck 1). PhaseError is how far the deck
+    // is ahead of the leader's beat in seconds, 0 when it isn't following.
+    void AudioEngine_SetDeckSync(void* engine, int deck, bool enabled);
+    void AudioEngine_SetSyncLeader(void* engine, int deck);
+    float AudioEngine_GetDeckPhaseError(void* engine, int deck);
+    
+    // Decks are numbered 1..AudioEngine_GetDeckCount(); see deck_layout.h
+    int AudioEngine_GetDeckCount(void* engine);
+    float AudioEngine_GetDeckPosition(void* engine, int deck);
+    
+    // Playhead clocks. Every callback publishes when the deck's playhead will
+    // be heard (from the stream's DAC time) and how fast it moves, so a UI
+    // can place the cursor at any moment, e.g. each frame at its vsync time,
+    // with playheadPositionAt() in shared_state.h. Times are steady-clock
+    // nanoseconds as returned by GetClockNs. Readers of the shared-memory
+    // segment can build the same clock from DeckTelemetry without any calls.
+    int64_t AudioEngine_GetClockNs();
+    bool AudioEngine_GetDeckClock(void* engine, int deck, PlayheadClock* clock);
+    double AudioEngine_GetDeckAudiblePosition(void* engine, int deck, int64_t timeNs); // source frames
+    
+    // Latest meter readings, updated every callback; false if the engine
+    // isn't running or the deck number is out of range
+    bool AudioEngine_GetDeckMeter(void* engine, int deck, MeterReading* reading);
+    bool AudioEngine_GetMasterMeter(void* engine, MeterReading* reading);
+    void AudioEngine_ClearClipIndicators(void* engine);
+    
+    // Asynchronous load status (see LoadState)
+    int AudioEngine_GetDeckLoadState(void* engine, int deck);
+    float AudioEngine_GetDeckLoadProgress(void* engine, int deck);
+    
+    // Tempo and beatgrid of the deck's loaded track, in its frames. Analysis
+    // starts once the load is ready and takes a fraction of a second; until
+    // then, or if no steady pulse was found, this returns false.
+    bool AudioEngine_GetDeckBeatgrid(void* engine, int deck, BeatGrid* grid);
+    
+    // Key of the deck's loaded track (see KeyEstimate), found right after the
+    // beatgrid; false until then or if the track has no tonal content
+    bool AudioEngine_GetDeckKey(void* engine, int deck, KeyEstimate* key);
+    
+    // Waveform overview of the deck's loaded track, available once its load
+    // state is LoadReady. samplesPerPoint is rounded to the nearest level
+    // (64, 128, ... 65536). GetWaveformPoints copies up to `count` points
+    // starting at point `first` and returns how many it copied.
+    int AudioEngine_GetWaveformPointCount(void* engine, int deck, int samplesPerPoint);
+    int AudioEngine_GetWaveformPoints(void* engine, int deck, int samplesPerPoint,
+                                      int first, int count, WaveformPoint* points);
     
     // Effects
     void AudioEngine_SetEffect(void* engine, int deck, int effect, bool enabled);
@@ -54,48 +122,18 @@ extern "C" {
     void AudioEngine_SetCrossfader(void* engine, float value);
     void AudioEngine_SetMasterVolume(void* engine, float volume);
     void AudioEngine_SetHeadphoneVolume(void* engine, float volume);
+    
+    // Parameter batches (changes between Begin/End take effect together)
+    void AudioEngine_BeginParameterBatch(void* engine);
+    void AudioEngine_EndParameterBatch(void* engine);
 }
 
-struct AudioState {
-    // Deck playing states (array format)
-    std::atomic<bool> deck_playing[2]{false, false};
-    
-    // Deck 1
-    std::atomic<float> deck1_volume{0.8f};
-    std::atomic<float> deck1_pitch{0.0f};
-    std::atomic<float> deck1_position{0.0f};
-    std::atomic<float> deck1_duration{0.0f};
-    std::atomic<bool> deck1_flanger{false};
-    std::atomic<bool> deck1_filter{false};
-    std::atomic<bool> deck1_echo{false};
-    std::atomic<bool> deck1_reverb{false};
-    
-    // Deck 2
-    std::atomic<float> deck2_volume{0.8f};
-    std::atomic<float> deck2_pitch{0.0f};
-    std::atomic<float> deck2_position{0.0f};
-    std::atomic<float> deck2_duration{0.0f};
-    std::atomic<bool> deck2_flanger{false};
-    std::atomic<bool> deck2_filter{false};
-    std::atomic<bool> deck2_echo{false};
-    std::atomic<bool> deck2_reverb{false};
-    
-    // File paths
-    char deck1_file[256]{0};
-    char deck2_file[256]{0};
-    
-    // Master controls
-    std::atomic<float> crossfader{0.5f};
-    std::atomic<float> master_volume{0.8f};
-    std::atomic<float> headphone_volume{0.8f};
-    
-    // EQ controls
-    std::atomic<float> deck1_low_eq{0.0f};
-    std::atomic<float> deck1_mid_eq{0.0f};
-    std::atomic<float> deck1_high_eq{0.0f};
-    std::atomic<float> deck2_low_eq{0.0f};
-    std::atomic<float> deck2_mid_eq{0.0f};
-    std::atomic<float> deck2_high_eq{0.0f};
+// Progress of the most recent setDeckFile request for a deck
+enum LoadState {
+    LoadIdle = 0,
+    LoadLoading = 1,
+    LoadReady = 2,
+    LoadFailed = 3
 };
 
 class AudioEngine {
@@ -110,17 +148,44 @@ public:
     void setDeckPlaying(int deck, bool playing);
     void setDeckVolume(int deck, float volume);
     void setDeckPitch(int deck, float pitch);
+    void setDeckKeyLock(int deck, bool enabled);
     void setDeckPosition(int deck, float position);
     void setDeckFile(int deck, const std::string& filepath);
+    void triggerSample(int deck);
+    void setMappedLoading(bool enabled) {
+        sample_storage_ = static_cast<int>(enabled ? SampleStorage::Mapped : SampleStorage::Compact);
+    }
+    void setSampleStorage(int storage);
+    void setPageCacheSize(int megabytes);
+    void setResampleQuality(int quality);
+    void setResampleAtLoad(bool enabled) { resample_at_load_ = enabled; }
+    void setInterpolation(int mode);
+    void setAnalysisCache(const std::string& directory, int maxMegabytes);
+    void setDeckSync(int deck, bool enabled);
+    void setSyncLeader(int deck);
     void setEffect(int deck, int effect, bool enabled);
     void setEQ(int deck, int band, float value);
     void setCrossfader(float value);
     void setMasterVolume(float volume);
     void setHeadphoneVolume(float volume);
+    void clearClipIndicators();
+    
+    // Group parameter changes so the callback applies them on the same frame
+    void beginParameterBatch();
+    void endParameterBatch();
     
     // Getters
     AudioState* getState() { return shared_state_; }
     float getDeckPosition(int deck);
+    bool getDeckClock(int deck, PlayheadClock& clock) const;
+    int getDeckLoadState(int deck);
+    float getDeckLoadProgress(int deck);
+    std::shared_ptr<const WaveformPyramid> getDeckWaveform(int deck);
+    bool getDeckBeatgrid(int deck, BeatGrid& grid);
+    bool getDeckKey(int deck, KeyEstimate& key);
+    float getDeckPhaseError(int deck) const;
+    bool getDeckMeter(int deck, MeterReading& reading) const;
+    bool getMasterMeter(MeterReading& reading) const;
     
 private:
     static int audioCallback(const void* inputBuffer, void* outputBuffer,
@@ -129,18 +194,44 @@ private:
                            PaStreamCallbackFlags statusFlags,
                            void* userData);
     
-    void audioThread();
-    void processAudio();
+    void housekeepingThread();
+    
+    // Parameter event handling
+    void postParamEvent(ParamType type, int deck, int index, float value);
+    uint64_t estimateEventTime();
+    void applyParamEvent(const ParamEvent& event);
+    void renderSegment(float* out, unsigned long start, unsigned long end);
+    void publishTelemetry(uint64_t blockStart, unsigned long frames, int64_t audibleNs,
+                          PaStreamCallbackFlags statusFlags);
     
     // Audio file loading
-    bool loadWavFile(const std::string& filepath, AudioFile& audioFile);
-    bool loadAudioFile(const std::string& filepath, AudioFile& audioFile);
+    bool loadWavFile(const std::string& filepath, AudioFile& audioFile, std::atomic<float>* progress);
+    bool loadStreamedFile(const std::string& filepath, AudioFile& audioFile);
+    bool loadAudioFile(const std::string& filepath, AudioFile& audioFile, std::atomic<float>* progress = nullptr);
+    void loadDeckTrack(int deckIndex, const std::string& filepath, uint32_t generation);
+    // Reduced copies of a loaded track for the analysis thread, and where its
+    // results go in the analysis cache. Streamed tracks leave the waveform and
+    // the reduced copies to the analysis thread, which decodes `streamedPath`
+    // on its own.
+    struct TrackAnalyzers {
+        BeatAnalyzer beats;
+        KeyDetector key;
+        CacheKey cacheKey;
+        CachedAnalysis results; // frame count, rate and waveform filled in at load
+        std::string streamedPath;
+    };
+    bool prepareStreamedAnalysis(int deckIndex, uint32_t generation, TrackAnalyzers& analyzers);
+    void analyzeDeckTrack(int deckIndex, uint32_t generation, const AudioFile* track, TrackAnalyzers& analyzers);
+    void prepareTrackRate(AudioFile& track);
+    void adoptPendingTrack(int deckIndex);
+    void releaseTracks();
     
+    // Shared-memory mirror of the controls plus callback telemetry; see shared_state.h
     AudioState* shared_state_;
     void* shared_memory_;
     size_t shared_memory_size_;
     
-    std::thread audio_thread_;
+    std::thread housekeeping_thread_;
     std::atomic<bool> running_{false};
     
     // Audio processing
@@ -149,14 +240,86 @@ private:
     int buffer_size_;
     PaStream* audio_stream_;
     
-    // Audio files for each deck
-    AudioFile deck1_audio_;
-    AudioFile deck2_audio_;
+    // Tracks for each deck. A loader thread decodes into a fresh AudioFile and
+    // publishes it in its DeckLoadStatus::pending; the callback adopts it as
+    // the deck's track at the start of a block and hands the old track to
+    // retired_tracks_, which the housekeeping thread frees. The audio thread
+    // never allocates or frees a track.
+    SpscQueue<AudioFile*, 16> retired_tracks_;
+    
+    // Pages of paged tracks, filled ahead of each deck by the housekeeping
+    // thread. Declared before the tracks' owners so it outlives them.
+    SamplePageCache page_cache_;
+    
+    // A beatgrid and the track it was measured on (null if there is none),
+    // so the callback never applies a grid to a different track
+    struct TrackBeatgrid {
+        BeatGrid grid;
+        const AudioFile* track;
+    };
+    
+    // Written by the loader threads, so kept apart from the callback's DeckState
+    struct alignas(kCacheLineSize) DeckLoadStatus {
+        std::atomic<AudioFile*> pending{nullptr};
+        std::atomic<int> state{LoadIdle};
+        std::atomic<float> progress{0.0f};
+        std::atomic<uint32_t> generation{0};
+        std::shared_ptr<const WaveformPyramid> waveform; // guarded by publish_mutex_
+        SeqlockCell<TrackBeatgrid> beatgrid;            // written under publish_mutex_
+        KeyEstimate key = {};                            // guarded by publish_mutex_
+        bool hasKey = false;
+    };
+    DeckLoadStatus load_status_[kMaxDecks];
+    TaskPool loader_pool_;
+    TaskPool analysis_pool_;
+    std::mutex publish_mutex_;
+    
+    // Waveforms and analysis results of recently loaded files
+    AnalysisCache analysis_cache_;
+    
+    // How WAV files keep their samples; mapped unless set otherwise
+    std::atomic<int> sample_storage_{static_cast<int>(SampleStorage::Mapped)};
+    
+    // Sample-rate conversion for tracks that don't match sample_rate_
+    std::atomic<int> resample_quality_{static_cast<int>(ResampleQuality::Standard)};
+    std::atomic<bool> resample_at_load_{true};
+    
+    // Fractional playheads. A deck reads through its resampler whenever its
+    // rate (pitch times the track/output rate ratio) isn't exactly 1. Ladders
+    // are built on the control thread before their tier is selected.
+    std::atomic<int> interpolation_mode_{static_cast<int>(InterpolationMode::Sinc)};
+    SincBankLadder sinc_ladders_[3];
+    
+    // Per-deck playheads, stretchers and EQ/effects chains (same as the Wasm
+    // build), prepared before the stream starts. Controls are written only by
+    // applyParamEvent.
+    DeckMixer mixer_;
+    float crossfader_ = 0.5f;
+    float master_volume_ = 0.8f;
+    float headphone_volume_ = 0.8f;
+    int sync_leader_ = 0;
+    std::unique_ptr<LevelMeter> master_meter_;
+    
+    // Control thread -> audio thread parameter events
+    SpscQueue<ParamEvent, 1024> param_queue_;
+    
+    // Frame clock advanced by the callback, plus the wall time the current
+    // block started, used to timestamp events with a constant latency
+    std::atomic<uint64_t> frame_clock_{0};
+    std::atomic<int64_t> block_start_ns_{0};
+    // Output latency reported by the stream, for hosts whose callbacks carry
+    // no DAC time; set before the stream starts
+    int64_t output_latency_ns_ = 0;
+    int64_t next_audible_ns_ = 0; // audio thread only
+    uint64_t callbacks_ = 0; // audio thread only
+    uint64_t xruns_ = 0;     // audio thread only
     
-    // Playback positions (in samples)
-    std::atomic<size_t> deck1_position_{0};
-    std::atomic<size_t> deck2_position_{0};
+    // The callback's log, written out by the housekeeping thread
+    RtLog rt_log_;
     
-    // Mutex for thread safety
-    std::mutex audio_mutex_;
+    // Serialises producers of param_queue_; never taken on the audio thread
+    std::mutex control_mutex_;
+    int batch_depth_ = 0;
+    uint64_t batch_time_ = 0;
+    uint64_t last_event_time_ = 0;
 };
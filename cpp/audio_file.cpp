@@ -0,0 +1,42 @@
+#include "audio_file.h"
+#include <algorithm>
+#include <cstring>
+
+#include "decode_stream.h"
+#include "sample_page_cache.h"
+
+void AudioFile::readFrames(size_t start, size_t count, float* left, float* right) const {
+    if (isStreamed()) {
+        stream->read(start, count, left, right);
+        return;
+    }
+    if (isPaged()) {
+        paged->read(start, count, left, right);
+        return;
+    }
+    
+    size_t available = (start < frameCount) ? std::min(count, frameCount - start) : 0;
+    
+    if (available > 0) {
+        if (pcmData) {
+            convertToFloat(pcmData + byteOffset(start), sampleFormat, channels, frameStride,
+                           available, left, right);
+        } else {
+            memcpy(left, leftChannel.data() + start, available * sizeof(float));
+            memcpy(right, rightChannel.data() + start, available * sizeof(float));
+        }
+    }
+    
+    if (available < count) {
+        std::fill(left + available, left + count, 0.0f);
+        std::fill(right + available, right + count, 0.0f);
+    }
+}
+
+size_t AudioFile::byteSize() const {
+    size_t bytes = (leftChannel.capacity() + rightChannel.capacity()) * sizeof(float);
+    if (packedPcm) bytes += packedPcm->capacity();
+    if (paged) bytes += paged->residentBytes();
+    if (stream) bytes += stream->byteSize();
+    return bytes;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "mapped_file.h"
+#include "pcm_convert.h"
+
+class DecodeStream;
+class PagedPcm;
+
+// Where a loaded WAV keeps its samples
+enum class SampleStorage : int {
+    Mapped,  // PCM read in place from a memory-mapped file
+    Compact, // PCM copied into memory in its own format, mono kept mono
+    Paged,   // PCM read into a SamplePageCache just ahead of the playhead
+    Float    // Converted to float up front, one vector per channel
+};
+
+// Audio file structure for loaded audio data.
+// Samples either live decoded in leftChannel/rightChannel, stay as raw PCM
+// (memory-mapped, copied compactly or paged in from disk) and are converted
+// on demand by readFrames(), or come from a compressed file decoded just
+// ahead of the playhead.
+struct AudioFile {
+    std::vector<float> leftChannel;
+    std::vector<float> rightChannel;
+    
+    // Raw PCM (interleaved, little-endian), inside `mapping` or `packedPcm`
+    std::shared_ptr<MappedFile> mapping;
+    std::shared_ptr<std::vector<uint8_t>> packedPcm;
+    const uint8_t* pcmData;
+    SampleFormat sampleFormat;
+    size_t frameStride; // Bytes per interleaved frame
+    
+    // PCM paged in from disk, or a compressed file decoded a few seconds at a time
+    std::shared_ptr<PagedPcm> paged;
+    std::shared_ptr<DecodeStream> stream;
+    
+    size_t frameCount;
+    int sampleRate;
+    int channels;
+    float duration;
+    bool loaded;
+    
+    AudioFile()
+        : pcmData(nullptr), sampleFormat(SampleFormat::Float32), frameStride(0), frameCount(0)
+        , sampleRate(44100), channels(2), duration(0.0f), loaded(false) {}
+    
+    bool isMapped() const { return mapping != nullptr; }
+    bool isPaged() const { return paged != nullptr; }
+    bool isStreamed() const { return stream != nullptr; }
+    // Samples are in leftChannel/rightChannel
+    bool isDecoded() const { return !pcmData && !paged && !stream; }
+    
+    // Convert `count` frames starting at `start` to float; frames past the end
+    // of the file are written as silence. Safe to call from the audio thread.
+    void readFrames(size_t start, size_t count, float* left, float* right) const;
+    
+    // Memory the samples hold now, not counting a mapping's pages, which
+    // belong to the OS page cache
+    size_t byteSize() const;
+    
+    // Position of `frame` relative to pcmData, used for prefetching
+    size_t byteOffset(size_t frame) const { return frame * frameStride; }
+};
@@ -3,10 +3,77 @@
 #include <algorithm>
 #include <cstring>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PROCESSOR_SSE 1
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define PROCESSOR_WASM_SIMD 1
+#endif
+
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+// Four-lane helpers for the reverb network and the level meter
+#if defined(PROCESSOR_SSE)
+typedef __m128 Vec4;
+static inline Vec4 vecLoad(const float* p) { return _mm_loadu_ps(p); }
+static inline void vecStore(float* p, Vec4 v) { _mm_storeu_ps(p, v); }
+static inline Vec4 vecSet(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+static inline Vec4 vecAdd(Vec4 a, Vec4 b) { return _mm_add_ps(a, b); }
+static inline Vec4 vecSub(Vec4 a, Vec4 b) { return _mm_sub_ps(a, b); }
+static inline Vec4 vecMul(Vec4 a, Vec4 b) { return _mm_mul_ps(a, b); }
+static inline Vec4 vecSplat(float a) { return _mm_set1_ps(a); }
+static inline Vec4 vecMax(Vec4 a, Vec4 b) { return _mm_max_ps(a, b); }
+static inline Vec4 vecAbs(Vec4 v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+// Lanes (0, 0, 2, 2) and (1, 1, 3, 3), then (0, 1, 0, 1) and (2, 3, 2, 3)
+static inline Vec4 vecEvens(Vec4 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 0, 0)); }
+static inline Vec4 vecOdds(Vec4 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 1, 1)); }
+static inline Vec4 vecLows(Vec4 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 1, 0)); }
+static inline Vec4 vecHighs(Vec4 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 2, 3, 2)); }
+#elif defined(PROCESSOR_WASM_SIMD)
+typedef v128_t Vec4;
+static inline Vec4 vecLoad(const float* p) { return wasm_v128_load(p); }
+static inline void vecStore(float* p, Vec4 v) { wasm_v128_store(p, v); }
+static inline Vec4 vecSet(float a, float b, float c, float d) { return wasm_f32x4_make(a, b, c, d); }
+static inline Vec4 vecAdd(Vec4 a, Vec4 b) { return wasm_f32x4_add(a, b); }
+static inline Vec4 vecSub(Vec4 a, Vec4 b) { return wasm_f32x4_sub(a, b); }
+static inline Vec4 vecMul(Vec4 a, Vec4 b) { return wasm_f32x4_mul(a, b); }
+static inline Vec4 vecSplat(float a) { return wasm_f32x4_splat(a); }
+static inline Vec4 vecMax(Vec4 a, Vec4 b) { return wasm_f32x4_pmax(a, b); }
+static inline Vec4 vecAbs(Vec4 v) { return wasm_f32x4_abs(v); }
+static inline Vec4 vecEvens(Vec4 v) { return wasm_i32x4_shuffle(v, v, 0, 0, 2, 2); }
+static inline Vec4 vecOdds(Vec4 v) { return wasm_i32x4_shuffle(v, v, 1, 1, 3, 3); }
+static inline Vec4 vecLows(Vec4 v) { return wasm_i32x4_shuffle(v, v, 0, 1, 0, 1); }
+static inline Vec4 vecHighs(Vec4 v) { return wasm_i32x4_shuffle(v, v, 2, 3, 2, 3); }
+#else
+struct Vec4 { float v[4]; };
+static inline Vec4 vecLoad(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+static inline void vecStore(float* p, Vec4 v) { memcpy(p, v.v, sizeof(v.v)); }
+static inline Vec4 vecSet(float a, float b, float c, float d) { return {{a, b, c, d}}; }
+static inline Vec4 vecAdd(Vec4 a, Vec4 b) { return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}}; }
+static inline Vec4 vecSub(Vec4 a, Vec4 b) { return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}}; }
+static inline Vec4 vecMul(Vec4 a, Vec4 b) { return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}}; }
+static inline Vec4 vecSplat(float a) { return {{a, a, a, a}}; }
+static inline Vec4 vecMax(Vec4 a, Vec4 b) {
+    return {{std::max(a.v[0], b.v[0]), std::max(a.v[1], b.v[1]), std::max(a.v[2], b.v[2]), std::max(a.v[3], b.v[3])}};
+}
+static inline Vec4 vecAbs(Vec4 v) { return {{std::fabs(v.v[0]), std::fabs(v.v[1]), std::fabs(v.v[2]), std::fabs(v.v[3])}}; }
+static inline Vec4 vecEvens(Vec4 v) { return {{v.v[0], v.v[0], v.v[2], v.v[2]}}; }
+static inline Vec4 vecOdds(Vec4 v) { return {{v.v[1], v.v[1], v.v[3], v.v[3]}}; }
+static inline Vec4 vecLows(Vec4 v) { return {{v.v[0], v.v[1], v.v[0], v.v[1]}}; }
+static inline Vec4 vecHighs(Vec4 v) { return {{v.v[2], v.v[3], v.v[2], v.v[3]}}; }
+#endif
+
+// Unnormalised 4-point Hadamard transform in two butterfly stages
+static inline Vec4 hadamard4(Vec4 v) {
+    const Vec4 signs1 = vecSet(1.0f, -1.0f, 1.0f, -1.0f);
+    const Vec4 signs2 = vecSet(1.0f, 1.0f, -1.0f, -1.0f);
+    Vec4 pairs = vecAdd(vecEvens(v), vecMul(vecOdds(v), signs1));
+    return vecAdd(vecLows(pairs), vecMul(vecHighs(pairs), signs2));
+}
+
 // Simple biquad filter implementation
 BiquadFilter::BiquadFilter() {
     reset();
@@ -101,6 +168,38 @@ void BiquadFilter::setHighshelf(float freq, float q, float gain, float sampleRat
     setCoefficients(b0, b1, b2, a0, a1, a2);
 }
 
+// K-weighting from the BS.1770 reference coefficients: the analogue
+// prototypes are recovered from the 48 kHz filters and re-warped for other
+// rates, so the curve is the same at 44.1 and 96 kHz
+void BiquadFilter::setLoudnessShelf(float sampleRate) {
+    const double freq = 1681.974450955533;
+    const double gainDb = 3.999843853973347;
+    const double q = 0.7071752369554196;
+    double k = std::tan(M_PI * freq / sampleRate);
+    double vh = std::pow(10.0, gainDb / 20.0);
+    double vb = std::pow(vh, 0.4996667741545416);
+    
+    setCoefficients(static_cast<float>(vh + vb * k / q + k * k),
+                    static_cast<float>(2.0 * (k * k - vh)),
+                    static_cast<float>(vh - vb * k / q + k * k),
+                    static_cast<float>(1.0 + k / q + k * k),
+                    static_cast<float>(2.0 * (k * k - 1.0)),
+                    static_cast<float>(1.0 - k / q + k * k));
+}
+
+void BiquadFilter::setLoudnessHighpass(float sampleRate) {
+    const double freq = 38.13547087602444;
+    const double q = 0.5003270373238773;
+    double k = std::tan(M_PI * freq / sampleRate);
+    double a0 = 1.0 + k / q + k * k;
+    
+    // Unity numerator, as in the standard's 48 kHz table
+    setCoefficients(1.0f, -2.0f, 1.0f,
+                    1.0f,
+                    static_cast<float>(2.0 * (k * k - 1.0) / a0),
+                    static_cast<float>((1.0 - k / q + k * k) / a0));
+}
+
 void BiquadFilter::setCoefficients(float b0, float b1, float b2, float a0, float a1, float a2) {
     // Normalize coefficients
     this->b0 = b0 / a0;
@@ -123,34 +222,289 @@ float BiquadFilter::process(float input) {
     return output;
 }
 
+// Stereo biquad, left in lane 0 and right in lane 1
+StereoBiquad::StereoBiquad() {
+    reset();
+}
+
+void StereoBiquad::reset() {
+    BiquadFilter::reset();
+    s1[0] = s1[1] = 0.0f;
+    s2[0] = s2[1] = 0.0f;
+}
+
+void StereoBiquad::process(float* left, float* right, int numSamples) {
+#if defined(PROCESSOR_SSE)
+    const __m128 cb0 = _mm_set1_ps(b0);
+    const __m128 cb1 = _mm_set1_ps(b1);
+    const __m128 cb2 = _mm_set1_ps(b2);
+    const __m128 ca1 = _mm_set1_ps(a1);
+    const __m128 ca2 = _mm_set1_ps(a2);
+    __m128 z1 = _mm_setr_ps(s1[0], s1[1], 0.0f, 0.0f);
+    __m128 z2 = _mm_setr_ps(s2[0], s2[1], 0.0f, 0.0f);
+    
+    for (int i = 0; i < numSamples; i++) {
+        __m128 x = _mm_unpacklo_ps(_mm_load_ss(left + i), _mm_load_ss(right + i));
+        __m128 y = _mm_add_ps(_mm_mul_ps(cb0, x), z1);
+        z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(cb1, x), _mm_mul_ps(ca1, y)), z2);
+        z2 = _mm_sub_ps(_mm_mul_ps(cb2, x), _mm_mul_ps(ca2, y));
+        _mm_store_ss(left + i, y);
+        _mm_store_ss(right + i, _mm_shuffle_ps(y, y, _MM_SHUFFLE(1, 1, 1, 1)));
+    }
+    
+    float state[4];
+    _mm_storeu_ps(state, z1);
+    s1[0] = state[0];
+    s1[1] = state[1];
+    _mm_storeu_ps(state, z2);
+    s2[0] = state[0];
+    s2[1] = state[1];
+#elif defined(PROCESSOR_WASM_SIMD)
+    const v128_t cb0 = wasm_f32x4_splat(b0);
+    const v128_t cb1 = wasm_f32x4_splat(b1);
+    const v128_t cb2 = wasm_f32x4_splat(b2);
+    const v128_t ca1 = wasm_f32x4_splat(a1);
+    const v128_t ca2 = wasm_f32x4_splat(a2);
+    v128_t z1 = wasm_f32x4_make(s1[0], s1[1], 0.0f, 0.0f);
+    v128_t z2 = wasm_f32x4_make(s2[0], s2[1], 0.0f, 0.0f);
+    
+    for (int i = 0; i < numSamples; i++) {
+        v128_t x = wasm_f32x4_make(left[i], right[i], 0.0f, 0.0f);
+        v128_t y = wasm_f32x4_add(wasm_f32x4_mul(cb0, x), z1);
+        z1 = wasm_f32x4_add(wasm_f32x4_sub(wasm_f32x4_mul(cb1, x), wasm_f32x4_mul(ca1, y)), z2);
+        z2 = wasm_f32x4_sub(wasm_f32x4_mul(cb2, x), wasm_f32x4_mul(ca2, y));
+        left[i] = wasm_f32x4_extract_lane(y, 0);
+        right[i] = wasm_f32x4_extract_lane(y, 1);
+    }
+    
+    s1[0] = wasm_f32x4_extract_lane(z1, 0);
+    s1[1] = wasm_f32x4_extract_lane(z1, 1);
+    s2[0] = wasm_f32x4_extract_lane(z2, 0);
+    s2[1] = wasm_f32x4_extract_lane(z2, 1);
+#else
+    float* channels[2] = {left, right};
+    for (int ch = 0; ch < 2; ch++) {
+        float* x = channels[ch];
+        float z1 = s1[ch];
+        float z2 = s2[ch];
+        for (int i = 0; i < numSamples; i++) {
+            float y = b0 * x[i] + z1;
+            z1 = b1 * x[i] - a1 * y + z2;
+            z2 = b2 * x[i] - a2 * y;
+            x[i] = y;
+        }
+        s1[ch] = z1;
+        s2[ch] = z2;
+    }
+#endif
+}
+
 // Delay line for echo/flanger
-DelayLine::DelayLine(int maxDelaySamples) : maxDelay(maxDelaySamples), writePos(0) {
-    buffer = new float[maxDelaySamples];
-    memset(buffer, 0, maxDelaySamples * sizeof(float));
+DelayLine::DelayLine(int maxDelaySamples) : maxDelay(std::max(maxDelaySamples, 2)), writePos(0), allpassState(0.0f) {
+    // One spare slot so a cubic tap at maxDelay can read the sample past it
+    int size = 1;
+    while (size < maxDelay + 2) size <<= 1;
+    buffer.assign(size, 0.0f);
+    mask = size - 1;
+}
+
+float DelayLine::readLinear(float delay) const {
+    delay = std::min(std::max(delay, 1.0f), static_cast<float>(maxDelay));
+    int whole = static_cast<int>(delay);
+    float frac = delay - whole;
+    float a = buffer[(writePos - whole) & mask];
+    float b = buffer[(writePos - whole - 1) & mask];
+    return a + (b - a) * frac;
+}
+
+float DelayLine::readCubic(float delay) const {
+    delay = std::min(std::max(delay, 2.0f), static_cast<float>(maxDelay));
+    int whole = static_cast<int>(delay);
+    float f = delay - whole;
+    
+    // Catmull-Rom through the taps either side of the read point
+    float xm1 = buffer[(writePos - whole + 1) & mask];
+    float x0 = buffer[(writePos - whole) & mask];
+    float x1 = buffer[(writePos - whole - 1) & mask];
+    float x2 = buffer[(writePos - whole - 2) & mask];
+    float c1 = 0.5f * (x1 - xm1);
+    float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+    float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+    return ((c3 * f + c2) * f + c1) * f + x0;
+}
+
+float DelayLine::readAllpass(float delay) {
+    delay = std::min(std::max(delay, 1.0f), static_cast<float>(maxDelay - 1));
+    int whole = static_cast<int>(delay);
+    float frac = delay - whole;
+    
+    // Keep the coefficient away from the pole at frac = 0 by using a delay
+    // of whole - 1 + (1 + frac) there instead
+    if (frac < 0.1f && whole > 1) {
+        whole -= 1;
+        frac += 1.0f;
+    }
+    float eta = (1.0f - frac) / (1.0f + frac);
+    float x0 = buffer[(writePos - whole) & mask];
+    float x1 = buffer[(writePos - whole - 1) & mask];
+    allpassState = x1 + eta * (x0 - allpassState);
+    return allpassState;
+}
+
+void DelayLine::writeBlock(const float* input, int numSamples) {
+    int size = mask + 1;
+    int first = std::min(numSamples, size - writePos);
+    memcpy(buffer.data() + writePos, input, first * sizeof(float));
+    memcpy(buffer.data(), input + first, (numSamples - first) * sizeof(float));
+    writePos = (writePos + numSamples) & mask;
+}
+
+void DelayLine::readBlock(int delay, float* output, int numSamples) const {
+    int size = mask + 1;
+    int readPos = (writePos - delay) & mask;
+    int first = std::min(numSamples, size - readPos);
+    memcpy(output, buffer.data() + readPos, first * sizeof(float));
+    memcpy(output + first, buffer.data(), (numSamples - first) * sizeof(float));
+}
+
+void DelayLine::clear() {
+    std::fill(buffer.begin(), buffer.end(), 0.0f);
+    writePos = 0;
+    allpassState = 0.0f;
+}
+
+// FdnReverb implementation
+FdnReverb::FdnReverb(int sampleRate)
+    : sampleRate(sampleRate),
+      writePos(0),
+      preDelayLeft(static_cast<int>(sampleRate * 0.02f)),
+      preDelayRight(static_cast<int>(sampleRate * 0.02f)) {
+    // Mutually prime-ish lengths between 30 and 75 ms, so echoes don't stack
+    const float delayMs[kLines] = {29.7f, 37.1f, 41.1f, 43.7f, 53.3f, 59.9f, 67.9f, 73.1f};
+    int longest = 0;
+    for (int k = 0; k < kLines; k++) {
+        lineDelay[k] = std::max(1, static_cast<int>(delayMs[k] * 0.001f * sampleRate));
+        longest = std::max(longest, lineDelay[k]);
+    }
+    
+    lineSize = 1;
+    while (lineSize < longest + 1) lineSize <<= 1;
+    lineMask = lineSize - 1;
+    lines.assign(static_cast<size_t>(lineSize) * kLines, 0.0f);
+    
+    // The pre-delay is read a block at a time, so chunks can't be longer
+    preDelay = preDelayLeft.getMaxDelay();
+    chunkLimit = preDelay < kChunk ? preDelay : static_cast<int>(kChunk);
+    
+    setDecay(2.0f);
+    setDamping(6000.0f);
+    reset();
+}
+
+void FdnReverb::setDecay(float seconds) {
+    // -60 dB after `seconds`, spread over each line's own length
+    for (int k = 0; k < kLines; k++) {
+        lineGain[k] = powf(10.0f, -3.0f * lineDelay[k] / (seconds * sampleRate));
+    }
+}
+
+void FdnReverb::setDamping(float cutoffHz) {
+    damping = 1.0f - expf(-2.0f * M_PI * cutoffHz / sampleRate);
 }
 
-DelayLine::~DelayLine() {
-    delete[] buffer;
+void FdnReverb::reset() {
+    std::fill(lines.begin(), lines.end(), 0.0f);
+    std::fill(dampState, dampState + kLines, 0.0f);
+    preDelayLeft.clear();
+    preDelayRight.clear();
+    writePos = 0;
 }
 
-void DelayLine::write(float sample) {
-    buffer[writePos] = sample;
-    writePos = (writePos + 1) % maxDelay;
+void FdnReverb::process(const float* inputLeft, const float* inputRight,
+                        float* wetLeft, float* wetRight, int numSamples) {
+    float delayedLeft[kChunk];
+    float delayedRight[kChunk];
+    
+    for (int done = 0; done < numSamples; ) {
+        int count = std::min(numSamples - done, chunkLimit);
+        preDelayLeft.readBlock(preDelay, delayedLeft, count);
+        preDelayRight.readBlock(preDelay, delayedRight, count);
+        preDelayLeft.writeBlock(inputLeft + done, count);
+        preDelayRight.writeBlock(inputRight + done, count);
+        processChunk(delayedLeft, delayedRight, wetLeft + done, wetRight + done, count);
+        done += count;
+    }
 }
 
-float DelayLine::read(int delay) {
-    int readPos = (writePos - delay + maxDelay) % maxDelay;
-    return buffer[readPos];
+void FdnReverb::processChunk(const float* inputLeft, const float* inputRight,
+                             float* wetLeft, float* wetRight, int numSamples) {
+    // 1/sqrt(8) makes the 8x8 Hadamard mix orthogonal, so only lineGain decays
+    const float norm = 0.35355339f;
+    const Vec4 gainLow = vecMul(vecLoad(lineGain), vecSet(norm, norm, norm, norm));
+    const Vec4 gainHigh = vecMul(vecLoad(lineGain + 4), vecSet(norm, norm, norm, norm));
+    const Vec4 damp = vecSet(damping, damping, damping, damping);
+    const Vec4 inputSigns = vecSet(1.0f, 1.0f, -1.0f, -1.0f);
+    const float inputGain = 0.35f;
+    const float outputGain = 0.5f;
+    
+    // Work on local pointers so the stores below can't alias the members
+    const int mask = lineMask;
+    float* ring = lines.data();
+    int pos = writePos;
+    
+    Vec4 stateLow = vecLoad(dampState);
+    Vec4 stateHigh = vecLoad(dampState + 4);
+    
+    for (int i = 0; i < numSamples; i++) {
+        // Line k lives in lane k of every ring frame. Build the tap vectors
+        // from registers: storing scalars and reloading them as a vector
+        // would stall on store forwarding.
+        auto tap = [&](int k) {
+            return ring[static_cast<size_t>((pos - lineDelay[k]) & mask) * kLines + k];
+        };
+        Vec4 tapLow = vecSet(tap(0), tap(1), tap(2), tap(3));
+        Vec4 tapHigh = vecSet(tap(4), tap(5), tap(6), tap(7));
+        
+        // One-pole lowpass inside the loop, so highs die away faster
+        stateLow = vecAdd(stateLow, vecMul(damp, vecSub(tapLow, stateLow)));
+        stateHigh = vecAdd(stateHigh, vecMul(damp, vecSub(tapHigh, stateHigh)));
+        
+        // Even lines make the left output, odd lines the right: lanes 0 and 1
+        Vec4 sum = vecAdd(stateLow, stateHigh);
+        float pair[4];
+        vecStore(pair, vecAdd(sum, vecHighs(sum)));
+        wetLeft[i] = pair[0] * outputGain;
+        wetRight[i] = pair[1] * outputGain;
+        
+        // 8-point Hadamard as [H4 H4; H4 -H4], then the decay gains
+        Vec4 mixLow = vecMul(hadamard4(sum), gainLow);
+        Vec4 mixHigh = vecMul(hadamard4(vecSub(stateLow, stateHigh)), gainHigh);
+        
+        // Inject the input: left into even lines, right into odd lines
+        float l = inputLeft[i] * inputGain;
+        float r = inputRight[i] * inputGain;
+        Vec4 input = vecSet(l, r, l, r);
+        float* frame = ring + static_cast<size_t>(pos) * kLines;
+        vecStore(frame, vecAdd(mixLow, input));
+        vecStore(frame + 4, vecAdd(mixHigh, vecMul(input, inputSigns)));
+        pos = (pos + 1) & mask;
+    }
+    
+    vecStore(dampState, stateLow);
+    vecStore(dampState + 4, stateHigh);
+    writePos = pos;
 }
 
 // AudioProcessor implementation
 AudioProcessor::AudioProcessor(int sampleRate) 
     : sampleRate(sampleRate), 
+      flangerDelayLeft(static_cast<int>(sampleRate * 0.01f)), // 10ms max delay for flanger
+      flangerDelayRight(static_cast<int>(sampleRate * 0.01f)),
+      echoDelayLeft(static_cast<int>(sampleRate * 2)), // 2 seconds max delay
+      echoDelayRight(static_cast<int>(sampleRate * 2)),
+      reverb(sampleRate),
       flangerPhase(0.0f),
-      flangerDelay(0.0f),
-      flangerDelayLine(static_cast<int>(sampleRate * 0.01f)), // 10ms max delay for flanger
-      echoDelayLine(static_cast<int>(sampleRate * 2)), // 2 seconds max delay
-      reverbDelayLine(static_cast<int>(sampleRate * 1)) { // 1 second max delay
+      flangerDelay(0.0f) {
     params.volume = 1.0f;
     params.pitch = 0.0f;
     params.lowEQ = 0.0f;
@@ -204,74 +558,631 @@ void AudioProcessor::setEffect(int effect, bool enabled) {
     }
 }
 
-void AudioProcessor::process(float* input, float* output, int numSamples) {
+// Flanger: short delay with LFO modulation. The LFO is computed once per
+// frame and shared by both channels, and the delay is read with a cubic tap
+// so the sweep is smooth rather than stepping a whole sample at a time.
+void AudioProcessor::flangerBlock(float* left, float* right, int numSamples) {
+    float delays[kBlockSize];
     for (int i = 0; i < numSamples; i++) {
-        float sample = input[i];
-        
-        // Apply pitch (simple playback rate change - for real pitch shift, use time-stretch)
-        // For now, we'll just pass through as pitch is handled at source level
+        flangerPhase += 0.1f; // LFO rate
+        if (flangerPhase > 2.0f * M_PI) flangerPhase -= 2.0f * M_PI;
         
-        // Apply EQ
-        sample = lowFilter.process(sample);
-        sample = midFilter.process(sample);
-        sample = highFilter.process(sample);
-        
-        // Apply effects
-        if (params.flangerEnabled) {
-            // Flanger: short delay with LFO modulation
-            flangerPhase += 0.1f; // LFO rate
-            if (flangerPhase > 2.0f * M_PI) flangerPhase -= 2.0f * M_PI;
-            
-            float delayTime = 0.003f + 0.002f * sinf(flangerPhase); // 1-5ms delay
-            int delaySamples = (int)(delayTime * sampleRate);
-            int maxDelay = flangerDelayLine.getMaxDelay();
-            delaySamples = std::min(delaySamples, maxDelay - 1);
-            delaySamples = std::max(1, delaySamples); // Ensure at least 1 sample delay
-            
-            float delayed = flangerDelayLine.read(delaySamples);
-            flangerDelayLine.write(sample);
-            sample = sample + delayed * 0.5f; // Mix original and delayed
-        }
-        
-        if (params.filterEnabled) {
-            sample = filterEffect.process(sample);
-        }
-        
-        if (params.echoEnabled) {
-            // Echo: longer delay with feedback
-            int delaySamples = (int)(0.3f * sampleRate); // 300ms delay
-            float delayed = echoDelayLine.read(delaySamples);
-            echoDelayLine.write(sample + delayed * 0.3f); // Feedback
-            sample = sample + delayed * 0.4f; // Mix
+        float delayTime = 0.003f + 0.002f * sinf(flangerPhase); // 1-5ms delay
+        delays[i] = delayTime * sampleRate;
+    }
+    
+    // The delay is shorter than a block, so taps are read sample by sample
+    DelayLine* lines[2] = {&flangerDelayLeft, &flangerDelayRight};
+    float* channels[2] = {left, right};
+    for (int ch = 0; ch < 2; ch++) {
+        DelayLine& line = *lines[ch];
+        float* x = channels[ch];
+        for (int i = 0; i < numSamples; i++) {
+            float delayed = line.readCubic(delays[i]);
+            line.write(x[i]);
+            x[i] = x[i] + delayed * 0.5f; // Mix original and delayed
         }
-        
-        if (params.reverbEnabled) {
-            // Simple reverb: multiple delays with feedback
-            int delay1 = (int)(0.05f * sampleRate);
-            int delay2 = (int)(0.1f * sampleRate);
-            int delay3 = (int)(0.15f * sampleRate);
-            
-            float rev1 = reverbDelayLine.read(delay1);
-            float rev2 = reverbDelayLine.read(delay2);
-            float rev3 = reverbDelayLine.read(delay3);
-            
-            float reverbSum = (rev1 + rev2 + rev3) * 0.33f;
-            reverbDelayLine.write(sample + reverbSum * 0.2f);
-            sample = sample + reverbSum * 0.3f;
+    }
+}
+
+// Echo: longer delay with feedback. The delay is far longer than a block, so
+// the whole block's taps are read before any of it is written back.
+void AudioProcessor::echoBlock(float* left, float* right, int numSamples) {
+    int delaySamples = (int)(0.3f * sampleRate); // 300ms delay
+    float delayed[kBlockSize];
+    float feedback[kBlockSize];
+    
+    DelayLine* lines[2] = {&echoDelayLeft, &echoDelayRight};
+    float* channels[2] = {left, right};
+    for (int ch = 0; ch < 2; ch++) {
+        DelayLine& line = *lines[ch];
+        float* x = channels[ch];
+        line.readBlock(delaySamples, delayed, numSamples);
+        for (int i = 0; i < numSamples; i++) {
+            feedback[i] = x[i] + delayed[i] * 0.3f; // Feedback
+            x[i] = x[i] + delayed[i] * 0.4f; // Mix
         }
-        
-        // Apply volume
-        sample *= params.volume;
-        
-        output[i] = sample;
+        line.writeBlock(feedback, numSamples);
+    }
+}
+
+// Reverb: feedback delay network, mixed in
+void AudioProcessor::reverbBlock(float* left, float* right, int numSamples) {
+    float wetLeft[kBlockSize];
+    float wetRight[kBlockSize];
+    reverb.process(left, right, wetLeft, wetRight, numSamples);
+    for (int i = 0; i < numSamples; i++) {
+        left[i] += wetLeft[i] * 0.3f;
+        right[i] += wetRight[i] * 0.3f;
+    }
+}
+
+// One block in place: every stage runs over the whole block, so the effect
+// switches are tested once per block rather than once per sample
+void AudioProcessor::processBlock(float* left, float* right, int numSamples) {
+    // Apply EQ
+    lowFilter.process(left, right, numSamples);
+    midFilter.process(left, right, numSamples);
+    highFilter.process(left, right, numSamples);
+    
+    // Apply effects
+    if (params.flangerEnabled) {
+        flangerBlock(left, right, numSamples);
+    }
+    if (params.filterEnabled) {
+        filterEffect.process(left, right, numSamples);
+    }
+    if (params.echoEnabled) {
+        echoBlock(left, right, numSamples);
+    }
+    if (params.reverbEnabled) {
+        reverbBlock(left, right, numSamples);
+    }
+    
+    // Apply volume
+    float volume = params.volume;
+    for (int i = 0; i < numSamples; i++) {
+        left[i] *= volume;
+        right[i] *= volume;
+    }
+}
+
+void AudioProcessor::process(float* input, float* output, int numSamples) {
+    float right[kBlockSize];
+    for (int done = 0; done < numSamples; done += kBlockSize) {
+        int count = std::min(numSamples - done, static_cast<int>(kBlockSize));
+        memmove(output + done, input + done, count * sizeof(float));
+        memcpy(right, input + done, count * sizeof(float));
+        processBlock(output + done, right, count);
     }
 }
 
 void AudioProcessor::processStereo(float* inputLeft, float* inputRight, 
                                    float* outputLeft, float* outputRight, 
                                    int numSamples) {
-    // Process left and right channels separately
-    process(inputLeft, outputLeft, numSamples);
-    process(inputRight, outputRight, numSamples);
+    for (int done = 0; done < numSamples; done += kBlockSize) {
+        int count = std::min(numSamples - done, static_cast<int>(kBlockSize));
+        if (outputLeft != inputLeft) memcpy(outputLeft + done, inputLeft + done, count * sizeof(float));
+        if (outputRight != inputRight) memcpy(outputRight + done, inputRight + done, count * sizeof(float));
+        processBlock(outputLeft + done, outputRight + done, count);
+    }
+}
+
+// TimeStretcher implementation
+TimeStretcher::TimeStretcher(int sampleRate, int maxBlockFrames, float maxTempo)
+    : maxBlockFrames(maxBlockFrames),
+      tempo(1.0f),
+      maxTempo(maxTempo) {
+    // ~23 ms frames with 50% overlap and a +/-5.8 ms search, the usual WSOLA
+    // compromise between transient smearing and low-frequency stability
+    frameSize = std::max(64, static_cast<int>(sampleRate * 0.0232f) / 4 * 4);
+    hop = frameSize / 2;
+    searchRadius = frameSize / 4;
+    
+    // Periodic Hann sums to exactly 1 at 50% overlap
+    window.resize(frameSize);
+    for (int i = 0; i < frameSize; i++) {
+        window[i] = 0.5f - 0.5f * cosf(2.0f * M_PI * i / frameSize);
+    }
+    
+    // Enough source for one block's worth of hops at the highest tempo plus a
+    // full frame and search range on either side
+    int hopsPerBlock = maxBlockFrames / hop + 2;
+    int inputCapacity = static_cast<int>(ceilf(hopsPerBlock * hop * maxTempo)) + 2 * frameSize + 2 * searchRadius;
+    inputLeft.assign(inputCapacity, 0.0f);
+    inputRight.assign(inputCapacity, 0.0f);
+    inputMono.assign(inputCapacity, 0.0f);
+    
+    overlapLeft.assign(frameSize, 0.0f);
+    overlapRight.assign(frameSize, 0.0f);
+    readyLeft.assign(maxBlockFrames + hop, 0.0f);
+    readyRight.assign(maxBlockFrames + hop, 0.0f);
+    
+    reset();
+}
+
+void TimeStretcher::setTempo(float tempo) {
+    this->tempo = std::min(std::max(tempo, 1.0f / maxTempo), maxTempo);
+}
+
+void TimeStretcher::reset() {
+    inputLength = 0;
+    analysisPos = 0.0;
+    naturalPos = 0;
+    firstFrame = true;
+    readyLength = 0;
+    std::fill(overlapLeft.begin(), overlapLeft.end(), 0.0f);
+    std::fill(overlapRight.begin(), overlapRight.end(), 0.0f);
+}
+
+int TimeStretcher::inputWanted(int frames) const {
+    int missing = std::min(frames, maxBlockFrames) - readyLength;
+    if (missing <= 0) return 0;
+    
+    // The last hop this block needs must be able to search its full range
+    int hops = (missing + hop - 1) / hop;
+    double lastTarget = analysisPos + static_cast<double>(hops - 1) * hop * tempo;
+    int required = static_cast<int>(ceil(lastTarget)) + searchRadius + frameSize + 1;
+    int capacity = static_cast<int>(inputLeft.size());
+    return std::max(0, std::min(required, capacity) - inputLength);
+}
+
+void TimeStretcher::write(const float* left, const float* right, int frames) {
+    frames = std::min(frames, static_cast<int>(inputLeft.size()) - inputLength);
+    for (int i = 0; i < frames; i++) {
+        inputLeft[inputLength + i] = left[i];
+        inputRight[inputLength + i] = right[i];
+        inputMono[inputLength + i] = left[i] + right[i];
+    }
+    inputLength += frames;
+}
+
+// Normalised correlation of the candidate frame start with the natural
+// continuation of the previous frame, over the overlap, every `step` samples
+float TimeStretcher::similarity(int candidate, int step) const {
+    const float* a = inputMono.data() + candidate;
+    const float* b = inputMono.data() + naturalPos;
+    float dot = 0.0f;
+    float energy = 1e-9f;
+    for (int i = 0; i < hop; i += step) {
+        dot += a[i] * b[i];
+        energy += a[i] * a[i];
+    }
+    return dot / sqrtf(energy);
+}
+
+int TimeStretcher::findBestPosition(int target) const {
+    int lo = std::max(target - searchRadius, 0);
+    int hi = target + searchRadius;
+    
+    // Coarse pass on every 4th offset and sample, then refine around the best
+    int best = target;
+    float bestScore = -1e30f;
+    for (int candidate = lo; candidate <= hi; candidate += 4) {
+        float score = similarity(candidate, 4);
+        if (score > bestScore) {
+            bestScore = score;
+            best = candidate;
+        }
+    }
+    
+    int coarse = best;
+    bestScore = -1e30f;
+    for (int candidate = std::max(coarse - 3, lo); candidate <= std::min(coarse + 3, hi); candidate++) {
+        float score = similarity(candidate, 1);
+        if (score > bestScore) {
+            bestScore = score;
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+void TimeStretcher::synthesizeFrame() {
+    int target = static_cast<int>(lround(analysisPos));
+    int position = firstFrame ? target : findBestPosition(target);
+    
+    // Overlap-add the windowed frame
+    for (int i = 0; i < frameSize; i++) {
+        overlapLeft[i] += inputLeft[position + i] * window[i];
+        overlapRight[i] += inputRight[position + i] * window[i];
+    }
+    
+    // The first hop of the accumulator is now complete
+    memcpy(readyLeft.data() + readyLength, overlapLeft.data(), hop * sizeof(float));
+    memcpy(readyRight.data() + readyLength, overlapRight.data(), hop * sizeof(float));
+    readyLength += hop;
+    memmove(overlapLeft.data(), overlapLeft.data() + hop, (frameSize - hop) * sizeof(float));
+    memmove(overlapRight.data(), overlapRight.data() + hop, (frameSize - hop) * sizeof(float));
+    std::fill(overlapLeft.begin() + (frameSize - hop), overlapLeft.end(), 0.0f);
+    std::fill(overlapRight.begin() + (frameSize - hop), overlapRight.end(), 0.0f);
+    
+    naturalPos = position + hop;
+    analysisPos += static_cast<double>(hop) * tempo;
+    firstFrame = false;
+    
+    // Drop source nothing can reach any more
+    int keepFrom = std::min(static_cast<int>(lround(analysisPos)) - searchRadius, naturalPos);
+    keepFrom = std::min(std::max(keepFrom, 0), inputLength);
+    if (keepFrom > 0) {
+        int remaining = inputLength - keepFrom;
+        memmove(inputLeft.data(), inputLeft.data() + keepFrom, remaining * sizeof(float));
+        memmove(inputRight.data(), inputRight.data() + keepFrom, remaining * sizeof(float));
+        memmove(inputMono.data(), inputMono.data() + keepFrom, remaining * sizeof(float));
+        inputLength = remaining;
+        analysisPos -= keepFrom;
+        naturalPos -= keepFrom;
+    }
+}
+
+int TimeStretcher::process(float* outputLeft, float* outputRight, int frames) {
+    frames = std::min(frames, maxBlockFrames);
+    
+    while (readyLength < frames) {
+        int target = static_cast<int>(lround(analysisPos));
+        if (target + searchRadius + frameSize > inputLength) break; // starved
+        synthesizeFrame();
+    }
+    
+    int produced = std::min(frames, readyLength);
+    memcpy(outputLeft, readyLeft.data(), produced * sizeof(float));
+    memcpy(outputRight, readyRight.data(), produced * sizeof(float));
+    std::fill(outputLeft + produced, outputLeft + frames, 0.0f);
+    std::fill(outputRight + produced, outputRight + frames, 0.0f);
+    
+    int remaining = readyLength - produced;
+    memmove(readyLeft.data(), readyLeft.data() + produced, remaining * sizeof(float));
+    memmove(readyRight.data(), readyRight.data() + produced, remaining * sizeof(float));
+    readyLength = remaining;
+    return produced;
+}
+
+// LevelMeter implementation
+
+// Absolute peak and sum of squares of a block
+static void peakAndEnergy(const float* input, int numSamples, float& peak, float& energy) {
+    Vec4 maxAbs = vecSplat(0.0f);
+    Vec4 sum = vecSplat(0.0f);
+    int i = 0;
+    for (; i + 4 <= numSamples; i += 4) {
+        Vec4 x = vecLoad(input + i);
+        maxAbs = vecMax(maxAbs, vecAbs(x));
+        sum = vecAdd(sum, vecMul(x, x));
+    }
+    
+    float lanes[4];
+    vecStore(lanes, maxAbs);
+    peak = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+    vecStore(lanes, sum);
+    energy = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < numSamples; i++) {
+        peak = std::max(peak, std::fabs(input[i]));
+        energy += input[i] * input[i];
+    }
+}
+
+static float toLufs(double power) {
+    if (power <= 0.0) return LevelMeter::kSilenceLufs;
+    return std::max(static_cast<float>(-0.691 + 10.0 * std::log10(power)), LevelMeter::kSilenceLufs);
+}
+
+LevelMeter::LevelMeter(int sampleRate, int maxBlockFrames)
+    : sampleRate(sampleRate)
+    , chunkFrames(std::max(maxBlockFrames, 1))
+    , phaseCoeffs(kOversample * kPhaseTaps)
+    , weightedLeft(chunkFrames)
+    , weightedRight(chunkFrames)
+    , splitLeft(chunkFrames)
+    , splitRight(chunkFrames)
+    , binLength(std::max(sampleRate / 10, 1)) {
+    // 48-tap windowed sinc cut off at the input Nyquist frequency. Tap m
+    // belongs to phase m % 4, so the kernel in order is already one vector
+    // per input tap; each phase is normalised to unity gain at DC.
+    const int taps = kOversample * kPhaseTaps;
+    double kernel[taps];
+    double phaseSum[kOversample] = {};
+    for (int m = 0; m < taps; m++) {
+        double t = (m - (taps - 1) * 0.5) / kOversample;
+        double x = (m + 0.5) / taps;
+        double window = 0.42 - 0.5 * std::cos(2.0 * M_PI * x) + 0.08 * std::cos(4.0 * M_PI * x);
+        kernel[m] = std::sin(M_PI * t) / (M_PI * t) * window;
+        phaseSum[m % kOversample] += kernel[m];
+    }
+    for (int m = 0; m < taps; m++) {
+        phaseCoeffs[m] = static_cast<float>(kernel[m] / phaseSum[m % kOversample]);
+    }
+    
+    for (std::vector<float>& channel : history) {
+        channel.assign(kPhaseTaps - 1 + chunkFrames, 0.0f);
+    }
+    loudnessShelf.setLoudnessShelf(static_cast<float>(sampleRate));
+    loudnessHighpass.setLoudnessHighpass(static_cast<float>(sampleRate));
+    reset();
+}
+
+void LevelMeter::reset() {
+    for (int ch = 0; ch < 2; ch++) {
+        peakHold[ch] = 0.0f;
+        truePeakHold[ch] = 0.0f;
+        meanSquare[ch] = 0.0f;
+        blockPeak[ch] = 0.0f;
+        std::fill(history[ch].begin(), history[ch].end(), 0.0f);
+    }
+    maxTruePeak = 0.0f;
+    loudnessShelf.reset();
+    loudnessHighpass.reset();
+    
+    binFill = 0;
+    binEnergy = 0.0;
+    std::fill(bins, bins + kBins, 0.0f);
+    binIndex = 0;
+    binsDone = 0;
+    momentaryLufs = kSilenceLufs;
+    shortTermLufs = kSilenceLufs;
+}
+
+void LevelMeter::process(const float* left, const float* right, int numSamples) {
+    blockPeak[0] = blockPeak[1] = 0.0f;
+    for (int done = 0; done < numSamples; ) {
+        int chunk = std::min(numSamples - done, chunkFrames);
+        processChunk(left + done, right + done, chunk);
+        done += chunk;
+    }
+}
+
+void LevelMeter::processInterleaved(const float* frames, int numSamples) {
+    float* left = splitLeft.data();
+    float* right = splitRight.data();
+    blockPeak[0] = blockPeak[1] = 0.0f;
+    for (int done = 0; done < numSamples; ) {
+        int chunk = std::min(numSamples - done, chunkFrames);
+        const float* input = frames + static_cast<size_t>(done) * 2;
+        for (int i = 0; i < chunk; i++) {
+            left[i] = input[i * 2];
+            right[i] = input[i * 2 + 1];
+        }
+        processChunk(left, right, chunk);
+        done += chunk;
+    }
 }
 
+void LevelMeter::processSilence(int numSamples) {
+    const float zeros[2] = {0.0f, 0.0f};
+    blockPeak[0] = blockPeak[1] = 0.0f;
+    applyBallistics(zeros, zeros, zeros, numSamples);
+    
+    // Whatever was in the filters is gone by the time the signal returns
+    for (std::vector<float>& channel : history) {
+        std::fill(channel.begin(), channel.begin() + (kPhaseTaps - 1), 0.0f);
+    }
+    loudnessShelf.reset();
+    loudnessHighpass.reset();
+    
+    while (numSamples > 0) {
+        int count = std::min(numSamples, binLength - binFill);
+        binFill += count;
+        numSamples -= count;
+        if (binFill == binLength) closeBin();
+    }
+}
+
+void LevelMeter::processChunk(const float* left, const float* right, int numSamples) {
+    const float* channels[2] = {left, right};
+    float peaks[2];
+    float truePeaks[2];
+    float meanSquares[2];
+    for (int ch = 0; ch < 2; ch++) {
+        float energy;
+        peakAndEnergy(channels[ch], numSamples, peaks[ch], energy);
+        meanSquares[ch] = energy / numSamples;
+        // The interpolated points fall between input samples, so a peak
+        // sitting exactly on a sample is taken from the input itself
+        truePeaks[ch] = std::max(truePeak(ch, channels[ch], numSamples), peaks[ch]);
+        blockPeak[ch] = std::max(blockPeak[ch], peaks[ch]);
+    }
+    
+    memcpy(weightedLeft.data(), left, numSamples * sizeof(float));
+    memcpy(weightedRight.data(), right, numSamples * sizeof(float));
+    loudnessShelf.process(weightedLeft.data(), weightedRight.data(), numSamples);
+    loudnessHighpass.process(weightedLeft.data(), weightedRight.data(), numSamples);
+    addLoudness(numSamples);
+    
+    applyBallistics(peaks, truePeaks, meanSquares, numSamples);
+}
+
+// Highest absolute value of the 4x oversampled block. Each input sample is
+// splatted across the four phases, so one output frame of all phases is
+// kPhaseTaps vector multiply-adds.
+float LevelMeter::truePeak(int channel, const float* input, int numSamples) {
+    const int keep = kPhaseTaps - 1;
+    float* past = history[channel].data();
+    memcpy(past + keep, input, numSamples * sizeof(float));
+    
+    Vec4 taps[kPhaseTaps];
+    for (int k = 0; k < kPhaseTaps; k++) {
+        taps[k] = vecLoad(phaseCoeffs.data() + k * kOversample);
+    }
+    
+    Vec4 maxAbs = vecSplat(0.0f);
+    for (int i = 0; i < numSamples; i++) {
+        const float* x = past + keep + i;
+        Vec4 sum = vecMul(vecSplat(x[0]), taps[0]);
+        for (int k = 1; k < kPhaseTaps; k++) {
+            sum = vecAdd(sum, vecMul(vecSplat(x[-k]), taps[k]));
+        }
+        maxAbs = vecMax(maxAbs, vecAbs(sum));
+    }
+    memmove(past, past + numSamples, keep * sizeof(float));
+    
+    float lanes[4];
+    vecStore(lanes, maxAbs);
+    return std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+}
+
+// Adds the K-weighted chunk to the open 100 ms bin, closing bins as they fill
+void LevelMeter::addLoudness(int numSamples) {
+    for (int done = 0; done < numSamples; ) {
+        int count = std::min(numSamples - done, binLength - binFill);
+        float peak;
+        float energyLeft;
+        float energyRight;
+        peakAndEnergy(weightedLeft.data() + done, count, peak, energyLeft);
+        peakAndEnergy(weightedRight.data() + done, count, peak, energyRight);
+        binEnergy += static_cast<double>(energyLeft) + energyRight;
+        binFill += count;
+        done += count;
+        if (binFill == binLength) closeBin();
+    }
+}
+
+// Loudness is read over the last 4 bins (momentary) and 30 bins (short-term),
+// or over every bin so far until that many have been seen
+void LevelMeter::closeBin() {
+    bins[binIndex] = static_cast<float>(binEnergy / binLength);
+    binIndex = (binIndex + 1) % kBins;
+    binsDone = std::min(binsDone + 1, kBins);
+    binEnergy = 0.0;
+    binFill = 0;
+    
+    double sum = 0.0;
+    for (int i = 1; i <= binsDone; i++) {
+        sum += bins[(binIndex - i + kBins) % kBins];
+        if (i == std::min(binsDone, 4)) {
+            momentaryLufs = toLufs(sum / i);
+        }
+    }
+    shortTermLufs = toLufs(sum / binsDone);
+}
+
+void LevelMeter::applyBallistics(const float* peaks, const float* truePeaks,
+                                 const float* meanSquares, int numSamples) {
+    const float rmsTime = 0.3f;
+    float fall = std::pow(10.0f, -kPeakFallDb * numSamples / (20.0f * sampleRate));
+    float smoothing = 1.0f - std::exp(-numSamples / (rmsTime * sampleRate));
+    
+    for (int ch = 0; ch < 2; ch++) {
+        peakHold[ch] = std::max(peaks[ch], peakHold[ch] * fall);
+        truePeakHold[ch] = std::max(truePeaks[ch], truePeakHold[ch] * fall);
+        meanSquare[ch] += (meanSquares[ch] - meanSquare[ch]) * smoothing;
+        maxTruePeak = std::max(maxTruePeak, truePeaks[ch]);
+    }
+}
+
+MeterReading LevelMeter::getReading() const {
+    MeterReading reading;
+    for (int ch = 0; ch < 2; ch++) {
+        reading.peak[ch] = peakHold[ch];
+        reading.truePeak[ch] = truePeakHold[ch];
+        reading.rms[ch] = std::sqrt(meanSquare[ch]);
+    }
+    reading.momentaryLufs = momentaryLufs;
+    reading.shortTermLufs = shortTermLufs;
+    reading.maxTruePeak = maxTruePeak;
+    return reading;
+}
+
+PowerSpectrum::PowerSpectrum(int size)
+    : size(size)
+    , half(size / 2)
+    , window(size)
+    , bitReverse(half)
+    , twiddleRe(half)
+    , twiddleIm(half)
+    , unpackRe(half + 1)
+    , unpackIm(half + 1)
+    , re(half)
+    , im(half) {
+    for (int n = 0; n < size; n++) {
+        window[n] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * M_PI * n / size));
+    }
+    
+    int bits = 0;
+    while ((1 << bits) < half) bits++;
+    for (int n = 0; n < half; n++) {
+        int reversed = 0;
+        for (int b = 0; b < bits; b++) {
+            reversed |= ((n >> b) & 1) << (bits - 1 - b);
+        }
+        bitReverse[n] = reversed;
+    }
+    
+    for (int span = 1; span < half; span *= 2) {
+        for (int j = 0; j < span; j++) {
+            double angle = -M_PI * j / span;
+            twiddleRe[span - 1 + j] = static_cast<float>(std::cos(angle));
+            twiddleIm[span - 1 + j] = static_cast<float>(std::sin(angle));
+        }
+    }
+    for (int k = 0; k <= half; k++) {
+        double angle = -2.0 * M_PI * k / size;
+        unpackRe[k] = static_cast<float>(std::cos(angle));
+        unpackIm[k] = static_cast<float>(std::sin(angle));
+    }
+}
+
+// In-place radix-2 FFT of re/im, already in bit-reversed order. From a span
+// of four on, each butterfly group is vectorised across j.
+void PowerSpectrum::transform() {
+    float* xr = re.data();
+    float* xi = im.data();
+    
+    for (int span = 1; span < half; span *= 2) {
+        const float* wr = twiddleRe.data() + span - 1;
+        const float* wi = twiddleIm.data() + span - 1;
+        for (int start = 0; start < half; start += span * 2) {
+            float* ar = xr + start;
+            float* ai = xi + start;
+            float* br = ar + span;
+            float* bi = ai + span;
+            int j = 0;
+            if (span >= 4) {
+                for (; j < span; j += 4) {
+                    Vec4 twr = vecLoad(wr + j);
+                    Vec4 twi = vecLoad(wi + j);
+                    Vec4 vbr = vecLoad(br + j);
+                    Vec4 vbi = vecLoad(bi + j);
+                    Vec4 tr = vecSub(vecMul(vbr, twr), vecMul(vbi, twi));
+                    Vec4 ti = vecAdd(vecMul(vbr, twi), vecMul(vbi, twr));
+                    Vec4 var = vecLoad(ar + j);
+                    Vec4 vai = vecLoad(ai + j);
+                    vecStore(br + j, vecSub(var, tr));
+                    vecStore(bi + j, vecSub(vai, ti));
+                    vecStore(ar + j, vecAdd(var, tr));
+                    vecStore(ai + j, vecAdd(vai, ti));
+                }
+            }
+            for (; j < span; j++) {
+                float tr = br[j] * wr[j] - bi[j] * wi[j];
+                float ti = br[j] * wi[j] + bi[j] * wr[j];
+                br[j] = ar[j] - tr;
+                bi[j] = ai[j] - ti;
+                ar[j] += tr;
+                ai[j] += ti;
+            }
+        }
+    }
+}
+
+// Even samples go in the real part and odd ones in the imaginary part; the
+// spectrum of each is then separated from the half-length result with
+// X[k] = E[k] + W^k O[k]
+void PowerSpectrum::process(const float* input, float* power) {
+    for (int n = 0; n < half; n++) {
+        int target = bitReverse[n];
+        re[target] = input[2 * n] * window[2 * n];
+        im[target] = input[2 * n + 1] * window[2 * n + 1];
+    }
+    transform();
+    
+    for (int k = 0; k <= half; k++) {
+        int a = (k < half) ? k : 0;
+        int b = (k > 0) ? half - k : 0;
+        float evenRe = 0.5f * (re[a] + re[b]);
+        float evenIm = 0.5f * (im[a] - im[b]);
+        float oddRe = 0.5f * (im[a] + im[b]);
+        float oddIm = -0.5f * (re[a] - re[b]);
+        float xr = evenRe + unpackRe[k] * oddRe - unpackIm[k] * oddIm;
+        float xi = evenIm + unpackRe[k] * oddIm + unpackIm[k] * oddRe;
+        power[k] = xr * xr + xi * xi;
+    }
+}
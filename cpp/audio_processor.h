@@ -2,6 +2,7 @@
 
 #include <cmath>
 #include <cstring>
+#include <vector>
 
 // Biquad filter for EQ and effects
 class BiquadFilter {
@@ -12,28 +13,290 @@ public:
     void setPeaking(float freq, float q, float gain, float sampleRate);
     void setLowshelf(float freq, float q, float gain, float sampleRate);
     void setHighshelf(float freq, float q, float gain, float sampleRate);
+    // The two stages of the ITU-R BS.1770 K-weighting curve, exact at 48 kHz
+    void setLoudnessShelf(float sampleRate);
+    void setLoudnessHighpass(float sampleRate);
     void reset();
     float process(float input);
     
-private:
+protected:
     void setCoefficients(float b0, float b1, float b2, float a0, float a1, float a2);
     float b0, b1, b2, a1, a2;
+    
+private:
     float x1, x2, y1, y2; // Filter state
 };
 
-// Delay line for echo/flanger/reverb
+// Biquad over a stereo pair: one set of coefficients, with the per-channel
+// state stored structure-of-arrays so left and right run in one SIMD vector.
+// Uses transposed direct form II, which needs two state values per channel.
+class StereoBiquad : public BiquadFilter {
+public:
+    StereoBiquad();
+    void reset();
+    void process(float* left, float* right, int numSamples);
+    
+private:
+    float s1[2];
+    float s2[2];
+};
+
+// Delay line for echo/flanger/reverb. Storage is rounded up to a power of two
+// so positions wrap with a mask. read(1) is the most recently written sample.
+// Movable but not copyable.
 class DelayLine {
 public:
-    DelayLine(int maxDelay);
-    ~DelayLine();
-    void write(float sample);
-    float read(int delay);
+    explicit DelayLine(int maxDelay);
+    DelayLine(DelayLine&& other) noexcept = default;
+    DelayLine& operator=(DelayLine&& other) noexcept = default;
+    DelayLine(const DelayLine&) = delete;
+    DelayLine& operator=(const DelayLine&) = delete;
+    
+    void write(float sample) {
+        buffer[writePos] = sample;
+        writePos = (writePos + 1) & mask;
+    }
+    
+    float read(int delay) const {
+        return buffer[(writePos - delay) & mask];
+    }
+    
+    // Fractional taps; delay is clamped to [1, maxDelay] ([2, maxDelay] for
+    // cubic, which also needs the sample after the tap)
+    float readLinear(float delay) const;
+    float readCubic(float delay) const;
+    
+    // First-order allpass interpolation: flat magnitude response, but it keeps
+    // state, so use it for one fixed or slowly moving tap per line
+    float readAllpass(float delay);
+    
+    // Block access. readBlock returns what read(delay) would give before each
+    // of the next numSamples writes, so it needs delay >= numSamples.
+    void writeBlock(const float* input, int numSamples);
+    void readBlock(int delay, float* output, int numSamples) const;
+    
+    void clear();
     int getMaxDelay() const { return maxDelay; }
     
 private:
-    float* buffer;
+    std::vector<float> buffer;
     int maxDelay;
+    int mask;
+    int writePos;
+    float allpassState;
+};
+
+// Eight-line feedback delay network reverb. The lines are the lanes of two
+// 4-wide SIMD vectors, so per sample the damping, the Hadamard mix and the
+// decay gains are a handful of vector operations. Stereo input feeds
+// alternate lines and alternate lines form each output.
+class FdnReverb {
+public:
+    FdnReverb(int sampleRate);
+    
+    // Time for the tail to fall by 60 dB
+    void setDecay(float seconds);
+    // Corner of the in-loop lowpass; lower is darker
+    void setDamping(float cutoffHz);
+    void reset();
+    
+    // Writes the wet signal only
+    void process(const float* inputLeft, const float* inputRight,
+                 float* wetLeft, float* wetRight, int numSamples);
+    
+    static const int kLines = 8;
+    static const int kChunk = 256;
+    
+private:
+    void processChunk(const float* inputLeft, const float* inputRight,
+                      float* wetLeft, float* wetRight, int numSamples);
+    
+    int sampleRate;
+    int lineDelay[kLines];
+    float lineGain[kLines];
+    float damping;
+    float dampState[kLines];
+    
+    // All lines share one ring of 8-float frames; line k is lane k
+    std::vector<float> lines;
+    int lineSize;
+    int lineMask;
     int writePos;
+    
+    DelayLine preDelayLeft;
+    DelayLine preDelayRight;
+    int preDelay;
+    int chunkLimit;
+};
+
+// WSOLA time stretch for key-lock: changes tempo without changing pitch.
+// Source audio is written in order and output is pulled at the output rate.
+// Every synthesis hop is one bounded similarity search plus one overlap-add,
+// so the cost of a block depends only on its length, never on the signal.
+class TimeStretcher {
+public:
+    TimeStretcher(int sampleRate, int maxBlockFrames, float maxTempo);
+    
+    // Source frames consumed per output frame (1 = original tempo)
+    void setTempo(float tempo);
+    float getTempo() const { return tempo; }
+    void reset();
+    
+    // Source frames to write() before process() can produce `frames` frames
+    int inputWanted(int frames) const;
+    void write(const float* left, const float* right, int frames);
+    
+    // Produce up to maxBlockFrames frames; returns how many were available
+    // (the rest are zeroed)
+    int process(float* outputLeft, float* outputRight, int frames);
+    
+    // Delay from the newest source frame written to the output, in frames
+    int getLatency() const { return frameSize + searchRadius; }
+    
+    // Frames between the newest one written and the one the next output frame
+    // is taken from; follows the buffer fill, unlike getLatency()
+    double getSourceDelay() const { return inputLength - analysisPos + readyLength * static_cast<double>(tempo); }
+    
+private:
+    void synthesizeFrame();
+    int findBestPosition(int target) const;
+    float similarity(int candidate, int step) const;
+    
+    int frameSize;
+    int hop;
+    int searchRadius;
+    int maxBlockFrames;
+    float tempo;
+    float maxTempo;
+    
+    std::vector<float> window;
+    
+    // Source frames not yet consumed; index 0 is the oldest one still needed
+    std::vector<float> inputLeft;
+    std::vector<float> inputRight;
+    std::vector<float> inputMono;
+    int inputLength;
+    double analysisPos; // ideal start of the next frame
+    int naturalPos;     // where the previous frame would continue
+    bool firstFrame;
+    
+    // Overlap-add accumulator and finished output
+    std::vector<float> overlapLeft;
+    std::vector<float> overlapRight;
+    std::vector<float> readyLeft;
+    std::vector<float> readyRight;
+    int readyLength;
+};
+
+// One set of meter readings. Levels are linear (1 = full scale) and loudness
+// is in LUFS. Only floats, so a reading can be copied as is into shared
+// memory or a Wasm heap array.
+struct MeterReading {
+    float peak[2];       // sample peak, left and right
+    float truePeak[2];   // 4x oversampled peak (BS.1770 annex 2)
+    float rms[2];        // 300 ms exponential average
+    float momentaryLufs; // EBU R128, 400 ms window
+    float shortTermLufs; // EBU R128, 3 s window
+    float maxTruePeak;   // highest true peak since the last clear (clip light)
+};
+
+// Peak, true-peak, RMS and loudness meter for one stereo signal. Peaks jump
+// to the highest value of each block and fall at kPeakFallDb per second;
+// loudness is K-weighted energy summed into 100 ms bins. Every block costs
+// the same whatever the signal, and nothing allocates after construction.
+class LevelMeter {
+public:
+    LevelMeter(int sampleRate, int maxBlockFrames);
+    
+    void process(const float* left, const float* right, int numSamples);
+    void processInterleaved(const float* frames, int numSamples);
+    // Let the readings fall as if numSamples of silence had been metered,
+    // without filtering anything; for a stopped deck
+    void processSilence(int numSamples);
+    void reset();
+    void clearMaxTruePeak() { maxTruePeak = 0.0f; }
+    
+    MeterReading getReading() const;
+    // Sample peak of the last process call, without ballistics
+    float getBlockPeak(int channel) const { return blockPeak[channel]; }
+    
+    static constexpr float kPeakFallDb = 20.0f;  // per second
+    static constexpr float kSilenceLufs = -70.0f; // R128 absolute gate
+    static constexpr int kOversample = 4;
+    static constexpr int kPhaseTaps = 12;
+    static constexpr int kBins = 30; // 100 ms loudness bins, enough for 3 s
+    
+private:
+    void processChunk(const float* left, const float* right, int numSamples);
+    float truePeak(int channel, const float* input, int numSamples);
+    void addLoudness(int numSamples);
+    void closeBin();
+    void applyBallistics(const float* peaks, const float* truePeaks,
+                         const float* meanSquares, int numSamples);
+    
+    int sampleRate;
+    int chunkFrames;
+    
+    float peakHold[2];
+    float truePeakHold[2];
+    float meanSquare[2];
+    float maxTruePeak;
+    float blockPeak[2];
+    
+    // Polyphase interpolator: tap k of all four phases is one vector, and each
+    // channel keeps the last kPhaseTaps - 1 inputs ahead of the new block
+    std::vector<float> phaseCoeffs;
+    std::vector<float> history[2];
+    
+    // K-weighted copy of the chunk
+    StereoBiquad loudnessShelf;
+    StereoBiquad loudnessHighpass;
+    std::vector<float> weightedLeft;
+    std::vector<float> weightedRight;
+    std::vector<float> splitLeft; // deinterleaved input
+    std::vector<float> splitRight;
+    
+    int binLength;
+    int binFill;
+    double binEnergy;
+    float bins[kBins];
+    int binIndex;
+    int binsDone;
+    float momentaryLufs;
+    float shortTermLufs;
+};
+
+// Hann-windowed power spectrum of a real block whose length is a power of
+// two. The block is packed into a complex FFT of half the length, whose
+// butterflies run four at a time; nothing allocates after construction.
+class PowerSpectrum {
+public:
+    explicit PowerSpectrum(int size); // a power of two, at least 16
+    
+    int getSize() const { return size; }
+    int getBinCount() const { return size / 2 + 1; }
+    
+    // |X[k]|^2 of `size` input samples for bins 0..size/2 (bin k is at
+    // k * sampleRate / size)
+    void process(const float* input, float* power);
+    
+private:
+    void transform();
+    
+    int size;
+    int half; // points in the complex FFT
+    std::vector<float> window;
+    std::vector<int> bitReverse;
+    
+    // Twiddles of each stage in turn (stage with span h starts at h - 1), and
+    // those that unpack the real spectrum
+    std::vector<float> twiddleRe;
+    std::vector<float> twiddleIm;
+    std::vector<float> unpackRe;
+    std::vector<float> unpackIm;
+    
+    std::vector<float> re;
+    std::vector<float> im;
 };
 
 // Processing parameters
@@ -59,29 +322,43 @@ public:
     void setEQ(int band, float value); // 0=low, 1=mid, 2=high
     void setEffect(int effect, bool enabled); // 0=flanger, 1=filter, 2=echo, 3=reverb
     
+    // Mono input is processed as a centred stereo signal; output is the left channel
     void process(float* input, float* output, int numSamples);
+    
+    // Outputs may alias the inputs
     void processStereo(float* inputLeft, float* inputRight, 
                       float* outputLeft, float* outputRight, 
                       int numSamples);
     
+    // Frames per internal block; longer buffers are processed in pieces
+    static const int kBlockSize = 256;
+    
 private:
+    void processBlock(float* left, float* right, int numSamples);
+    void flangerBlock(float* left, float* right, int numSamples);
+    void echoBlock(float* left, float* right, int numSamples);
+    void reverbBlock(float* left, float* right, int numSamples);
+    
     int sampleRate;
     ProcessingParams params;
     
     // EQ filters
-    BiquadFilter lowFilter;
-    BiquadFilter midFilter;
-    BiquadFilter highFilter;
+    StereoBiquad lowFilter;
+    StereoBiquad midFilter;
+    StereoBiquad highFilter;
     
     // Effect filters
-    BiquadFilter filterEffect;
+    StereoBiquad filterEffect;
+    
+    // Delay lines, one per channel
+    DelayLine flangerDelayLeft;
+    DelayLine flangerDelayRight;
+    DelayLine echoDelayLeft;
+    DelayLine echoDelayRight;
     
-    // Delay lines
-    DelayLine flangerDelayLine;
-    DelayLine echoDelayLine;
-    DelayLine reverbDelayLine;
+    FdnReverb reverb;
     
-    // Flanger LFO
+    // Flanger LFO, advanced once per stereo frame
     float flangerPhase;
     float flangerDelay;
 };
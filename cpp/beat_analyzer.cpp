@@ -0,0 +1,282 @@
+#include "beat_analyzer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "audio_processor.h"
+
+// Analysis runs at about 11 kHz with 128-sample hops (11.6 ms)
+static const double kAnalysisRate = 11025.0;
+static const int kHop = 128;
+static const int kBands = 4;
+static const int kCombLength = 4;
+
+// Linear interpolation into an envelope; zero past either end
+static float envelopeAt(const std::vector<float>& envelope, double position) {
+    if (position < 0.0) return 0.0f;
+    size_t index = static_cast<size_t>(position);
+    if (index + 1 >= envelope.size()) return 0.0f;
+    float frac = static_cast<float>(position - index);
+    return envelope[index] + (envelope[index + 1] - envelope[index]) * frac;
+}
+
+BeatAnalyzer::BeatAnalyzer(double minBpm, double maxBpm)
+    : min_bpm_(minBpm)
+    , max_bpm_(std::max(maxBpm, minBpm * 1.01))
+    , sample_rate_(0)
+    , decimation_(1)
+    , analysis_rate_(0.0)
+    , source_frames_(0)
+    , envelope_rate_(0.0) {
+}
+
+void BeatAnalyzer::setSource(const float* left, const float* right, size_t frames, int sampleRate) {
+    setSource(frames, sampleRate, [left, right](size_t start, size_t count, float* outLeft, float* outRight) {
+        memcpy(outLeft, left + start, count * sizeof(float));
+        memcpy(outRight, right + start, count * sizeof(float));
+    });
+}
+
+// Mono mix averaged over `decimation_` frames. The average is a weak
+// anti-alias filter, but onsets only need the envelope of each band.
+void BeatAnalyzer::setSource(size_t frames, int sampleRate, const FrameReader& read) {
+    const size_t blockPoints = 4096;
+
+    sample_rate_ = std::max(sampleRate, 1);
+    source_frames_ = frames;
+    decimation_ = std::max(1, static_cast<int>(std::lround(sample_rate_ / kAnalysisRate)));
+    analysis_rate_ = static_cast<double>(sample_rate_) / decimation_;
+    envelope_.clear();
+    low_envelope_.clear();
+    mono_.assign(frames / decimation_, 0.0f);
+
+    std::vector<float> left(blockPoints * decimation_);
+    std::vector<float> right(blockPoints * decimation_);
+    float scale = 0.5f / decimation_;
+    for (size_t done = 0; done < mono_.size(); ) {
+        size_t points = std::min(blockPoints, mono_.size() - done);
+        read(done * decimation_, points * decimation_, left.data(), right.data());
+        for (size_t i = 0; i < points; i++) {
+            float sum = 0.0f;
+            for (int d = 0; d < decimation_; d++) {
+                sum += left[i * decimation_ + d] + right[i * decimation_ + d];
+            }
+            mono_[done + i] = sum * scale;
+        }
+        done += points;
+    }
+}
+
+// Spectral flux from a filterbank: per hop, the log energy of each band, and
+// the sum of the rises since the previous hop. The result is smoothed and
+// has its local mean removed, so sustained loud passages don't count as
+// onsets.
+void BeatAnalyzer::computeEnvelope() {
+    const float compression = 1000.0f;
+    const int meanRadius = 24; // hops, about 0.28 s either side
+    float rate = static_cast<float>(analysis_rate_);
+
+    BiquadFilter lowBand;
+    BiquadFilter lowMidCut;
+    BiquadFilter lowMidTop;
+    BiquadFilter highMidCut;
+    BiquadFilter highMidTop;
+    BiquadFilter highBand;
+    lowBand.setLowpass(120.0f, 0.7071f, rate);
+    lowMidCut.setHighpass(120.0f, 0.7071f, rate);
+    lowMidTop.setLowpass(500.0f, 0.7071f, rate);
+    highMidCut.setHighpass(500.0f, 0.7071f, rate);
+    highMidTop.setLowpass(2000.0f, 0.7071f, rate);
+    highBand.setHighpass(2000.0f, 0.7071f, rate);
+
+    size_t hops = mono_.size() / kHop;
+    std::vector<float> flux(hops, 0.0f);
+    low_envelope_.assign(hops, 0.0f);
+    envelope_rate_ = analysis_rate_ / kHop;
+
+    float previous[kBands] = {};
+    for (size_t hop = 0; hop < hops; hop++) {
+        float energy[kBands] = {};
+        const float* x = mono_.data() + hop * kHop;
+        for (int i = 0; i < kHop; i++) {
+            float low = lowBand.process(x[i]);
+            float lowMid = lowMidTop.process(lowMidCut.process(x[i]));
+            float highMid = highMidTop.process(highMidCut.process(x[i]));
+            float high = highBand.process(x[i]);
+            energy[0] += low * low;
+            energy[1] += lowMid * lowMid;
+            energy[2] += highMid * highMid;
+            energy[3] += high * high;
+        }
+
+        float sum = 0.0f;
+        for (int band = 0; band < kBands; band++) {
+            float level = std::log1p(compression * energy[band] / kHop);
+            float rise = (hop > 0) ? std::max(level - previous[band], 0.0f) : 0.0f;
+            previous[band] = level;
+            sum += rise;
+            if (band == 0) low_envelope_[hop] = rise;
+        }
+        flux[hop] = sum;
+    }
+
+    // [1 2 1] smoothing widens the one-hop spikes so lags and phases between
+    // hops still see them, then the running mean is subtracted
+    envelope_.assign(hops, 0.0f);
+    for (size_t i = 1; i + 1 < hops; i++) {
+        envelope_[i] = 0.25f * flux[i - 1] + 0.5f * flux[i] + 0.25f * flux[i + 1];
+    }
+    std::vector<double> prefix(hops + 1, 0.0);
+    for (size_t i = 0; i < hops; i++) {
+        prefix[i + 1] = prefix[i] + envelope_[i];
+    }
+    for (size_t i = 0; i < hops; i++) {
+        size_t first = (i > meanRadius) ? i - meanRadius : 0;
+        size_t last = std::min(hops, i + meanRadius + 1);
+        float mean = static_cast<float>((prefix[last] - prefix[first]) / (last - first));
+        flux[i] = std::max(envelope_[i] - mean, 0.0f);
+    }
+    envelope_.swap(flux);
+}
+
+// Period in envelope frames: the lag in the tempo range whose autocorrelation
+// summed over its first kCombLength multiples is largest, weighted by a
+// log-normal preference around 120 BPM that settles octave ambiguities
+double BeatAnalyzer::estimatePeriod() const {
+    const double preferredBpm = 120.0;
+    const double lagStep = 0.25;
+    const std::vector<float>& envelope = envelope_;
+    size_t length = envelope.size();
+
+    double minLag = 60.0 * envelope_rate_ / max_bpm_;
+    double maxLag = 60.0 * envelope_rate_ / min_bpm_;
+    size_t lastLag = static_cast<size_t>(std::ceil(maxLag * kCombLength)) + 1;
+    if (lastLag + 1 >= length) return 0.0;
+
+    std::vector<double> autocorrelation(lastLag + 1, 0.0);
+    for (size_t lag = 1; lag <= lastLag; lag++) {
+        double sum = 0.0;
+        for (size_t i = 0; i + lag < length; i++) {
+            sum += envelope[i] * envelope[i + lag];
+        }
+        autocorrelation[lag] = sum / (length - lag);
+    }
+    auto autocorrelationAt = [&](double lag) {
+        size_t index = static_cast<size_t>(lag);
+        double frac = lag - index;
+        return autocorrelation[index] + (autocorrelation[index + 1] - autocorrelation[index]) * frac;
+    };
+
+    double bestLag = 0.0;
+    double bestScore = 0.0;
+    for (double lag = minLag; lag <= maxLag; lag += lagStep) {
+        double score = 0.0;
+        for (int multiple = 1; multiple <= kCombLength; multiple++) {
+            score += autocorrelationAt(lag * multiple);
+        }
+        double octaves = std::log2(60.0 * envelope_rate_ / lag / preferredBpm);
+        score *= std::exp(-0.5 * octaves * octaves);
+        if (score > bestScore) {
+            bestScore = score;
+            bestLag = lag;
+        }
+    }
+
+    // A pulse at every other beat of the winner (drum and bass against its
+    // half-time feel) means the faster tempo, if it is in range
+    double halfLag = bestLag * 0.5;
+    if (halfLag >= minLag && autocorrelationAt(halfLag) >= 0.7 * autocorrelationAt(bestLag)) {
+        bestLag = halfLag;
+    }
+    return bestLag;
+}
+
+// Mean envelope value along the grid phase + n * period
+double BeatAnalyzer::alignmentScore(const std::vector<float>& envelope, double period, double phase,
+                                    int& beats) const {
+    double sum = 0.0;
+    beats = 0;
+    for (double position = phase; position + 1.0 < envelope.size(); position += period) {
+        sum += envelopeAt(envelope, position);
+        beats++;
+    }
+    return beats > 0 ? sum / beats : 0.0;
+}
+
+// Narrow the period in three passes of +/- 2%, 0.1% and 0.005% around the
+// estimate, each time taking the best phase for every candidate. The last
+// pass resolves about 0.001 BPM, which over a long track is the difference
+// between a grid that stays on the beat and one that drifts off it.
+void BeatAnalyzer::refineGrid(double& period, double& phase, double& confidence) const {
+    const double spans[] = {0.02, 0.001, 0.00005};
+    const int steps = 20;
+    int beats = 0;
+
+    auto bestPhase = [&](double candidate, double phaseStep, double& bestAt, double* meanScore) {
+        double best = -1.0;
+        double total = 0.0;
+        int count = 0;
+        for (double offset = 0.0; offset < candidate; offset += phaseStep) {
+            double score = alignmentScore(envelope_, candidate, offset, beats);
+            total += score;
+            count++;
+            if (score > best) {
+                best = score;
+                bestAt = offset;
+            }
+        }
+        if (meanScore) *meanScore = count > 0 ? total / count : 0.0;
+        return best;
+    };
+
+    for (double span : spans) {
+        double center = period;
+        double bestScore = -1.0;
+        for (int step = -steps; step <= steps; step++) {
+            double candidate = center * (1.0 + span * step / steps);
+            double offset = 0.0;
+            double score = bestPhase(candidate, 0.5, offset, nullptr);
+            if (score > bestScore) {
+                bestScore = score;
+                period = candidate;
+            }
+        }
+    }
+
+    double meanScore = 0.0;
+    double best = bestPhase(period, 0.05, phase, &meanScore);
+    confidence = (best > 0.0) ? std::min(std::max(1.0 - meanScore / best, 0.0), 1.0) : 0.0;
+}
+
+bool BeatAnalyzer::analyze(BeatGrid& grid) {
+    const double minSeconds = 8.0;
+    if (mono_.size() < analysis_rate_ * minSeconds) return false;
+
+    computeEnvelope();
+    double period = estimatePeriod();
+    if (period <= 0.0) return false;
+
+    double phase = 0.0;
+    double confidence = 0.0;
+    refineGrid(period, phase, confidence);
+    if (confidence <= 0.0) return false;
+
+    // An onset shows up in the hop where the energy rises, so the hop start
+    // is the beat
+    double framesPerHop = static_cast<double>(kHop) * decimation_;
+    grid.beatLength = period * framesPerHop;
+    grid.firstBeat = phase * framesPerHop;
+    grid.bpm = 60.0 * sample_rate_ / grid.beatLength;
+    grid.confidence = confidence;
+    grid.beatCount = (grid.firstBeat < source_frames_)
+        ? static_cast<int32_t>((source_frames_ - grid.firstBeat) / grid.beatLength) + 1 : 0;
+
+    // Bars start on the beat phase with the most kick energy
+    double barEnergy[4] = {};
+    for (int beat = 0; beat * period + phase < low_envelope_.size(); beat++) {
+        barEnergy[beat % 4] += envelopeAt(low_envelope_, phase + beat * period);
+    }
+    grid.firstDownbeat = static_cast<int32_t>(std::max_element(barEnergy, barEnergy + 4) - barEnergy);
+    return true;
+}
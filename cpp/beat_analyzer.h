@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "audio_file.h"
+
+// Constant-tempo beatgrid in source frames of the analysed track. Beat n is
+// at firstBeat + n * beatLength for n in [0, beatCount); beats
+// firstDownbeat, firstDownbeat + 4, ... start a bar.
+struct BeatGrid {
+    double bpm;
+    double confidence; // 0 (no clear pulse) .. 1
+    double firstBeat;
+    double beatLength;
+    int32_t beatCount;
+    int32_t firstDownbeat; // 0..3
+
+    double beatFrame(int beat) const { return firstBeat + beat * beatLength; }
+};
+
+// Tempo and beatgrid detection for a whole track, meant for a background
+// thread. setSource() reduces the track to a mono signal at about 11 kHz
+// (one cheap pass, so the track can be handed off right after); analyze()
+// then works only on that copy:
+//
+//   1. a four-band filterbank gives per-hop log energies, and their
+//      half-wave rectified rise summed over bands is the onset envelope
+//      (spectral flux at 86 envelope frames per second);
+//   2. autocorrelation of the envelope, summed over the first four
+//      multiples of each lag (a comb) and weighted towards 120 BPM, picks
+//      the tempo within [minBpm, maxBpm];
+//   3. the period and phase are refined against the whole track by
+//      sampling the envelope along candidate grids, so the grid stays
+//      locked to the end of a long track;
+//   4. the bar phase is the one of four whose beats carry the most
+//      low-band (kick) onset energy.
+class BeatAnalyzer {
+public:
+    typedef std::function<void(size_t start, size_t count, float* left, float* right)> FrameReader;
+
+    BeatAnalyzer(double minBpm = 70.0, double maxBpm = 180.0);
+
+    void setSource(const AudioFile& track) {
+        setSource(track.frameCount, track.sampleRate,
+                  [&track](size_t start, size_t count, float* left, float* right) {
+                      track.readFrames(start, count, left, right);
+                  });
+    }
+    void setSource(const float* left, const float* right, size_t frames, int sampleRate);
+    void setSource(size_t frames, int sampleRate, const FrameReader& read);
+
+    // False if the source is too short or has no detectable onsets
+    bool analyze(BeatGrid& grid);
+
+private:
+    void computeEnvelope();
+    double estimatePeriod() const;
+    double alignmentScore(const std::vector<float>& envelope, double period, double phase, int& beats) const;
+    void refineGrid(double& period, double& phase, double& confidence) const;
+
+    double min_bpm_;
+    double max_bpm_;
+
+    // Source reduced to mono at analysis_rate_ = sample rate / decimation_
+    std::vector<float> mono_;
+    int sample_rate_;
+    int decimation_;
+    double analysis_rate_;
+    size_t source_frames_;
+
+    // Onset envelope, all bands and the low band alone, one value per hop
+    std::vector<float> envelope_;
+    std::vector<float> low_envelope_;
+    double envelope_rate_;
+};
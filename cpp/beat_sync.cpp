@@ -0,0 +1,31 @@
+#include "beat_sync.h"
+
+#include <algorithm>
+
+// Natural frequency (rad/s) and damping of the loop. Slow enough that a
+// correction is never heard as wow, fast enough to settle within a phrase.
+static const double kNaturalFrequency = 1.0;
+static const double kDamping = 0.8;
+
+PhaseLock::PhaseLock() : integral_(0.0), correction_(0.0) {
+}
+
+void PhaseLock::reset() {
+    integral_ = 0.0;
+    correction_ = 0.0;
+}
+
+double PhaseLock::update(double errorSeconds, double blockSeconds) {
+    const double proportionalGain = 2.0 * kDamping * kNaturalFrequency;
+    const double integralGain = kNaturalFrequency * kNaturalFrequency;
+
+    // The integral only runs while the output is unclamped, so a long pull-in
+    // doesn't wind it up and overshoot afterwards
+    double integral = integral_ + errorSeconds * blockSeconds;
+    double correction = proportionalGain * errorSeconds + integralGain * integral;
+    if (std::fabs(correction) <= kMaxCorrection) {
+        integral_ = integral;
+    }
+    correction_ = std::min(std::max(correction, -kMaxCorrection), kMaxCorrection);
+    return correction_;
+}
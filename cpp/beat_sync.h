@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cmath>
+
+#include "beat_analyzer.h"
+
+// Beats (and fractions of a beat) since the grid's first beat at a source
+// position; negative before it
+inline double beatPosition(const BeatGrid& grid, double position) {
+    return (position - grid.firstBeat) / grid.beatLength;
+}
+
+// Distance between two beat positions, wrapped to [-0.5, 0.5) beats
+inline double wrapBeats(double beats) {
+    return beats - std::floor(beats + 0.5);
+}
+
+// Second-order phase-locked loop that keeps a follower deck on the leader's
+// beats. Each block takes the phase error (follower minus leader, in seconds)
+// and returns the fraction to slow the follower by: a proportional term
+// pulling the error in over about a second, plus an integral term that
+// absorbs any steady tempo mismatch (grid rounding, the key-lock stretcher's
+// own timing), so the error settles at zero rather than at an offset.
+// Real-time safe.
+class PhaseLock {
+public:
+    // Largest correction, as a fraction of the tempo (1% is about 17 cents
+    // of pitch bend with key-lock off)
+    static constexpr double kMaxCorrection = 0.01;
+
+    PhaseLock();
+
+    void reset();
+    double update(double errorSeconds, double blockSeconds);
+    double getCorrection() const { return correction_; }
+
+private:
+    double integral_;
+    double correction_;
+};
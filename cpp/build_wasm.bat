@@ -19,10 +19,10 @@ echo Building WebAssembly audio processor...
 
 REM Compile to Wasm
 REM Store JSON strings in variables to avoid quote parsing issues
-set "EXPORTED_FUNCS=[\"_init_processors\",\"_set_deck1_volume\",\"_set_deck1_pitch\",\"_set_deck1_eq\",\"_set_deck1_effect\",\"_set_deck2_volume\",\"_set_deck2_pitch\",\"_set_deck2_eq\",\"_set_deck2_effect\",\"_set_crossfader\",\"_set_master_volume\",\"_process_deck_audio\",\"_malloc\",\"_free\"]"
+set "EXPORTED_FUNCS=[\"_init_processors\",\"_get_deck_count\",\"_set_deck_volume\",\"_set_deck_pitch\",\"_set_deck_eq\",\"_set_deck_effect\",\"_set_crossfader\",\"_set_master_volume\",\"_process_decks\",\"_process_deck_audio\",\"_set_deck_tempo\",\"_reset_deck_stretch\",\"_get_stretch_input_frames\",\"_stretch_deck_audio\",\"_get_deck_meter\",\"_get_master_meter\",\"_clear_clip_indicators\",\"_build_deck_waveform\",\"_get_waveform_point_count\",\"_get_waveform_points\",\"_analyze_beats\",\"_detect_key\",\"_malloc\",\"_free\"]"
 set "EXPORTED_METHODS=[\"ccall\",\"cwrap\",\"UTF8ToString\",\"stringToUTF8\"]"
 
-emcc audio_processor.cpp wasm_bindings.cpp -o ../public/audio_processor.js -O3 -s WASM=1 -s EXPORTED_FUNCTIONS=!EXPORTED_FUNCS! -s EXPORTED_RUNTIME_METHODS=!EXPORTED_METHODS! -s ALLOW_MEMORY_GROWTH=1 -s MODULARIZE=1 -s EXPORT_NAME=createAudioProcessorModule -s ENVIRONMENT=web,worker --no-entry
+emcc audio_processor.cpp beat_analyzer.cpp key_detector.cpp waveform.cpp wasm_bindings.cpp -o ../public/audio_processor.js -O3 -msimd128 -s WASM=1 -s EXPORTED_FUNCTIONS=!EXPORTED_FUNCS! -s EXPORTED_RUNTIME_METHODS=!EXPORTED_METHODS! -s ALLOW_MEMORY_GROWTH=1 -s MODULARIZE=1 -s EXPORT_NAME=createAudioProcessorModule -s ENVIRONMENT=web,worker --no-entry
 
 if !ERRORLEVEL! EQU 0 (
     echo.
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+// Deck layout shared by the native engine and the Wasm build. Decks are
+// numbered 1..kMaxDecks in the public APIs: the first kTrackDecks are
+// ordinary decks, the rest are sample slots, which play a loaded file once
+// from the start and then stop instead of looping.
+const int kTrackDecks = 4;
+const int kSampleSlots = 4;
+const int kMaxDecks = kTrackDecks + kSampleSlots;
+
+// Per-deck state is padded to this so two decks never share a cache line
+const size_t kCacheLineSize = 64;
+
+inline bool isSampleSlot(int deckIndex) { return deckIndex >= kTrackDecks; }
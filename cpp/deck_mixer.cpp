@@ -0,0 +1,307 @@
+#include "deck_mixer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+#ifndef M_SQRT2
+#define M_SQRT2 1.41421356237309504880
+#define M_SQRT1_2 0.70710678118654752440
+#endif
+
+DeckMixer::DeckMixer()
+    : sample_rate_(44100)
+    , max_read_step_(1.0)
+    , max_pitch_octaves_(0.0f) {
+}
+
+void DeckMixer::prepare(int sampleRate, int maxFrames, double maxReadStep, float maxPitchOctaves) {
+    sample_rate_ = sampleRate;
+    max_read_step_ = maxReadStep;
+    max_pitch_octaves_ = maxPitchOctaves;
+    scratch_left_.assign(maxFrames, 0.0f);
+    scratch_right_.assign(maxFrames, 0.0f);
+
+    for (DeckState& state : decks_) {
+        state.resampler.prepare(maxFrames, maxReadStep);
+        state.stretcher = std::make_unique<TimeStretcher>(sampleRate, maxFrames, std::exp2(maxPitchOctaves));
+
+        // Deck volume is applied in the mix, so the chain runs at unity
+        state.processor = std::make_unique<AudioProcessor>(sampleRate);
+        state.processor->setVolume(1.0f);
+        for (int band = 0; band < 3; band++) {
+            state.processor->setEQ(band, state.controls.eq[band]);
+        }
+        for (int effect = 0; effect < 4; effect++) {
+            state.processor->setEffect(effect, state.controls.effects[effect]);
+        }
+        state.meter = std::make_unique<LevelMeter>(sampleRate, maxFrames);
+    }
+}
+
+void DeckMixer::beginBlock() {
+    for (DeckState& state : decks_) {
+        state.peak[0] = 0.0f;
+        state.peak[1] = 0.0f;
+        state.rate = 0.0f;
+        state.ended = false;
+    }
+}
+
+// Tempo a deck plays at: the sync tempo while it follows, else its pitch fader
+double DeckMixer::deckTempo(const DeckState& state) const {
+    if (state.syncTempo > 0.0) return state.syncTempo;
+    float pitch = std::min(std::max(state.controls.pitch, -max_pitch_octaves_), max_pitch_octaves_);
+    return std::exp2(static_cast<double>(pitch));
+}
+
+// Source frame heard at the start of the block: the playhead and its
+// fraction, less what the key-lock stretcher is still holding back (its
+// input is already converted to the output rate)
+double DeckMixer::audiblePosition(const DeckState& state, double sourceRatio) const {
+    double position = state.position.load(std::memory_order_relaxed) + state.resampler.fraction();
+    if (state.controls.keyLock && state.stretcher) {
+        position -= state.stretcher->getSourceDelay() * sourceRatio;
+    }
+    return position;
+}
+
+// Followers take the leader's beat period, scaled by whichever power of two
+// brings them closest to their own tempo (so 87 BPM follows 174 BPM at
+// half time), and a PhaseLock trims that tempo each block to hold their
+// beats on the leader's. A follower more than kSnapSeconds out (sync just
+// engaged, play pressed, a seek) jumps straight onto the beat instead of
+// being pulled in slowly. Stopped followers only take the tempo, so a deck
+// that starts playing locks within one block. If the leader stops or has no
+// grid, followers hold their last tempo.
+void DeckMixer::syncDecks(int leaderIndex, unsigned long frames) {
+    const double kSnapSeconds = 0.025;
+    double minTempo = std::exp2(-static_cast<double>(max_pitch_octaves_));
+    double maxTempo = std::exp2(static_cast<double>(max_pitch_octaves_));
+    double blockSeconds = static_cast<double>(frames) / sample_rate_;
+
+    // Leader beat period in output frames, and its beat position
+    DeckState& leader = decks_[leaderIndex];
+    const AudioFile* leaderTrack = leader.track.load(std::memory_order_relaxed);
+    double leaderPeriod = 0.0;
+    double leaderBeat = 0.0;
+    if (leaderTrack && leader.controls.playing && leader.grid.beatLength > 0.0) {
+        double sourceRatio = static_cast<double>(leaderTrack->sampleRate) / sample_rate_;
+        leaderPeriod = leader.grid.beatLength / (sourceRatio * deckTempo(leader));
+        leaderBeat = beatPosition(leader.grid, audiblePosition(leader, sourceRatio));
+    }
+
+    for (int deckIndex = 0; deckIndex < kTrackDecks; deckIndex++) {
+        DeckState& state = decks_[deckIndex];
+        const AudioFile* audioFile = state.track.load(std::memory_order_relaxed);
+        state.phaseError = 0.0f;
+
+        if (deckIndex == leaderIndex || !state.controls.sync || !audioFile || state.grid.beatLength <= 0.0) {
+            state.syncTempo = 0.0;
+            state.phaseLock.reset();
+            continue;
+        }
+        if (leaderPeriod <= 0.0) {
+            state.phaseLock.reset();
+            continue;
+        }
+
+        double sourceRatio = static_cast<double>(audioFile->sampleRate) / sample_rate_;
+        double tempo = state.grid.beatLength / (sourceRatio * leaderPeriod);
+        double leaderBeats = 1.0; // leader beats per follower beat
+        while (tempo > M_SQRT2 && leaderBeats < 4.0) {
+            tempo *= 0.5;
+            leaderBeats *= 2.0;
+        }
+        while (tempo < M_SQRT1_2 && leaderBeats > 0.25) {
+            tempo *= 2.0;
+            leaderBeats *= 0.5;
+        }
+
+        // Beats can't be held outside the pitch range, so only the tempo is
+        // matched as closely as it allows
+        if (!state.controls.playing || tempo < minTempo || tempo > maxTempo) {
+            state.syncTempo = std::min(std::max(tempo, minTempo), maxTempo);
+            state.phaseLock.reset();
+            continue;
+        }
+
+        double beat = beatPosition(state.grid, audiblePosition(state, sourceRatio));
+        double error = wrapBeats(beat - leaderBeat / leaderBeats);
+        double beatSeconds = leaderPeriod * leaderBeats / sample_rate_;
+        if (std::fabs(error) * beatSeconds > kSnapSeconds) {
+            // Move by the error; adding whole beats to stay inside the track
+            // keeps the phase
+            double position = state.position.load(std::memory_order_relaxed) - error * state.grid.beatLength;
+            while (position < 0.0) {
+                position += state.grid.beatLength;
+            }
+            state.position.store(static_cast<size_t>(position), std::memory_order_relaxed);
+            state.resampler.reset();
+            if (state.stretcher) state.stretcher->reset();
+            state.phaseLock.reset();
+            error = 0.0;
+        }
+
+        double errorSeconds = error * beatSeconds;
+        double correction = state.phaseLock.update(errorSeconds, blockSeconds);
+        state.syncTempo = std::min(std::max(tempo * (1.0 - correction), minTempo), maxTempo);
+        state.phaseError = static_cast<float>(errorSeconds);
+    }
+}
+
+void DeckMixer::render(float* out, unsigned long start, unsigned long end, const MixSettings& settings) {
+    for (int deckIndex = 0; deckIndex < kMaxDecks; deckIndex++) {
+        DeckState& state = decks_[deckIndex];
+        if (state.controls.playing && state.track.load(std::memory_order_relaxed)) {
+            renderTrack(state, isSampleSlot(deckIndex), out, start, end, settings);
+        } else if (state.controls.playing && !isSampleSlot(deckIndex)) {
+            renderTone(state, deckIndex, out + start * 2, end - start);
+        } else {
+            state.meter->processSilence(static_cast<int>(end - start));
+        }
+    }
+}
+
+void DeckMixer::renderTrack(DeckState& state, bool oneShot, float* out, unsigned long start,
+                            unsigned long end, const MixSettings& settings) {
+    unsigned long length = end - start;
+    const AudioFile* audioFile = state.track.load(std::memory_order_relaxed);
+    const DeckControls& controls = state.controls;
+    size_t currentPos = state.position.load(std::memory_order_relaxed);
+    size_t totalSamples = audioFile->frameCount;
+    float volume = controls.volume;
+
+    // Source frames per output frame: tempo (pitch or sync) times the rate
+    // ratio. With key-lock the playhead only converts the rate and the tempo
+    // goes to the stretcher instead.
+    double tempo = deckTempo(state);
+    TimeStretcher* stretcher = controls.keyLock ? state.stretcher.get() : nullptr;
+    double step = static_cast<double>(audioFile->sampleRate) / sample_rate_;
+    if (stretcher) {
+        stretcher->setTempo(static_cast<float>(tempo));
+    } else {
+        step *= tempo;
+    }
+    step = std::min(step, max_read_step_);
+    state.rate = static_cast<float>(stretcher ? step * tempo : step);
+
+    // Read at unit rate directly; anything else goes through the deck's
+    // fractional playhead
+    StreamResampler& playhead = state.resampler;
+    bool direct = (step == 1.0 && playhead.fraction() == 0.0);
+    if (!direct) {
+        playhead.setMode(settings.mode);
+        playhead.setFilterBank(settings.ladder ? settings.ladder->select(step) : nullptr);
+    }
+
+    // Source frames left before the end, so the end can be placed on the
+    // output frame where it is reached. With key-lock that is later than the
+    // playhead suggests: the stretcher still holds frames already read.
+    double remaining = (currentPos < totalSamples)
+        ? static_cast<double>(totalSamples - currentPos) - (direct ? 0.0 : playhead.fraction()) : 0.0;
+    if (stretcher) {
+        remaining += stretcher->getSourceDelay() * step;
+    }
+
+    // Convert in scratch-sized chunks; mapped files are decoded here on demand
+    size_t nextPos = currentPos;
+    auto readSource = [&](unsigned long frames) {
+        if (!direct) {
+            nextPos += playhead.process(*audioFile, nextPos, step,
+                                        scratch_left_.data(), scratch_right_.data(), frames);
+        } else {
+            audioFile->readFrames(nextPos, frames, scratch_left_.data(), scratch_right_.data());
+            nextPos += frames;
+        }
+    };
+
+    for (unsigned long done = 0; done < length; ) {
+        unsigned long chunk = std::min<unsigned long>(length - done, scratch_left_.size());
+        if (stretcher) {
+            // Feed the stretcher through the scratch, then pull its output into it
+            for (int wanted = stretcher->inputWanted(chunk); wanted > 0; ) {
+                unsigned long feed = std::min<unsigned long>(wanted, scratch_left_.size());
+                readSource(feed);
+                stretcher->write(scratch_left_.data(), scratch_right_.data(), feed);
+                wanted -= feed;
+            }
+            stretcher->process(scratch_left_.data(), scratch_right_.data(), chunk);
+        } else {
+            readSource(chunk);
+        }
+
+        // EQ and effects, in place
+        if (AudioProcessor* processor = state.processor.get()) {
+            processor->processStereo(scratch_left_.data(), scratch_right_.data(),
+                                     scratch_left_.data(), scratch_right_.data(), chunk);
+        }
+
+        mixScratch(state, volume, out + (start + done) * 2, chunk);
+        done += chunk;
+    }
+
+    // Decks loop at the end; sample slots stop and rewind for the next trigger
+    if (nextPos >= totalSamples) {
+        nextPos = 0;
+        state.ended = true;
+        // A looping key-locked deck plays the stretcher's tail into a later
+        // block; a sample slot drops it when it stops below, so its end is
+        // heard within this segment
+        double framesBeforeEnd = std::ceil(std::max(remaining, 0.0) / state.rate);
+        if (oneShot || !stretcher) {
+            framesBeforeEnd = std::min(framesBeforeEnd, static_cast<double>(length));
+        }
+        state.endedAt = start + static_cast<unsigned long>(framesBeforeEnd);
+        if (oneShot) {
+            state.controls.playing = false;
+            playhead.reset();
+            if (state.stretcher) state.stretcher->reset();
+        }
+    }
+    state.position.store(nextPos, std::memory_order_relaxed);
+}
+
+// Test tone for a deck with nothing loaded: harmonics of A4 (440 Hz on deck 1,
+// 880 Hz on deck 2, ...)
+void DeckMixer::renderTone(DeckState& state, int deckIndex, float* out, unsigned long length) {
+    float increment = 2.0f * static_cast<float>(M_PI) * 440.0f * (deckIndex + 1) / sample_rate_;
+
+    for (unsigned long done = 0; done < length; ) {
+        unsigned long chunk = std::min<unsigned long>(length - done, scratch_left_.size());
+        for (unsigned long i = 0; i < chunk; i++) {
+            float sample = 0.1f * sinf(state.tonePhase); // Low volume test tone
+            scratch_left_[i] = sample;
+            scratch_right_[i] = sample;
+            state.tonePhase += increment;
+
+            if (state.tonePhase >= 2.0f * M_PI) {
+                state.tonePhase -= 2.0f * M_PI;
+            }
+        }
+        mixScratch(state, 1.0f, out + done * 2, chunk);
+        done += chunk;
+    }
+}
+
+// Scale the scratch by the deck volume, meter it and add it to `out`
+void DeckMixer::mixScratch(DeckState& state, float volume, float* out, unsigned long length) {
+    float* left = scratch_left_.data();
+    float* right = scratch_right_.data();
+    for (unsigned long i = 0; i < length; i++) {
+        left[i] *= volume;
+        right[i] *= volume;
+    }
+
+    LevelMeter& meter = *state.meter;
+    meter.process(left, right, static_cast<int>(length));
+    state.peak[0] = std::max(state.peak[0], meter.getBlockPeak(0));
+    state.peak[1] = std::max(state.peak[1], meter.getBlockPeak(1));
+
+    for (unsigned long i = 0; i < length; i++) {
+        out[i * 2] += left[i];
+        out[i * 2 + 1] += right[i];
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "audio_file.h"
+#include "audio_processor.h"
+#include "beat_sync.h"
+#include "deck_layout.h"
+#include "resampler.h"
+
+// Control values as seen by the audio thread; written only by applyParamEvent
+struct DeckControls {
+    bool playing = false;
+    float volume = 0.8f;
+    float pitch = 0.0f;
+    bool keyLock = false;
+    bool sync = false; // follow the sync leader's tempo and beats
+    float eq[3] = {0.0f, 0.0f, 0.0f};
+    bool effects[4] = {false, false, false, false};
+};
+
+// Everything the callback touches for one deck. The track, frame count and
+// position are also read by other threads; the rest is audio thread only.
+struct alignas(kCacheLineSize) DeckState {
+    DeckControls controls;
+    float tonePhase = 0.0f;
+    
+    // Results of the current block for telemetry; cleared by beginBlock()
+    float peak[2] = {0.0f, 0.0f}; // sample peak after the deck volume
+    float rate = 0.0f;            // source frames per output frame
+    bool ended = false;           // reached the end of the track
+    unsigned long endedAt = 0;    // output frame, from the block start, where it is heard
+
+    std::atomic<AudioFile*> track{nullptr};
+    std::atomic<size_t> frames{0};
+    std::atomic<size_t> position{0}; // in source frames
+
+    StreamResampler resampler;
+    std::unique_ptr<TimeStretcher> stretcher; // key-lock
+    std::unique_ptr<AudioProcessor> processor; // EQ and effects, at unity volume
+    std::unique_ptr<LevelMeter> meter;         // after the deck volume
+
+    // Beat sync. The grid is the current track's (beatLength 0 if unknown),
+    // refreshed by the engine before syncDecks(); syncTempo replaces the
+    // pitch fader while the deck follows the leader, and is 0 otherwise.
+    BeatGrid grid = {};
+    double syncTempo = 0.0;
+    float phaseError = 0.0f; // seconds ahead of the leader at the block start
+    PhaseLock phaseLock;
+};
+
+// How decks read between source frames, chosen on the control thread
+struct MixSettings {
+    InterpolationMode mode = InterpolationMode::Sinc;
+    const SincBankLadder* ladder = nullptr;
+};
+
+// Renders and sums every playing deck with one loop over the deck array.
+// prepare() allocates; everything else is real-time safe.
+class DeckMixer {
+public:
+    DeckMixer();
+
+    DeckMixer(const DeckMixer&) = delete;
+    DeckMixer& operator=(const DeckMixer&) = delete;
+
+    // Create each deck's playhead, stretcher, effects chain and meter for blocks of
+    // up to maxFrames. Pitch is clamped to +/- maxPitchOctaves and no deck
+    // reads more than maxReadStep source frames per output frame.
+    void prepare(int sampleRate, int maxFrames, double maxReadStep, float maxPitchOctaves);
+
+    DeckState& deck(int deckIndex) { return decks_[deckIndex]; }
+    const DeckState& deck(int deckIndex) const { return decks_[deckIndex]; }
+
+    // Clear every deck's per-block telemetry; call once per callback
+    void beginBlock();
+
+    // Set the tempo of every deck following `leaderIndex` for the next
+    // `frames` frames, and snap any that are far out of phase onto its beats.
+    // Call once per callback, before render().
+    void syncDecks(int leaderIndex, unsigned long frames);
+    
+    // Add frames [start, end) of every playing deck into the interleaved
+    // stereo buffer `out`; stopped decks meter silence
+    void render(float* out, unsigned long start, unsigned long end, const MixSettings& settings);
+
+private:
+    void renderTrack(DeckState& state, bool oneShot, float* out, unsigned long start,
+                     unsigned long end, const MixSettings& settings);
+    void renderTone(DeckState& state, int deckIndex, float* out, unsigned long length);
+    void mixScratch(DeckState& state, float volume, float* out, unsigned long length);
+    double deckTempo(const DeckState& state) const;
+    double audiblePosition(const DeckState& state, double sourceRatio) const;
+
+    int sample_rate_;
+    double max_read_step_;
+    float max_pitch_octaves_;
+    DeckState decks_[kMaxDecks];
+
+    // Per-block conversion scratch, shared by the decks in turn
+    std::vector<float> scratch_left_;
+    std::vector<float> scratch_right_;
+};
@@ -0,0 +1,140 @@
+#include "decode_stream.h"
+
+#include <algorithm>
+#include <cstring>
+
+DecodeStream::DecodeStream(std::unique_ptr<AudioDecoder> decoder)
+    : decoder_(std::move(decoder)),
+      frame_count_(decoder_->frameCount()),
+      sample_rate_(decoder_->sampleRate()),
+      head_frames_(0),
+      capacity_(0),
+      ahead_frames_(0),
+      behind_frames_(0),
+      generation_(0),
+      window_start_(0),
+      window_end_(0),
+      read_position_(0),
+      underruns_(0),
+      failed_(false) {}
+
+bool DecodeStream::open() {
+    if (frame_count_ == 0 || sample_rate_ <= 0) return false;
+
+    head_frames_ = std::min(frame_count_, static_cast<size_t>(kHeadSeconds * sample_rate_));
+    head_left_.resize(head_frames_);
+    head_right_.resize(head_frames_);
+    if (decoder_->read(head_frames_, head_left_.data(), head_right_.data()) != head_frames_) return false;
+
+    // Room for the frames kept behind the reader, the ones decoded ahead of
+    // it and the chunk in flight, so making room never touches the reader
+    ahead_frames_ = static_cast<size_t>(kAheadSeconds * sample_rate_);
+    behind_frames_ = static_cast<size_t>(kBehindSeconds * sample_rate_);
+    capacity_ = ahead_frames_ + behind_frames_ + kChunkFrames;
+    ring_left_.reset(new std::atomic<float>[capacity_]);
+    ring_right_.reset(new std::atomic<float>[capacity_]);
+    chunk_left_.resize(kChunkFrames);
+    chunk_right_.resize(kChunkFrames);
+
+    // The decoder already sits where the ring begins
+    window_start_.store(head_frames_, std::memory_order_relaxed);
+    window_end_.store(head_frames_, std::memory_order_relaxed);
+    return true;
+}
+
+void DecodeStream::read(size_t start, size_t count, float* left, float* right) const {
+    read_position_.store(start, std::memory_order_relaxed);
+
+    size_t done = 0;
+    if (start < head_frames_) {
+        done = std::min(count, head_frames_ - start);
+        memcpy(left, head_left_.data() + start, done * sizeof(float));
+        memcpy(right, head_right_.data() + start, done * sizeof(float));
+    }
+    if (done < count && start + done < frame_count_) {
+        done += copyFromRing(start + done, count - done, left + done, right + done);
+    }
+    if (done < count) {
+        if (start + done < frame_count_) underruns_.fetch_add(1, std::memory_order_relaxed);
+        std::fill(left + done, left + count, 0.0f);
+        std::fill(right + done, right + count, 0.0f);
+    }
+}
+
+size_t DecodeStream::copyFromRing(size_t start, size_t count, float* left, float* right) const {
+    uint32_t generation = generation_.load(std::memory_order_acquire);
+    size_t windowStart = window_start_.load(std::memory_order_acquire);
+    size_t windowEnd = window_end_.load(std::memory_order_acquire);
+    if (start < windowStart || start >= windowEnd) return 0;
+
+    size_t n = std::min(count, windowEnd - start);
+    size_t slot = start % capacity_;
+    for (size_t i = 0; i < n; i++) {
+        left[i] = ring_left_[slot].load(std::memory_order_relaxed);
+        right[i] = ring_right_[slot].load(std::memory_order_relaxed);
+        if (++slot == capacity_) slot = 0;
+    }
+
+    // Anything overwritten while copying moved window_start_ past `start`
+    // or bumped the generation first
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (generation_.load(std::memory_order_relaxed) != generation ||
+        window_start_.load(std::memory_order_relaxed) > start) {
+        return 0;
+    }
+    return n;
+}
+
+void DecodeStream::restart(size_t frame) {
+    generation_.store(generation_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    window_start_.store(frame, std::memory_order_release);
+    window_end_.store(frame, std::memory_order_release);
+    if (!decoder_->seek(frame)) failed_ = true;
+}
+
+bool DecodeStream::service(size_t maxFrames) {
+    if (failed_ || capacity_ == 0) return false;
+
+    size_t reader = read_position_.load(std::memory_order_relaxed);
+    // While the head plays, get the ring ready to take over from it
+    size_t anchor = std::min(std::max(reader, head_frames_), frame_count_);
+    size_t start = window_start_.load(std::memory_order_relaxed);
+    size_t end = window_end_.load(std::memory_order_relaxed);
+    if (anchor < start || anchor > end) {
+        restart(anchor);
+        if (failed_) return false;
+        start = end = anchor;
+    }
+
+    size_t target = std::min(frame_count_, anchor + ahead_frames_);
+    size_t decoded = 0;
+    while (end < target && decoded < maxFrames) {
+        size_t n = std::min(kChunkFrames, target - end);
+        // Drop the oldest frames to make room; with the ring sized as it is
+        // they are always at least kBehindSeconds behind the reader
+        if (end + n - start > capacity_) {
+            start = end + n - capacity_;
+            window_start_.store(start, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        size_t got = decoder_->read(n, chunk_left_.data(), chunk_right_.data());
+        size_t slot = end % capacity_;
+        for (size_t i = 0; i < got; i++) {
+            ring_left_[slot].store(chunk_left_[i], std::memory_order_relaxed);
+            ring_right_[slot].store(chunk_right_[i], std::memory_order_relaxed);
+            if (++slot == capacity_) slot = 0;
+        }
+        end += got;
+        window_end_.store(end, std::memory_order_release);
+        decoded += got;
+
+        // Shorter than the header promised; the rest plays as silence
+        if (got < n) {
+            failed_ = true;
+            return false;
+        }
+    }
+    return end < target;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "audio_decoder.h"
+
+// A compressed track decoded a few seconds ahead of its playhead, so memory
+// stays the same whatever the track length. The first kHeadSeconds are
+// decoded when the track opens and kept, so a deck starts playing (and loops
+// back to the top) without waiting for the decoder. Everything after that
+// passes through a ring which service() keeps filled from kBehindSeconds
+// before the reader to kAheadSeconds after it; when the reader jumps outside
+// the ring (a seek), the ring restarts there.
+//
+// read() is real-time safe and meant for one reader, the deck's playhead on
+// the audio thread; service() runs on one other thread. Ring samples are
+// relaxed atomics and the window bounds work like a sequence lock: frames
+// are only overwritten after window_start_ has moved past them, and a
+// restart bumps generation_, so a reader that finds both unchanged after
+// copying knows its copy is whole. Frames the ring doesn't hold yet read as
+// silence and count as an underrun.
+class DecodeStream {
+public:
+    static constexpr double kHeadSeconds = 2.0;
+    static constexpr double kAheadSeconds = 4.0;
+    static constexpr double kBehindSeconds = 1.0;
+    static constexpr size_t kChunkFrames = 4096;
+
+    explicit DecodeStream(std::unique_ptr<AudioDecoder> decoder);
+
+    // Decode the head; false if the decoder fails straight away
+    bool open();
+
+    size_t frameCount() const { return frame_count_; }
+    int sampleRate() const { return sample_rate_; }
+
+    // Convert `count` frames from `start`, like AudioFile::readFrames
+    void read(size_t start, size_t count, float* left, float* right) const;
+
+    // Decode toward kAheadSeconds past the reader, at most `maxFrames` this
+    // call. Returns true while there is more to do.
+    bool service(size_t maxFrames);
+
+    uint64_t underruns() const { return underruns_.load(std::memory_order_relaxed); }
+    // Head and ring, which is all the decoded audio the stream ever holds
+    size_t byteSize() const { return (head_frames_ + capacity_) * 2 * sizeof(float); }
+
+private:
+    size_t copyFromRing(size_t start, size_t count, float* left, float* right) const;
+    void restart(size_t frame);
+
+    std::unique_ptr<AudioDecoder> decoder_;
+    size_t frame_count_;
+    int sample_rate_;
+
+    size_t head_frames_;
+    std::vector<float> head_left_;
+    std::vector<float> head_right_;
+
+    // Frame f lives in slot f % capacity_ while it is in [window_start_, window_end_)
+    size_t capacity_;
+    size_t ahead_frames_;
+    size_t behind_frames_;
+    std::unique_ptr<std::atomic<float>[]> ring_left_;
+    std::unique_ptr<std::atomic<float>[]> ring_right_;
+    std::atomic<uint32_t> generation_;
+    std::atomic<size_t> window_start_;
+    std::atomic<size_t> window_end_;
+
+    mutable std::atomic<size_t> read_position_;
+    mutable std::atomic<uint64_t> underruns_;
+
+    // Decoding side only
+    std::vector<float> chunk_left_;
+    std::vector<float> chunk_right_;
+    bool failed_;
+};
@@ -0,0 +1,300 @@
+// Library analysis tool: fills the analysis cache ahead of a gig so decks
+// load with their waveform, beatgrid and key ready.
+//
+//   dj_analyze [-j threads] [--cache dir] [--max-mb n] [--force] [-q] <path>...
+//
+// Each path is an audio file (WAV, or any format openAudioDecoder knows) or a
+// directory searched recursively. Tracks whose complete results are already
+// cached are skipped unless --force is given. Every track is one job on a
+// work-stealing pool; the job maps the file, builds the waveform itself and
+// spawns the beat, key and gain passes, which idle workers steal. Nothing
+// decodes a whole track to float: the passes read the mapped PCM (or their
+// own decoder) in blocks and keep only their reduced copies, so memory grows
+// with the number of threads rather than with track length.
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "analysis_cache.h"
+#include "audio_decoder.h"
+#include "beat_analyzer.h"
+#include "gain_analyzer.h"
+#include "key_detector.h"
+#include "wav_reader.h"
+#include "waveform.h"
+#include "work_stealing_pool.h"
+
+namespace fs = std::filesystem;
+
+// Lower-case extension without the dot
+static std::string extensionOf(const std::string& path) {
+    std::string extension = fs::path(path).extension().string();
+    if (!extension.empty()) extension.erase(0, 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension;
+}
+
+static bool isAudioFile(const std::string& path) {
+    std::string extension = extensionOf(path);
+    return extension == "wav" || isDecodableExtension(extension);
+}
+
+struct Options {
+    int threads = 0;
+    std::string cacheDirectory = AnalysisCache::defaultDirectory();
+    uint64_t maxBytes = AnalysisCache::kDefaultMaxBytes;
+    bool force = false;
+    bool quiet = false;
+    std::vector<std::string> paths;
+};
+
+typedef std::function<void(size_t start, size_t count, float* left, float* right)> FrameReader;
+
+// One track in flight. The last of its passes to finish stores the results
+// and drops the track, which unmaps the file.
+struct TrackJob {
+    std::string path;
+    AudioFile track; // WAVs only
+    bool compressed = false;
+    CacheKey key;
+    CachedAnalysis results;
+    std::atomic<int> passes{0};
+};
+
+// Run `pass` over the track's frames. WAV passes share the mapping; decoders
+// can't be shared between threads, so each pass over a compressed track
+// decodes it on its own.
+static bool withReader(const TrackJob& job, const std::function<void(const FrameReader&)>& pass) {
+    if (!job.compressed) {
+        const AudioFile& track = job.track;
+        pass([&track](size_t start, size_t count, float* left, float* right) {
+            track.readFrames(start, count, left, right);
+        });
+        return true;
+    }
+    std::string error;
+    std::unique_ptr<AudioDecoder> decoder = openAudioDecoder(job.path, error);
+    if (!decoder) return false;
+    DecoderFrameReader reader(*decoder);
+    pass(std::ref(reader));
+    return true;
+}
+
+class LibraryAnalyzer {
+public:
+    explicit LibraryAnalyzer(const Options& options) : options_(options) {
+        cache_.setDirectory(options.cacheDirectory, options.maxBytes);
+    }
+
+    int run(const std::vector<std::string>& files) {
+        pool_.start(options_.threads);
+        int threads = pool_.threadCount();
+        auto start = std::chrono::steady_clock::now();
+        for (const std::string& file : files) {
+            pool_.submit([this, file] { analyzeTrack(file); });
+        }
+        pool_.wait();
+        pool_.stop();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        fprintf(stderr, "%d analysed, %d already cached, %d failed in %.1f s (%.1f tracks/s on %d threads)\n",
+                analysed_.load(), cached_.load(), failed_.load(), elapsed.count(),
+                analysed_.load() / std::max(elapsed.count(), 1e-3), threads);
+        return failed_.load() == 0 ? 0 : 1;
+    }
+
+private:
+    void analyzeTrack(const std::string& path) {
+        std::shared_ptr<TrackJob> job = std::make_shared<TrackJob>();
+        job->path = path;
+        if (!cache_.makeKey(path, job->key)) {
+            fail(path, "cannot read file");
+            return;
+        }
+        CachedAnalysis cached;
+        if (!options_.force && cache_.lookup(job->key, cached) && cached.hasGain) {
+            cached_++;
+            return;
+        }
+
+        std::string error;
+        job->compressed = isDecodableExtension(extensionOf(path));
+        if (job->compressed) {
+            std::unique_ptr<AudioDecoder> decoder = openAudioDecoder(path, error);
+            if (!decoder) {
+                fail(path, error.c_str());
+                return;
+            }
+            job->results.frameCount = decoder->frameCount();
+            job->results.sampleRate = decoder->sampleRate();
+        } else {
+            if (!readWavFile(path, job->track, SampleStorage::Mapped, 1, error)) {
+                fail(path, error.c_str());
+                return;
+            }
+            job->results.frameCount = job->track.frameCount;
+            job->results.sampleRate = job->track.sampleRate;
+        }
+
+        // The passes only read the track, so they can run side by side
+        job->passes.store(4);
+        spawn(job, [](TrackJob& track) {
+            CachedAnalysis& results = track.results;
+            withReader(track, [&results](const FrameReader& read) {
+                BeatAnalyzer beats;
+                beats.setSource(results.frameCount, results.sampleRate, read);
+                results.hasBeatgrid = beats.analyze(results.beatgrid);
+            });
+        });
+        spawn(job, [](TrackJob& track) {
+            CachedAnalysis& results = track.results;
+            withReader(track, [&results](const FrameReader& read) {
+                KeyDetector key;
+                key.setSource(results.frameCount, results.sampleRate, read);
+                results.hasKey = key.analyze(results.key);
+            });
+        });
+        spawn(job, [](TrackJob& track) {
+            CachedAnalysis& results = track.results;
+            withReader(track, [&results](const FrameReader& read) {
+                results.hasGain = analyzeTrackGain(results.frameCount, results.sampleRate, read, results.gain);
+            });
+        });
+
+        CachedAnalysis& results = job->results;
+        std::shared_ptr<WaveformPyramid> waveform = std::make_shared<WaveformPyramid>();
+        withReader(*job, [&results, &waveform](const FrameReader& read) {
+            waveform->build(results.frameCount, results.sampleRate, read);
+        });
+        results.waveform = waveform;
+        finishPass(job);
+    }
+
+    template <typename Pass>
+    void spawn(const std::shared_ptr<TrackJob>& job, Pass pass) {
+        std::function<void()> run = [this, job, pass] {
+            pass(*job);
+            finishPass(job);
+        };
+        if (!pool_.submit(run)) run();
+    }
+
+    void finishPass(const std::shared_ptr<TrackJob>& job) {
+        if (job->passes.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+        const CachedAnalysis& results = job->results;
+        if (!cache_.store(job->key, results)) {
+            fail(job->path, "cannot write cache entry");
+            return;
+        }
+        analysed_++;
+        if (options_.quiet) return;
+
+        char bpm[16] = "-";
+        char gain[40] = "-";
+        if (results.hasBeatgrid) snprintf(bpm, sizeof(bpm), "%.2f", results.beatgrid.bpm);
+        if (results.hasGain) {
+            snprintf(gain, sizeof(gain), "%.1f LUFS %+.1f dB", results.gain.integratedLufs, results.gain.gainDb);
+        }
+        std::lock_guard<std::mutex> lock(print_mutex_);
+        printf("%7s BPM  %-3s %-4s  %-22s %s\n", bpm, results.hasKey ? results.key.camelot : "-",
+               results.hasKey ? results.key.name : "", gain, job->path.c_str());
+        fflush(stdout);
+    }
+
+    void fail(const std::string& path, const char* reason) {
+        failed_++;
+        std::lock_guard<std::mutex> lock(print_mutex_);
+        fprintf(stderr, "%s: %s\n", path.c_str(), reason);
+    }
+
+    Options options_;
+    AnalysisCache cache_;
+    WorkStealingPool pool_;
+    std::mutex print_mutex_;
+    std::atomic<int> analysed_{0};
+    std::atomic<int> cached_{0};
+    std::atomic<int> failed_{0};
+};
+
+// Every audio file named or found under the given paths, sorted so runs are repeatable
+static std::vector<std::string> collectFiles(const std::vector<std::string>& paths) {
+    std::vector<std::string> files;
+    for (const std::string& path : paths) {
+        std::error_code error;
+        if (fs::is_directory(path, error)) {
+            fs::recursive_directory_iterator it(path, fs::directory_options::skip_permission_denied, error), end;
+            for (; !error && it != end; it.increment(error)) {
+                if (it->is_regular_file(error) && isAudioFile(it->path().string())) {
+                    files.push_back(it->path().string());
+                }
+            }
+        } else {
+            files.push_back(path);
+        }
+        if (error) {
+            fprintf(stderr, "%s: %s\n", path.c_str(), error.message().c_str());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+    return files;
+}
+
+static void usage() {
+    fprintf(stderr,
+            "usage: dj_analyze [options] <file or directory>...\n"
+            "  -j <n>          worker threads (default: all cores)\n"
+            "  --cache <dir>   analysis cache directory (default: the engine's)\n"
+            "  --max-mb <n>    cache size budget in MB (default: %llu)\n"
+            "  --force         analyse tracks that are already cached\n"
+            "  -q              only print the summary\n",
+            static_cast<unsigned long long>(AnalysisCache::kDefaultMaxBytes >> 20));
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "-j") == 0 && hasValue) {
+            options.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cache") == 0 && hasValue) {
+            options.cacheDirectory = argv[++i];
+        } else if (strcmp(argv[i], "--max-mb") == 0 && hasValue) {
+            options.maxBytes = static_cast<uint64_t>(std::max(atoll(argv[++i]), 1LL)) << 20;
+        } else if (strcmp(argv[i], "--force") == 0) {
+            options.force = true;
+        } else if (strcmp(argv[i], "-q") == 0) {
+            options.quiet = true;
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 2;
+        } else {
+            options.paths.push_back(argv[i]);
+        }
+    }
+    if (options.paths.empty()) {
+        usage();
+        return 2;
+    }
+    if (options.cacheDirectory.empty()) {
+        fprintf(stderr, "No cache directory; pass --cache\n");
+        return 2;
+    }
+
+    std::vector<std::string> files = collectFiles(options.paths);
+    fprintf(stderr, "Analysing %zu files into %s\n", files.size(), options.cacheDirectory.c_str());
+    LibraryAnalyzer analyzer(options);
+    return analyzer.run(files);
+}
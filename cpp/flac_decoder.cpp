@@ -0,0 +1,560 @@
+#include "flac_decoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static const size_t kNoFrame = static_cast<size_t>(-1);
+static const size_t kBisectStopBytes = 64 * 1024;
+static const uint32_t kMaxBlockSize = 65535;
+
+static uint32_t readBE16(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 8) | p[1];
+}
+
+static uint32_t readBE24(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[2];
+}
+
+static uint32_t readBE32(const uint8_t* p) {
+    return (readBE16(p) << 16) | readBE16(p + 2);
+}
+
+static uint64_t readBE64(const uint8_t* p) {
+    return (static_cast<uint64_t>(readBE32(p)) << 32) | readBE32(p + 4);
+}
+
+// Index of the highest set bit; `value` must not be zero
+static int highestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+// CRC-8 (polynomial 0x07) of frame headers and CRC-16 (0x8005) of whole
+// frames, both MSB first from zero
+static uint8_t crc8(const uint8_t* data, size_t length) {
+    static const struct Table {
+        uint8_t values[256];
+        Table() {
+            for (int i = 0; i < 256; i++) {
+                uint8_t crc = static_cast<uint8_t>(i);
+                for (int bit = 0; bit < 8; bit++) {
+                    crc = static_cast<uint8_t>((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+                }
+                values[i] = crc;
+            }
+        }
+    } table;
+    uint8_t crc = 0;
+    for (size_t i = 0; i < length; i++) {
+        crc = table.values[crc ^ data[i]];
+    }
+    return crc;
+}
+
+static uint16_t crc16(const uint8_t* data, size_t length) {
+    static const struct Table {
+        uint16_t values[256];
+        Table() {
+            for (int i = 0; i < 256; i++) {
+                uint16_t crc = static_cast<uint16_t>(i << 8);
+                for (int bit = 0; bit < 8; bit++) {
+                    crc = static_cast<uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1);
+                }
+                values[i] = crc;
+            }
+        }
+    } table;
+    uint16_t crc = 0;
+    for (size_t i = 0; i < length; i++) {
+        crc = static_cast<uint16_t>((crc << 8) ^ table.values[(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
+
+// MSB-first bit reader over one frame. Reading past the end yields zeros and
+// is reported by overrun(), so decoding never touches memory out of range.
+class FlacBitReader {
+public:
+    FlacBitReader(const uint8_t* data, size_t size)
+        : data_(data), size_(size), next_(0), cache_(0), bits_(0) {}
+
+    uint32_t read(int count) {
+        if (count == 0) return 0;
+        if (bits_ < count) refill();
+        bits_ -= count;
+        return static_cast<uint32_t>((cache_ >> bits_) & ((1ull << count) - 1));
+    }
+
+    int32_t readSigned(int count) {
+        if (count == 0) return 0;
+        uint32_t value = read(count);
+        return static_cast<int32_t>(value << (32 - count)) >> (32 - count);
+    }
+
+    // Number of zero bits before the next one bit, which is consumed too
+    uint32_t readUnary() {
+        uint32_t zeros = 0;
+        for (;;) {
+            if (bits_ == 0) {
+                if (overrun()) return zeros;
+                refill();
+            }
+            uint64_t window = (bits_ == 64) ? cache_ : cache_ & ((1ull << bits_) - 1);
+            if (window == 0) {
+                zeros += bits_;
+                bits_ = 0;
+                continue;
+            }
+            int top = highestBit(window);
+            zeros += bits_ - 1 - top;
+            bits_ = top;
+            return zeros;
+        }
+    }
+
+    void alignToByte() { bits_ -= bits_ % 8; }
+    size_t bytePosition() const { return next_ - bits_ / 8; }
+    bool overrun() const { return next_ * 8 - bits_ > size_ * 8; }
+
+private:
+    void refill() {
+        while (bits_ <= 56) {
+            uint8_t byte = (next_ < size_) ? data_[next_] : 0;
+            next_++;
+            cache_ = (cache_ << 8) | byte;
+            bits_ += 8;
+        }
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t next_;
+    uint64_t cache_;
+    int bits_;
+};
+
+FlacDecoder::FlacDecoder()
+    : data_(nullptr), size_(0), sample_rate_(0), channels_(0), bits_per_sample_(0), max_block_size_(0)
+    , total_frames_(0), first_frame_offset_(0), position_(0), next_offset_(0), block_first_frame_(0)
+    , block_size_(0), block_scale_(1.0f) {
+}
+
+bool FlacDecoder::open(const std::string& filepath, std::string& error) {
+    if (!file_.open(filepath)) {
+        error = "Could not open FLAC file: " + filepath;
+        return false;
+    }
+    data_ = file_.data();
+    size_ = file_.size();
+    if (!parseMetadata(error)) return false;
+
+    for (std::vector<int32_t>& channel : block_) {
+        channel.assign(max_block_size_, 0);
+    }
+    if (channels_ > 2) scratch_.assign(max_block_size_, 0);
+    return seek(0);
+}
+
+bool FlacDecoder::parseMetadata(std::string& error) {
+    size_t pos = 0;
+
+    // Some taggers put ID3v2 in front of the stream marker
+    if (size_ >= 10 && memcmp(data_, "ID3", 3) == 0) {
+        size_t tagSize = (static_cast<size_t>(data_[6] & 0x7F) << 21) | ((data_[7] & 0x7F) << 14) |
+                         ((data_[8] & 0x7F) << 7) | (data_[9] & 0x7F);
+        pos = 10 + tagSize + ((data_[5] & 0x10) ? 10 : 0);
+    }
+    if (pos + 4 > size_ || memcmp(data_ + pos, "fLaC", 4) != 0) {
+        error = "Not a FLAC file (missing fLaC marker)";
+        return false;
+    }
+    pos += 4;
+
+    bool haveInfo = false;
+    for (bool last = false; !last; ) {
+        if (pos + 4 > size_) {
+            error = "FLAC metadata is truncated";
+            return false;
+        }
+        last = (data_[pos] & 0x80) != 0;
+        int type = data_[pos] & 0x7F;
+        size_t length = readBE24(data_ + pos + 1);
+        pos += 4;
+        if (pos + length > size_) {
+            error = "FLAC metadata is truncated";
+            return false;
+        }
+
+        const uint8_t* block = data_ + pos;
+        if (type == 0 && length >= 34) {
+            max_block_size_ = readBE16(block + 2);
+            sample_rate_ = static_cast<int>((block[10] << 12) | (block[11] << 4) | (block[12] >> 4));
+            channels_ = ((block[12] >> 1) & 7) + 1;
+            bits_per_sample_ = (((block[12] & 1) << 4) | (block[13] >> 4)) + 1;
+            total_frames_ = (static_cast<uint64_t>(block[13] & 0x0F) << 32) | readBE32(block + 14);
+            haveInfo = true;
+        } else if (type == 3) {
+            for (size_t entry = 0; entry + 18 <= length; entry += 18) {
+                SeekPoint point;
+                point.frame = readBE64(block + entry);
+                point.offset = readBE64(block + entry + 8);
+                if (point.frame != ~0ull) seek_points_.push_back(point); // Else a placeholder
+            }
+        }
+        pos += length;
+    }
+    first_frame_offset_ = pos;
+
+    if (!haveInfo) {
+        error = "FLAC file has no STREAMINFO block";
+        return false;
+    }
+    if (sample_rate_ <= 0 || bits_per_sample_ < 4 || bits_per_sample_ > 24) {
+        error = "Unsupported FLAC stream (" + std::to_string(bits_per_sample_) + "-bit, " +
+                std::to_string(sample_rate_) + " Hz)";
+        return false;
+    }
+    if (total_frames_ == 0) {
+        error = "FLAC stream has no length in STREAMINFO";
+        return false;
+    }
+    if (max_block_size_ < 16) max_block_size_ = kMaxBlockSize;
+    std::sort(seek_points_.begin(), seek_points_.end(),
+              [](const SeekPoint& a, const SeekPoint& b) { return a.frame < b.frame; });
+    return true;
+}
+
+// Check a frame header at `offset`, including its CRC-8
+bool FlacDecoder::parseFrameHeader(size_t offset, FrameHeader& header) const {
+    static const uint32_t kSampleBits[8] = {0, 8, 12, 0, 16, 20, 24, 0};
+
+    if (offset + 6 > size_) return false;
+    const uint8_t* p = data_ + offset;
+    size_t available = size_ - offset;
+    if (p[0] != 0xFF || (p[1] & 0xFE) != 0xF8) return false;
+
+    bool variableBlocks = (p[1] & 1) != 0;
+    uint32_t blockCode = p[2] >> 4;
+    uint32_t rateCode = p[2] & 0x0F;
+    uint32_t channelCode = p[3] >> 4;
+    uint32_t sizeCode = (p[3] >> 1) & 7;
+    if (blockCode == 0 || rateCode == 15 || channelCode > 10 || (p[3] & 1) != 0) return false;
+    if (sizeCode != 0 && kSampleBits[sizeCode] == 0) return false;
+
+    // Frame or sample number, UTF-8 style
+    size_t pos = 4;
+    uint64_t number = p[pos++];
+    int extra = 0;
+    if (number >= 0x80) {
+        if ((number & 0xE0) == 0xC0) { number &= 0x1F; extra = 1; }
+        else if ((number & 0xF0) == 0xE0) { number &= 0x0F; extra = 2; }
+        else if ((number & 0xF8) == 0xF0) { number &= 0x07; extra = 3; }
+        else if ((number & 0xFC) == 0xF8) { number &= 0x03; extra = 4; }
+        else if ((number & 0xFE) == 0xFC) { number &= 0x01; extra = 5; }
+        else if (number == 0xFE) { number = 0; extra = 6; }
+        else return false;
+    }
+    if (pos + extra + 4 > available) return false;
+    for (int i = 0; i < extra; i++) {
+        if ((p[pos] & 0xC0) != 0x80) return false;
+        number = (number << 6) | (p[pos++] & 0x3F);
+    }
+
+    uint32_t blockSize;
+    if (blockCode == 1) blockSize = 192;
+    else if (blockCode <= 5) blockSize = 576u << (blockCode - 2);
+    else if (blockCode == 6) blockSize = p[pos++] + 1u;
+    else if (blockCode == 7) { blockSize = readBE16(p + pos) + 1u; pos += 2; }
+    else blockSize = 256u << (blockCode - 8);
+
+    // The rate always comes from STREAMINFO; only skip its bytes
+    if (rateCode == 12) pos += 1;
+    else if (rateCode == 13 || rateCode == 14) pos += 2;
+
+    if (pos + 1 > available || crc8(p, pos) != p[pos]) return false;
+    pos++;
+
+    header.firstFrame = variableBlocks ? number : number * max_block_size_;
+    header.blockSize = blockSize;
+    header.channelAssignment = channelCode;
+    header.bitsPerSample = sizeCode ? kSampleBits[sizeCode] : bits_per_sample_;
+    header.headerBytes = pos;
+    return header.firstFrame < total_frames_ && blockSize <= kMaxBlockSize;
+}
+
+// Offset of the first valid frame header at or after `offset`, or kNoFrame
+size_t FlacDecoder::findFrame(size_t offset, FrameHeader& header) const {
+    for (size_t pos = std::max(offset, first_frame_offset_); pos + 1 < size_; pos++) {
+        if (data_[pos] == 0xFF && (data_[pos + 1] & 0xFE) == 0xF8 && parseFrameHeader(pos, header)) {
+            return pos;
+        }
+    }
+    return kNoFrame;
+}
+
+bool FlacDecoder::decodeResidual(FlacBitReader& bits, uint32_t blockSize, uint32_t order, int32_t* out) {
+    uint32_t method = bits.read(2);
+    if (method > 1) return false;
+    int parameterBits = (method == 0) ? 4 : 5;
+    uint32_t escape = (method == 0) ? 15 : 31;
+
+    uint32_t partitionOrder = bits.read(4);
+    uint32_t partitionSize = blockSize >> partitionOrder;
+    if ((partitionSize << partitionOrder) != blockSize || partitionSize < order) return false;
+
+    uint32_t i = order;
+    for (uint32_t partition = 0; partition < (1u << partitionOrder); partition++) {
+        uint32_t count = partitionSize - (partition == 0 ? order : 0);
+        uint32_t parameter = bits.read(parameterBits);
+        if (parameter == escape) {
+            int rawBits = static_cast<int>(bits.read(5));
+            for (uint32_t n = 0; n < count; n++) {
+                out[i++] = bits.readSigned(rawBits);
+            }
+        } else {
+            for (uint32_t n = 0; n < count; n++) {
+                uint32_t quotient = bits.readUnary();
+                uint32_t value = (quotient << parameter) | bits.read(static_cast<int>(parameter));
+                out[i++] = static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+            }
+        }
+        if (bits.overrun()) return false;
+    }
+    return true;
+}
+
+bool FlacDecoder::decodeSubframe(FlacBitReader& bits, uint32_t blockSize, uint32_t bitsPerSample, int32_t* out) {
+    if (bits.read(1) != 0) return false;
+    uint32_t type = bits.read(6);
+    uint32_t wasted = 0;
+    if (bits.read(1)) {
+        wasted = bits.readUnary() + 1;
+        if (wasted >= bitsPerSample) return false;
+        bitsPerSample -= wasted;
+    }
+    int sampleBits = static_cast<int>(bitsPerSample);
+
+    if (type == 0) {
+        std::fill(out, out + blockSize, bits.readSigned(sampleBits));
+    } else if (type == 1) {
+        for (uint32_t i = 0; i < blockSize; i++) {
+            out[i] = bits.readSigned(sampleBits);
+        }
+    } else if (type >= 8 && type <= 12) {
+        uint32_t order = type - 8;
+        if (order > blockSize) return false;
+        for (uint32_t i = 0; i < order; i++) {
+            out[i] = bits.readSigned(sampleBits);
+        }
+        if (!decodeResidual(bits, blockSize, order, out)) return false;
+
+        // Fixed polynomial predictors of order 0..4
+        for (uint32_t i = order; i < blockSize; i++) {
+            int64_t prediction = 0;
+            switch (order) {
+                case 1: prediction = out[i - 1]; break;
+                case 2: prediction = 2 * static_cast<int64_t>(out[i - 1]) - out[i - 2]; break;
+                case 3: prediction = 3 * (static_cast<int64_t>(out[i - 1]) - out[i - 2]) + out[i - 3]; break;
+                case 4:
+                    prediction = 4 * (static_cast<int64_t>(out[i - 1]) + out[i - 3]) -
+                                 6 * static_cast<int64_t>(out[i - 2]) - out[i - 4];
+                    break;
+            }
+            out[i] = static_cast<int32_t>(out[i] + prediction);
+        }
+    } else if (type >= 32) {
+        uint32_t order = (type & 31) + 1;
+        if (order > blockSize) return false;
+        for (uint32_t i = 0; i < order; i++) {
+            out[i] = bits.readSigned(sampleBits);
+        }
+        int precision = static_cast<int>(bits.read(4)) + 1;
+        int shift = bits.readSigned(5);
+        if (precision == 16 || shift < 0) return false;
+        int32_t coefficients[32];
+        for (uint32_t i = 0; i < order; i++) {
+            coefficients[i] = bits.readSigned(precision);
+        }
+        if (!decodeResidual(bits, blockSize, order, out)) return false;
+
+        for (uint32_t i = order; i < blockSize; i++) {
+            int64_t sum = 0;
+            for (uint32_t j = 0; j < order; j++) {
+                sum += static_cast<int64_t>(coefficients[j]) * out[i - 1 - j];
+            }
+            out[i] = static_cast<int32_t>(out[i] + (sum >> shift));
+        }
+    } else {
+        return false; // Reserved subframe type
+    }
+
+    if (wasted) {
+        for (uint32_t i = 0; i < blockSize; i++) {
+            out[i] = static_cast<int32_t>(static_cast<uint32_t>(out[i]) << wasted);
+        }
+    }
+    return !bits.overrun();
+}
+
+// Decode the frame whose header is at `offset` into block_; returns the
+// offset just past it, or kNoFrame if it fails its CRC-16 or doesn't parse
+size_t FlacDecoder::decodeFrameAt(size_t offset, const FrameHeader& header) {
+    uint32_t channelCount = header.channelAssignment < 8 ? header.channelAssignment + 1 : 2;
+    if (header.blockSize > block_[0].size()) {
+        for (std::vector<int32_t>& channel : block_) {
+            channel.assign(header.blockSize, 0);
+        }
+    }
+    if (channelCount > 2 && scratch_.size() < header.blockSize) {
+        scratch_.assign(header.blockSize, 0);
+    }
+
+    size_t bodyOffset = offset + header.headerBytes;
+    FlacBitReader bits(data_ + bodyOffset, size_ - bodyOffset);
+    for (uint32_t channel = 0; channel < channelCount; channel++) {
+        // The side channel carries one extra bit
+        uint32_t sampleBits = header.bitsPerSample;
+        if ((header.channelAssignment == 8 && channel == 1) || (header.channelAssignment == 9 && channel == 0) ||
+            (header.channelAssignment == 10 && channel == 1)) {
+            sampleBits++;
+        }
+        int32_t* out = channel < 2 ? block_[channel].data() : scratch_.data();
+        if (!decodeSubframe(bits, header.blockSize, sampleBits, out)) return kNoFrame;
+    }
+
+    bits.alignToByte();
+    size_t end = bodyOffset + bits.bytePosition();
+    if (end + 2 > size_ || crc16(data_ + offset, end - offset) != readBE16(data_ + end)) return kNoFrame;
+
+    int32_t* left = block_[0].data();
+    int32_t* right = block_[1].data();
+    uint32_t count = header.blockSize;
+    switch (header.channelAssignment) {
+        case 0:
+            std::copy(left, left + count, right);
+            break;
+        case 8: // left, side
+            for (uint32_t i = 0; i < count; i++) right[i] = left[i] - right[i];
+            break;
+        case 9: // side, right
+            for (uint32_t i = 0; i < count; i++) left[i] += right[i];
+            break;
+        case 10: // mid, side
+            for (uint32_t i = 0; i < count; i++) {
+                int32_t side = right[i];
+                int32_t mid = static_cast<int32_t>(static_cast<uint32_t>(left[i]) << 1) | (side & 1);
+                left[i] = (mid + side) >> 1;
+                right[i] = (mid - side) >> 1;
+            }
+            break;
+    }
+
+    block_first_frame_ = header.firstFrame;
+    block_size_ = count;
+    block_scale_ = 1.0f / static_cast<float>(1u << (header.bitsPerSample - 1));
+    return end + 2;
+}
+
+// Offset of the first frame at or after `offset` that decodes intact, or
+// kNoFrame. A header alone can be matched by chance inside audio data, so
+// only a whole frame passing its CRC-16 counts; it is left in block_.
+size_t FlacDecoder::findIntactFrame(size_t offset, FrameHeader& header, size_t& end) {
+    for (;;) {
+        offset = findFrame(offset, header);
+        if (offset == kNoFrame) return kNoFrame;
+        end = decodeFrameAt(offset, header);
+        if (end != kNoFrame) return offset;
+        offset += 2;
+    }
+}
+
+// Decode the next intact frame from next_offset_ into block_. Damaged frames
+// are skipped, and read() turns the gap they leave into silence.
+bool FlacDecoder::decodeFrame() {
+    FrameHeader header;
+    size_t end;
+    if (findIntactFrame(next_offset_, header, end) == kNoFrame) {
+        next_offset_ = size_;
+        return false;
+    }
+    next_offset_ = end;
+    return true;
+}
+
+size_t FlacDecoder::read(size_t count, float* left, float* right) {
+    size_t done = 0;
+    while (done < count && position_ < total_frames_) {
+        uint64_t blockEnd = block_first_frame_ + block_size_;
+        if (position_ >= blockEnd) {
+            if (!decodeFrame()) break;
+            continue;
+        }
+
+        size_t wanted = static_cast<size_t>(std::min<uint64_t>(count - done, total_frames_ - position_));
+        size_t n;
+        if (position_ < block_first_frame_) {
+            n = static_cast<size_t>(std::min<uint64_t>(wanted, block_first_frame_ - position_));
+            std::fill(left + done, left + done + n, 0.0f);
+            std::fill(right + done, right + done + n, 0.0f);
+        } else {
+            size_t first = static_cast<size_t>(position_ - block_first_frame_);
+            n = std::min<size_t>(wanted, block_size_ - first);
+            const int32_t* blockLeft = block_[0].data() + first;
+            const int32_t* blockRight = block_[1].data() + first;
+            for (size_t i = 0; i < n; i++) {
+                left[done + i] = blockLeft[i] * block_scale_;
+                right[done + i] = blockRight[i] * block_scale_;
+            }
+        }
+        done += n;
+        position_ += n;
+    }
+    return done;
+}
+
+bool FlacDecoder::seek(size_t frame) {
+    if (frame > total_frames_) return false;
+    position_ = frame;
+    if (frame >= block_first_frame_ && frame < block_first_frame_ + block_size_) return true;
+
+    // Narrow the byte range with the seek table, then bisect it on frame
+    // headers; read() decodes forward from there and drops what comes
+    // before the target
+    size_t low = first_frame_offset_;
+    size_t high = size_;
+    for (const SeekPoint& point : seek_points_) {
+        size_t offset = first_frame_offset_ + static_cast<size_t>(point.offset);
+        if (offset >= size_) break;
+        if (point.frame <= frame) {
+            low = offset;
+        } else {
+            high = offset;
+            break;
+        }
+    }
+    while (high - low > kBisectStopBytes) {
+        size_t middle = low + (high - low) / 2;
+        FrameHeader header;
+        size_t end;
+        size_t offset = findIntactFrame(middle, header, end);
+        if (offset == kNoFrame || offset >= high || header.firstFrame > frame) {
+            high = middle;
+        } else {
+            low = offset;
+        }
+    }
+
+    next_offset_ = low;
+    block_first_frame_ = 0;
+    block_size_ = 0;
+    return true;
+}
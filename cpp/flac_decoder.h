@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "audio_decoder.h"
+#include "mapped_file.h"
+
+class FlacBitReader;
+
+// Native FLAC decoder over a memory-mapped file. Handles every subframe
+// type (constant, verbatim, fixed and LPC prediction), both Rice coding
+// methods with escaped partitions, wasted bits and the three stereo
+// decorrelation modes, at 4 to 24 bits per sample. Frames are checked
+// against their CRC-16; a damaged frame decodes as silence and the stream
+// carries on with the next one.
+//
+// Seeking uses the SEEKTABLE when there is one and otherwise bisects the
+// file on frame headers, then decodes forward to the exact frame.
+class FlacDecoder : public AudioDecoder {
+public:
+    FlacDecoder();
+
+    bool open(const std::string& filepath, std::string& error);
+
+    int sampleRate() const override { return sample_rate_; }
+    int channels() const override { return channels_; }
+    size_t frameCount() const override { return static_cast<size_t>(total_frames_); }
+    const char* formatName() const override { return "FLAC"; }
+
+    size_t read(size_t count, float* left, float* right) override;
+    bool seek(size_t frame) override;
+
+private:
+    struct FrameHeader {
+        uint64_t firstFrame; // in samples per channel
+        uint32_t blockSize;
+        uint32_t channelAssignment;
+        uint32_t bitsPerSample;
+        size_t headerBytes;
+    };
+
+    struct SeekPoint {
+        uint64_t frame;
+        uint64_t offset; // from first_frame_offset_
+    };
+
+    bool parseMetadata(std::string& error);
+    bool parseFrameHeader(size_t offset, FrameHeader& header) const;
+    size_t findFrame(size_t offset, FrameHeader& header) const;
+    size_t findIntactFrame(size_t offset, FrameHeader& header, size_t& end);
+    size_t decodeFrameAt(size_t offset, const FrameHeader& header);
+    bool decodeFrame();
+    bool decodeSubframe(FlacBitReader& bits, uint32_t blockSize, uint32_t bitsPerSample, int32_t* out);
+    bool decodeResidual(FlacBitReader& bits, uint32_t blockSize, uint32_t order, int32_t* out);
+
+    MappedFile file_;
+    const uint8_t* data_;
+    size_t size_;
+
+    // STREAMINFO
+    int sample_rate_;
+    int channels_;
+    uint32_t bits_per_sample_;
+    uint32_t max_block_size_;
+    uint64_t total_frames_;
+
+    size_t first_frame_offset_;
+    std::vector<SeekPoint> seek_points_;
+
+    // Next frame to hand out, the byte offset of the next frame to decode and
+    // the last decoded block
+    uint64_t position_;
+    size_t next_offset_;
+    uint64_t block_first_frame_;
+    uint32_t block_size_;
+    float block_scale_;
+    std::vector<int32_t> block_[2];
+    std::vector<int32_t> scratch_; // Channels past the second
+};
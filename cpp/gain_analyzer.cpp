@@ -0,0 +1,72 @@
+#include "gain_analyzer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "audio_processor.h"
+
+static const float kRelativeGateLu = -10.0f;
+
+static double lufsToPower(float lufs) {
+    return std::pow(10.0, (lufs + 0.691) / 10.0);
+}
+
+static float powerToLufs(double power) {
+    return static_cast<float>(-0.691 + 10.0 * std::log10(power));
+}
+
+bool analyzeTrackGain(size_t frames, int sampleRate, const GainFrameReader& read, TrackGain& gain) {
+    if (sampleRate <= 0) return false;
+    const int step = std::max(sampleRate / 10, 1); // LevelMeter's bin length
+    const int stepsPerBlock = 4;
+
+    LevelMeter meter(sampleRate, step);
+    std::vector<float> left(step);
+    std::vector<float> right(step);
+    std::vector<float> blocks; // Momentary loudness of every full block
+    blocks.reserve(frames / step);
+
+    size_t steps = frames / step;
+    for (size_t i = 0; i < steps; i++) {
+        read(i * step, step, left.data(), right.data());
+        meter.process(left.data(), right.data(), step);
+        if (i + 1 >= stepsPerBlock) {
+            blocks.push_back(meter.getReading().momentaryLufs);
+        }
+    }
+    if (blocks.empty()) return false;
+
+    // Absolute gate; LevelMeter already floors quieter blocks to the gate
+    double sum = 0.0;
+    size_t count = 0;
+    for (float lufs : blocks) {
+        if (lufs > LevelMeter::kSilenceLufs) {
+            sum += lufsToPower(lufs);
+            count++;
+        }
+    }
+    float truePeak = meter.getReading().maxTruePeak;
+    gain.truePeakDb = 20.0f * std::log10(std::max(truePeak, 1e-6f));
+    if (count == 0) {
+        // Nothing to level
+        gain.integratedLufs = LevelMeter::kSilenceLufs;
+        gain.gainDb = 0.0f;
+        return true;
+    }
+
+    // Relative gate
+    float threshold = powerToLufs(sum / count) + kRelativeGateLu;
+    sum = 0.0;
+    count = 0;
+    for (float lufs : blocks) {
+        if (lufs > LevelMeter::kSilenceLufs && lufs > threshold) {
+            sum += lufsToPower(lufs);
+            count++;
+        }
+    }
+
+    gain.integratedLufs = powerToLufs(sum / count);
+    gain.gainDb = std::min(kTargetLufs - gain.integratedLufs, kPeakCeilingDb - gain.truePeakDb);
+    return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+#include "audio_file.h"
+
+// Loudness of a whole track and the gain that brings it to the house level.
+// Plain floats, so it can be stored or copied to JS as is.
+struct TrackGain {
+    float integratedLufs; // BS.1770-4 gated loudness
+    float truePeakDb;     // Highest 4x oversampled peak, dBTP
+    float gainDb;         // To reach kTargetLufs, limited by kPeakCeilingDb
+};
+
+static constexpr float kTargetLufs = -18.0f;   // ReplayGain 2 reference level
+static constexpr float kPeakCeilingDb = -1.0f; // Gain never pushes a peak past this
+
+typedef std::function<void(size_t start, size_t count, float* left, float* right)> GainFrameReader;
+
+// One streaming pass through LevelMeter in 100 ms steps: the momentary
+// loudness after each step is a 400 ms block with 75% overlap, which are
+// gated at -70 LUFS and then 10 LU under their mean as in BS.1770. Holds
+// only one step of audio. False if the track is shorter than one block; a
+// silent track reads kSilenceLufs and gets no gain.
+bool analyzeTrackGain(size_t frames, int sampleRate, const GainFrameReader& read, TrackGain& gain);
+
+inline bool analyzeTrackGain(const AudioFile& track, TrackGain& gain) {
+    return analyzeTrackGain(track.frameCount, track.sampleRate,
+                            [&track](size_t start, size_t count, float* left, float* right) {
+                                track.readFrames(start, count, left, right);
+                            },
+                            gain);
+}
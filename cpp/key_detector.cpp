@@ -0,0 +1,178 @@
+#include "key_detector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "audio_processor.h"
+
+// Analysis runs at about 5.5 kHz, which keeps B6 (1976 Hz) below the
+// anti-alias filter, with 4096-sample frames (1.3 Hz bins, a third of a
+// semitone at C2) every 2048 samples
+static const double kAnalysisRate = 5512.5;
+static const int kFrameSize = 4096;
+static const int kFrameHop = 2048;
+static const double kLowestPitch = 65.406;  // C2
+static const int kSemitones = 60;           // C2..B6
+
+// Krumhansl-Kessler probe-tone ratings, tonic first
+static const float kMajorProfile[12] = {6.35f, 2.23f, 3.48f, 2.33f, 4.38f, 4.09f,
+                                        2.52f, 5.19f, 2.39f, 3.66f, 2.29f, 2.88f};
+static const float kMinorProfile[12] = {6.33f, 2.68f, 3.52f, 5.38f, 2.60f, 3.53f,
+                                        2.54f, 4.75f, 3.98f, 2.69f, 3.34f, 3.17f};
+
+static const char* const kKeyNames[24] = {
+    "C", "Db", "D", "Eb", "E", "F", "F#", "G", "Ab", "A", "Bb", "B",
+    "Cm", "C#m", "Dm", "Ebm", "Em", "Fm", "F#m", "Gm", "G#m", "Am", "Bbm", "Bm"};
+
+void describeKey(int key, KeyEstimate& estimate) {
+    key = std::min(std::max(key, 0), 23);
+    bool minor = key >= 12;
+    int tonic = key % 12;
+
+    // Each step round the wheel is a fifth (7 semitones); C major is 8B and
+    // a minor key shares the number of its relative major, 3 semitones up
+    int major = minor ? (tonic + 3) % 12 : tonic;
+    estimate.key = key;
+    estimate.camelotNumber = (major * 7 + 7) % 12 + 1;
+    snprintf(estimate.name, sizeof(estimate.name), "%s", kKeyNames[key]);
+    snprintf(estimate.camelot, sizeof(estimate.camelot), "%d%c", estimate.camelotNumber, minor ? 'A' : 'B');
+}
+
+// Pearson correlation of a chroma vector with a profile rotated to `tonic`
+static float correlate(const float* chroma, const float* profile, int tonic) {
+    float chromaMean = 0.0f;
+    float profileMean = 0.0f;
+    for (int i = 0; i < 12; i++) {
+        chromaMean += chroma[i];
+        profileMean += profile[i];
+    }
+    chromaMean /= 12.0f;
+    profileMean /= 12.0f;
+
+    float product = 0.0f;
+    float chromaSquares = 0.0f;
+    float profileSquares = 0.0f;
+    for (int i = 0; i < 12; i++) {
+        float c = chroma[(tonic + i) % 12] - chromaMean;
+        float p = profile[i] - profileMean;
+        product += c * p;
+        chromaSquares += c * c;
+        profileSquares += p * p;
+    }
+    float norm = std::sqrt(chromaSquares * profileSquares);
+    return (norm > 0.0f) ? product / norm : 0.0f;
+}
+
+KeyDetector::KeyDetector() : analysis_rate_(0.0) {
+    std::fill(chroma_, chroma_ + 12, 0.0f);
+}
+
+void KeyDetector::setSource(const float* left, const float* right, size_t frames, int sampleRate) {
+    setSource(frames, sampleRate, [left, right](size_t start, size_t count, float* outLeft, float* outRight) {
+        memcpy(outLeft, left + start, count * sizeof(float));
+        memcpy(outRight, right + start, count * sizeof(float));
+    });
+}
+
+// Mono mix through a fourth-order Butterworth lowpass, then every
+// `decimation`th sample
+void KeyDetector::setSource(size_t frames, int sampleRate, const FrameReader& read) {
+    const size_t blockPoints = 4096;
+
+    sampleRate = std::max(sampleRate, 1);
+    int decimation = std::max(1, static_cast<int>(std::lround(sampleRate / kAnalysisRate)));
+    analysis_rate_ = static_cast<double>(sampleRate) / decimation;
+    mono_.assign(frames / decimation, 0.0f);
+
+    float cutoff = static_cast<float>(std::min(0.4 * analysis_rate_, 2200.0));
+    BiquadFilter firstSection;
+    BiquadFilter secondSection;
+    firstSection.setLowpass(cutoff, 0.5412f, static_cast<float>(sampleRate));
+    secondSection.setLowpass(cutoff, 1.3066f, static_cast<float>(sampleRate));
+
+    std::vector<float> left(blockPoints * decimation);
+    std::vector<float> right(blockPoints * decimation);
+    for (size_t done = 0; done < mono_.size(); ) {
+        size_t points = std::min(blockPoints, mono_.size() - done);
+        read(done * decimation, points * decimation, left.data(), right.data());
+        for (size_t i = 0; i < points; i++) {
+            float kept = 0.0f;
+            for (int d = 0; d < decimation; d++) {
+                size_t frame = i * decimation + d;
+                kept = secondSection.process(firstSection.process((left[frame] + right[frame]) * 0.5f));
+            }
+            mono_[done + i] = kept;
+        }
+        done += points;
+    }
+}
+
+// Each frame's chroma is normalised before it is added, so quiet passages
+// count as much as loud ones; near-silent frames are skipped. Percussion
+// spreads evenly over the pitch classes and so doesn't move the correlation.
+void KeyDetector::computeChroma() {
+    const float silence = 1e-4f * kFrameSize;
+
+    // Pitch class and weight of every bin from C2 to B6, falling linearly
+    // from 1 at a semitone to 0 halfway to the next
+    std::vector<int> bins;
+    std::vector<int> classes;
+    std::vector<float> weights;
+    for (int bin = 1; bin <= kFrameSize / 2; bin++) {
+        double frequency = bin * analysis_rate_ / kFrameSize;
+        double semitone = 12.0 * std::log2(frequency / kLowestPitch);
+        if (semitone < -0.5 || semitone > kSemitones - 0.5) continue;
+        long nearest = std::lround(semitone);
+        float weight = static_cast<float>(1.0 - 2.0 * std::fabs(semitone - nearest));
+        if (weight <= 0.0f) continue;
+        bins.push_back(bin);
+        classes.push_back(static_cast<int>(nearest % 12));
+        weights.push_back(weight);
+    }
+
+    PowerSpectrum spectrum(kFrameSize);
+    std::vector<float> power(spectrum.getBinCount());
+    std::fill(chroma_, chroma_ + 12, 0.0f);
+    for (size_t start = 0; start + kFrameSize <= mono_.size(); start += kFrameHop) {
+        spectrum.process(mono_.data() + start, power.data());
+
+        float frame[12] = {};
+        for (size_t i = 0; i < bins.size(); i++) {
+            frame[classes[i]] += weights[i] * std::sqrt(power[bins[i]]);
+        }
+        float total = 0.0f;
+        for (float value : frame) {
+            total += value;
+        }
+        if (total < silence) continue;
+        for (int i = 0; i < 12; i++) {
+            chroma_[i] += frame[i] / total;
+        }
+    }
+}
+
+bool KeyDetector::analyze(KeyEstimate& estimate) {
+    if (mono_.size() < static_cast<size_t>(kFrameSize)) return false;
+    computeChroma();
+
+    float best = -1.0f;
+    float second = -1.0f;
+    int bestKey = 0;
+    for (int key = 0; key < 24; key++) {
+        float score = correlate(chroma_, key < 12 ? kMajorProfile : kMinorProfile, key % 12);
+        if (score > best) {
+            second = best;
+            best = score;
+            bestKey = key;
+        } else if (score > second) {
+            second = score;
+        }
+    }
+    if (best <= 0.0f) return false;
+
+    describeKey(bestKey, estimate);
+    estimate.confidence = std::min(std::max((best - second) / (1.0f - second), 0.0f), 1.0f);
+    return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "audio_file.h"
+
+// Estimated key of a track. Keys are numbered 0..11 for C major .. B major
+// and 12..23 for C minor .. B minor; the Camelot wheel puts relative keys
+// on the same number (8B is C major, 8A A minor) and a fifth apart on
+// neighbouring numbers. Plain data, so it can be copied to JS as is.
+struct KeyEstimate {
+    int32_t key;
+    int32_t camelotNumber; // 1..12
+    float confidence;      // 0 (two keys fit equally) .. 1
+    char name[6];          // "Eb", "F#m"
+    char camelot[4];       // "5B", "11A"
+};
+
+static_assert(sizeof(KeyEstimate) == 24, "KeyEstimate layout is read from JS");
+
+// Fill in a KeyEstimate's names for `key` (0..23), confidence left as is
+void describeKey(int key, KeyEstimate& estimate);
+
+// Key detection for a whole track, meant for a background thread. Like
+// BeatAnalyzer, setSource() makes one pass over the track into a reduced
+// copy (low-passed mono at about 5.5 kHz) and analyze() works only on that:
+//
+//   1. overlapping Hann-windowed FFT frames (0.74 s, half overlap) give
+//      magnitude spectra, whose bins from C2 to B6 are folded onto the 12
+//      pitch classes with a weight that falls to zero between semitones;
+//   2. the log-compressed chroma of all frames is summed into one profile,
+//      so sustained harmony outweighs short melodic notes;
+//   3. that profile is correlated with the 24 rotations of the
+//      Krumhansl-Kessler major and minor key profiles, and the best is the
+//      key. Confidence is its margin over the runner-up.
+class KeyDetector {
+public:
+    typedef std::function<void(size_t start, size_t count, float* left, float* right)> FrameReader;
+
+    KeyDetector();
+
+    void setSource(const AudioFile& track) {
+        setSource(track.frameCount, track.sampleRate,
+                  [&track](size_t start, size_t count, float* left, float* right) {
+                      track.readFrames(start, count, left, right);
+                  });
+    }
+    void setSource(const float* left, const float* right, size_t frames, int sampleRate);
+    void setSource(size_t frames, int sampleRate, const FrameReader& read);
+
+    // False if the source is shorter than one frame or has no tonal content
+    bool analyze(KeyEstimate& estimate);
+
+    // Summed chroma of the last analyze(), C first; for display
+    const float* getChroma() const { return chroma_; }
+
+private:
+    void computeChroma();
+
+    std::vector<float> mono_;
+    double analysis_rate_;
+    float chroma_[12];
+};
@@ -0,0 +1,75 @@
+// MP3 through dr_mp3 (public domain / MIT-0), built when CMake finds
+// third_party/dr_mp3.h
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "audio_decoder.h"
+
+#define DR_MP3_IMPLEMENTATION
+#include "dr_mp3.h"
+
+class Mp3Decoder : public AudioDecoder {
+public:
+    Mp3Decoder() : open_(false), frames_(0) {}
+    ~Mp3Decoder() override {
+        if (open_) drmp3_uninit(&mp3_);
+    }
+
+    bool open(const std::string& filepath, std::string& error) {
+        if (!drmp3_init_file(&mp3_, filepath.c_str(), nullptr)) {
+            error = "Could not open MP3 file: " + filepath;
+            return false;
+        }
+        open_ = true;
+
+        // Both scans read frame headers only. The seek table lets later seeks
+        // jump close to the target instead of decoding from the start.
+        frames_ = static_cast<size_t>(drmp3_get_pcm_frame_count(&mp3_));
+        drmp3_uint32 pointCount = kSeekPoints;
+        seek_points_.resize(pointCount);
+        if (drmp3_calculate_seek_points(&mp3_, &pointCount, seek_points_.data())) {
+            seek_points_.resize(pointCount);
+            drmp3_bind_seek_table(&mp3_, pointCount, seek_points_.data());
+        }
+        if (frames_ == 0 || mp3_.channels == 0) {
+            error = "MP3 file has no audio: " + filepath;
+            return false;
+        }
+        return seek(0);
+    }
+
+    int sampleRate() const override { return static_cast<int>(mp3_.sampleRate); }
+    int channels() const override { return static_cast<int>(mp3_.channels); }
+    size_t frameCount() const override { return frames_; }
+    const char* formatName() const override { return "MP3"; }
+
+    size_t read(size_t count, float* left, float* right) override {
+        int channels = static_cast<int>(mp3_.channels);
+        interleaved_.resize(count * channels);
+        size_t decoded = static_cast<size_t>(drmp3_read_pcm_frames_f32(&mp3_, count, interleaved_.data()));
+        for (size_t i = 0; i < decoded; i++) {
+            left[i] = interleaved_[i * channels];
+            right[i] = interleaved_[i * channels + (channels > 1 ? 1 : 0)];
+        }
+        return decoded;
+    }
+
+    bool seek(size_t frame) override { return drmp3_seek_to_pcm_frame(&mp3_, frame) != 0; }
+
+private:
+    static const drmp3_uint32 kSeekPoints = 1024;
+
+    drmp3 mp3_;
+    bool open_;
+    size_t frames_;
+    std::vector<drmp3_seek_point> seek_points_;
+    std::vector<float> interleaved_;
+};
+
+std::unique_ptr<AudioDecoder> openMp3Decoder(const std::string& filepath, std::string& error) {
+    std::unique_ptr<Mp3Decoder> decoder(new Mp3Decoder());
+    if (!decoder->open(filepath, error)) return nullptr;
+    return decoder;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Parameter targets understood by the audio callback
+enum class ParamType : uint8_t {
+    Playing,
+    Volume,
+    Pitch,
+    Position,
+    Effect,
+    EQ,
+    Crossfader,
+    MasterVolume,
+    HeadphoneVolume,
+    KeyLock,
+    Sync,
+    SyncLeader, // `deck` is the new leader
+    ClearClip
+};
+
+// A single timestamped control change. `time` is the engine frame clock value at
+// which the change takes effect; events that are already due are applied at the
+// start of the next buffer.
+struct ParamEvent {
+    uint64_t time;
+    ParamType type;
+    uint8_t deck;   // 0-based, ignored for master controls
+    uint8_t index;  // effect or EQ band
+    float value;
+};
+
+// Wait-free single-producer/single-consumer ring buffer.
+// Items pushed by the producer stay invisible to the consumer until publish(),
+// so a group of pushes becomes visible in one step.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Producer side
+    bool push(const T& item) {
+        if (staged_ - readIndex_.load(std::memory_order_acquire) >= Capacity) {
+            return false;
+        }
+        items_[staged_ & (Capacity - 1)] = item;
+        staged_++;
+        return true;
+    }
+
+    void publish() {
+        writeIndex_.store(staged_, std::memory_order_release);
+    }
+
+    // Consumer side
+    const T* front() const {
+        size_t read = readIndex_.load(std::memory_order_relaxed);
+        if (read == writeIndex_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &items_[read & (Capacity - 1)];
+    }
+
+    void pop() {
+        readIndex_.store(readIndex_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    T items_[Capacity];
+
+    // Indices grow monotonically and are masked on access; each lives on its
+    // own cache line so producer and consumer never contend.
+    alignas(64) std::atomic<size_t> writeIndex_{0};
+    alignas(64) std::atomic<size_t> readIndex_{0};
+    alignas(64) size_t staged_ = 0; // producer-private
+};
@@ -0,0 +1,331 @@
+#include "pcm_convert.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PCM_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define PCM_TARGET_AVX2
+#else
+#define PCM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PCM_SSE2 1
+#endif
+
+static const float kScale16 = 1.0f / 32768.0f;
+static const float kScale24 = 1.0f / 8388608.0f;
+static const float kScale32 = 1.0f / 2147483648.0f;
+
+// Scalar sample decoders. Mapped data can sit at any alignment, so loads go
+// through memcpy, which compiles to a plain unaligned load.
+struct Int16Codec {
+    static float load(const uint8_t* p) {
+        int16_t value;
+        memcpy(&value, p, sizeof(value));
+        return value * kScale16;
+    }
+};
+
+struct Int24Codec {
+    static float load(const uint8_t* p) {
+        int32_t value = static_cast<int32_t>(static_cast<uint32_t>(p[0]) << 8 |
+                                             static_cast<uint32_t>(p[1]) << 16 |
+                                             static_cast<uint32_t>(p[2]) << 24) >> 8;
+        return value * kScale24;
+    }
+};
+
+struct Int32Codec {
+    static float load(const uint8_t* p) {
+        int32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value * kScale32;
+    }
+};
+
+struct Float32Codec {
+    static float load(const uint8_t* p) {
+        float value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+};
+
+template <typename Codec>
+static void convertScalar(const uint8_t* src, int channels, size_t stride, size_t sampleBytes,
+                          size_t frames, float* left, float* right) {
+    if (channels == 1) {
+        for (size_t i = 0; i < frames; i++) {
+            float sample = Codec::load(src + i * stride);
+            left[i] = sample;
+            right[i] = sample; // Duplicate for stereo
+        }
+    } else {
+        for (size_t i = 0; i < frames; i++) {
+            const uint8_t* frame = src + i * stride;
+            left[i] = Codec::load(frame);
+            right[i] = Codec::load(frame + sampleBytes);
+        }
+    }
+}
+
+static void convertFramesScalar(const uint8_t* src, SampleFormat format, int channels, size_t stride,
+                                size_t frames, float* left, float* right) {
+    size_t sampleBytes = bytesPerSample(format);
+    switch (format) {
+        case SampleFormat::Int16:
+            convertScalar<Int16Codec>(src, channels, stride, sampleBytes, frames, left, right);
+            break;
+        case SampleFormat::Int24:
+            convertScalar<Int24Codec>(src, channels, stride, sampleBytes, frames, left, right);
+            break;
+        case SampleFormat::Int32:
+            convertScalar<Int32Codec>(src, channels, stride, sampleBytes, frames, left, right);
+            break;
+        case SampleFormat::Float32:
+            convertScalar<Float32Codec>(src, channels, stride, sampleBytes, frames, left, right);
+            break;
+    }
+}
+
+typedef void (*ConvertKernel)(const uint8_t* src, SampleFormat format, int channels, size_t stride,
+                              size_t frames, float* left, float* right);
+
+#ifdef PCM_SSE2
+// Split interleaved L0 R0 L1 R1 | L2 R2 L3 R3 into four lefts and four rights
+static inline void deinterleave4(__m128 a, __m128 b, float* left, float* right) {
+    _mm_storeu_ps(left, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(right, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+static inline __m128 load32x4(const uint8_t* p, bool isFloat, __m128 scale) {
+    if (isFloat) {
+        return _mm_loadu_ps(reinterpret_cast<const float*>(p));
+    }
+    return _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))), scale);
+}
+
+static void convertFramesSse2(const uint8_t* src, SampleFormat format, int channels, size_t stride,
+                              size_t frames, float* left, float* right) {
+    size_t sampleBytes = bytesPerSample(format);
+    if (channels > 2 || stride != channels * sampleBytes || format == SampleFormat::Int24) {
+        convertFramesScalar(src, format, channels, stride, frames, left, right);
+        return;
+    }
+
+    size_t i = 0;
+    if (format == SampleFormat::Int16) {
+        const __m128 scale = _mm_set1_ps(kScale16);
+        if (channels == 2) {
+            for (; i + 4 <= frames; i += 4) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+                __m128 a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)), scale);
+                __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)), scale);
+                deinterleave4(a, b, left + i, right + i);
+            }
+        } else {
+            for (; i + 8 <= frames; i += 8) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+                __m128 a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)), scale);
+                __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)), scale);
+                _mm_storeu_ps(left + i, a);
+                _mm_storeu_ps(left + i + 4, b);
+                _mm_storeu_ps(right + i, a);
+                _mm_storeu_ps(right + i + 4, b);
+            }
+        }
+    } else {
+        // 32-bit integer or float
+        bool isFloat = format == SampleFormat::Float32;
+        const __m128 scale = _mm_set1_ps(kScale32);
+        for (; i + 4 <= frames; i += 4) {
+            const uint8_t* p = src + i * stride;
+            __m128 a = load32x4(p, isFloat, scale);
+            if (channels == 2) {
+                deinterleave4(a, load32x4(p + 16, isFloat, scale), left + i, right + i);
+            } else {
+                _mm_storeu_ps(left + i, a);
+                _mm_storeu_ps(right + i, a);
+            }
+        }
+    }
+
+    convertFramesScalar(src + i * stride, format, channels, stride, frames - i, left + i, right + i);
+}
+#endif
+
+#ifdef PCM_X86
+static bool cpuHasAvx2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    return osxsave && avx2 && (_xgetbv(0) & 6) == 6;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// Split interleaved frames 0-3 in `a` and 4-7 in `b` into eight lefts and rights
+PCM_TARGET_AVX2
+static inline void deinterleave8(__m256 a, __m256 b, float* left, float* right) {
+    // Per 128-bit lane this yields L0 L1 L4 L5 | L2 L3 L6 L7; fix up the 64-bit order
+    __m256 even = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    __m256 odd = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    even = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(even), _MM_SHUFFLE(3, 1, 2, 0)));
+    odd = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(odd), _MM_SHUFFLE(3, 1, 2, 0)));
+    _mm256_storeu_ps(left, even);
+    _mm256_storeu_ps(right, odd);
+}
+
+// Expand four packed 24-bit samples into the top of four 32-bit lanes
+PCM_TARGET_AVX2
+static inline __m128i load24x4(const uint8_t* p) {
+    const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), shuffle);
+}
+
+PCM_TARGET_AVX2
+static inline __m256 load24x8(const uint8_t* p, __m256 scale) {
+    __m256i v = _mm256_set_m128i(load24x4(p + 12), load24x4(p));
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale);
+}
+
+PCM_TARGET_AVX2
+static inline __m256 load16x8(const uint8_t* p, __m256 scale) {
+    __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale);
+}
+
+PCM_TARGET_AVX2
+static inline __m256 load32x8(const uint8_t* p, bool isFloat, __m256 scale) {
+    if (isFloat) {
+        return _mm256_loadu_ps(reinterpret_cast<const float*>(p));
+    }
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale);
+}
+
+PCM_TARGET_AVX2
+static void convertFramesAvx2(const uint8_t* src, SampleFormat format, int channels, size_t stride,
+                              size_t frames, float* left, float* right) {
+    size_t sampleBytes = bytesPerSample(format);
+    if (channels > 2 || stride != channels * sampleBytes) {
+        convertFramesScalar(src, format, channels, stride, frames, left, right);
+        return;
+    }
+
+    size_t i = 0;
+    size_t frameBytes = stride;
+
+    if (format == SampleFormat::Int16) {
+        const __m256 scale = _mm256_set1_ps(kScale16);
+        for (; i + 8 <= frames; i += 8) {
+            const uint8_t* p = src + i * frameBytes;
+            __m256 a = load16x8(p, scale);
+            if (channels == 2) {
+                deinterleave8(a, load16x8(p + 16, scale), left + i, right + i);
+            } else {
+                _mm256_storeu_ps(left + i, a);
+                _mm256_storeu_ps(right + i, a);
+            }
+        }
+    } else if (format == SampleFormat::Int24) {
+        // Samples are shifted into the top 24 bits, so scale as 32-bit. Each
+        // 12-byte group is read with a 16-byte load; keep 4 bytes of slack.
+        const __m256 scale = _mm256_set1_ps(kScale32);
+        size_t slackFrames = (channels == 2) ? 1 : 2;
+        for (; i + 8 + slackFrames <= frames; i += 8) {
+            const uint8_t* p = src + i * frameBytes;
+            __m256 a = load24x8(p, scale);
+            if (channels == 2) {
+                deinterleave8(a, load24x8(p + 24, scale), left + i, right + i);
+            } else {
+                _mm256_storeu_ps(left + i, a);
+                _mm256_storeu_ps(right + i, a);
+            }
+        }
+    } else {
+        bool isFloat = format == SampleFormat::Float32;
+        const __m256 scale = _mm256_set1_ps(kScale32);
+        for (; i + 8 <= frames; i += 8) {
+            const uint8_t* p = src + i * frameBytes;
+            __m256 a = load32x8(p, isFloat, scale);
+            if (channels == 2) {
+                deinterleave8(a, load32x8(p + 32, isFloat, scale), left + i, right + i);
+            } else {
+                _mm256_storeu_ps(left + i, a);
+                _mm256_storeu_ps(right + i, a);
+            }
+        }
+    }
+
+    convertFramesScalar(src + i * stride, format, channels, stride, frames - i, left + i, right + i);
+}
+#endif
+
+struct KernelChoice {
+    ConvertKernel kernel;
+    const char* name;
+};
+
+static KernelChoice selectKernel() {
+#ifdef PCM_X86
+    if (cpuHasAvx2()) return {convertFramesAvx2, "avx2"};
+#endif
+#ifdef PCM_SSE2
+    return {convertFramesSse2, "sse2"};
+#else
+    return {convertFramesScalar, "scalar"};
+#endif
+}
+
+// Chosen once at startup so the audio thread never runs CPU detection
+static const KernelChoice kKernel = selectKernel();
+
+void convertToFloat(const uint8_t* src, SampleFormat format, int channels, size_t stride,
+                    size_t frames, float* left, float* right) {
+    kKernel.kernel(src, format, channels, stride, frames, left, right);
+}
+
+void convertToFloatParallel(const uint8_t* src, SampleFormat format, int channels, size_t stride,
+                            size_t frames, float* left, float* right, int threadCount) {
+    // Below this a thread costs more to start than it saves
+    const size_t minFramesPerThread = 1 << 18;
+
+    size_t threads = (threadCount > 0) ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+    size_t chunks = std::min(threads, std::max<size_t>(1, frames / minFramesPerThread));
+    if (chunks <= 1) {
+        convertToFloat(src, format, channels, stride, frames, left, right);
+        return;
+    }
+
+    size_t perChunk = ((frames + chunks - 1) / chunks + 15) & ~static_cast<size_t>(15);
+    std::vector<std::thread> workers;
+    for (size_t start = perChunk; start < frames; start += perChunk) {
+        size_t count = std::min(perChunk, frames - start);
+        workers.emplace_back(convertToFloat, src + start * stride, format, channels, stride,
+                             count, left + start, right + start);
+    }
+    convertToFloat(src, format, channels, stride, std::min(perChunk, frames), left, right);
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+const char* pcmKernelName() {
+    return kKernel.name;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Sample encodings a WAV data chunk can hold
+enum class SampleFormat : uint8_t {
+    Int16,
+    Int24,
+    Int32,
+    Float32
+};
+
+inline int bytesPerSample(SampleFormat format) {
+    switch (format) {
+        case SampleFormat::Int16: return 2;
+        case SampleFormat::Int24: return 3;
+        default: return 4;
+    }
+}
+
+// Deinterleave `frames` frames of little-endian PCM into float left/right
+// channels. Mono sources are written to both channels; sources with more than
+// two channels contribute their first two. `stride` is the byte distance
+// between frames (the WAV block align). Uses AVX2 or SSE2 kernels when the
+// CPU supports them. Does not allocate, so it is safe on the audio thread.
+void convertToFloat(const uint8_t* src, SampleFormat format, int channels, size_t stride,
+                    size_t frames, float* left, float* right);
+
+// Same as convertToFloat, split across up to `threadCount` threads for large
+// inputs (0 uses every hardware thread).
+void convertToFloatParallel(const uint8_t* src, SampleFormat format, int channels, size_t stride,
+                            size_t frames, float* left, float* right, int threadCount = 0);
+
+// Name of the kernel set convertToFloat dispatches to ("avx2", "sse2", "scalar")
+const char* pcmKernelName();
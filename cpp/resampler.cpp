@@ -0,0 +1,413 @@
+#include "resampler.h"
+#include "audio_file.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RESAMPLER_SSE 1
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define RESAMPLER_WASM_SIMD 1
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Four-lane helpers for the gathered interpolators
+#if defined(RESAMPLER_SSE)
+typedef __m128 Vec4;
+static inline Vec4 vecLoad(const float* p) { return _mm_loadu_ps(p); }
+static inline void vecStore(float* p, Vec4 v) { _mm_storeu_ps(p, v); }
+static inline Vec4 vecSet(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+static inline Vec4 vecSplat(float a) { return _mm_set1_ps(a); }
+static inline Vec4 vecAdd(Vec4 a, Vec4 b) { return _mm_add_ps(a, b); }
+static inline Vec4 vecSub(Vec4 a, Vec4 b) { return _mm_sub_ps(a, b); }
+static inline Vec4 vecMul(Vec4 a, Vec4 b) { return _mm_mul_ps(a, b); }
+#define RESAMPLER_VEC4 1
+#elif defined(RESAMPLER_WASM_SIMD)
+typedef v128_t Vec4;
+static inline Vec4 vecLoad(const float* p) { return wasm_v128_load(p); }
+static inline void vecStore(float* p, Vec4 v) { wasm_v128_store(p, v); }
+static inline Vec4 vecSet(float a, float b, float c, float d) { return wasm_f32x4_make(a, b, c, d); }
+static inline Vec4 vecSplat(float a) { return wasm_f32x4_splat(a); }
+static inline Vec4 vecAdd(Vec4 a, Vec4 b) { return wasm_f32x4_add(a, b); }
+static inline Vec4 vecSub(Vec4 a, Vec4 b) { return wasm_f32x4_sub(a, b); }
+static inline Vec4 vecMul(Vec4 a, Vec4 b) { return wasm_f32x4_mul(a, b); }
+#define RESAMPLER_VEC4 1
+#endif
+
+// Zeroth-order modified Bessel function, for the Kaiser window
+static double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+SincFilterBank::SincFilterBank(int taps, int phases, double cutoff, double kaiserBeta, bool interpolatePhases)
+    : taps_(taps), phases_(phases), interpolate_(interpolatePhases) {
+    // One extra row so phase(index + 1) is valid when interpolating
+    coeffs_.resize(static_cast<size_t>(phases + 1) * taps);
+
+    const double half = taps / 2.0;
+    const double norm = besselI0(kaiserBeta);
+
+    for (int p = 0; p <= phases; p++) {
+        double frac = static_cast<double>(p) / phases;
+        float* row = coeffs_.data() + static_cast<size_t>(p) * taps;
+        double sum = 0.0;
+
+        for (int k = 0; k < taps; k++) {
+            // Distance from the output position to this tap, in source frames
+            double t = (k - half + 1.0) - frac;
+            double x = 2.0 * cutoff * t;
+            double sinc = (std::fabs(x) < 1e-9) ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+            double ratio = t / half;
+            double window = (std::fabs(ratio) >= 1.0) ? 0.0 : besselI0(kaiserBeta * std::sqrt(1.0 - ratio * ratio)) / norm;
+            double value = 2.0 * cutoff * sinc * window;
+            row[k] = static_cast<float>(value);
+            sum += value;
+        }
+
+        // Unity gain at DC for every phase, so there is no phase-dependent ripple
+        for (int k = 0; k < taps; k++) {
+            row[k] = static_cast<float>(row[k] / sum);
+        }
+    }
+}
+
+struct TierSpec {
+    int taps;
+    int phases;
+    double rolloff;
+    double beta;
+    bool interpolate;
+};
+
+static TierSpec tierSpec(ResampleQuality quality) {
+    switch (quality) {
+        case ResampleQuality::Draft: return {8, 64, 0.85, 5.0, false};
+        case ResampleQuality::Standard: return {16, 256, 0.90, 7.0, true};
+        default: return {32, 512, 0.94, 9.0, true};
+    }
+}
+
+std::shared_ptr<const SincFilterBank> getSincFilterBank(ResampleQuality quality, double step) {
+    static std::mutex cacheMutex;
+    static std::map<std::pair<int, long>, std::shared_ptr<const SincFilterBank>> cache;
+
+    // Banks are keyed by step to 1e-4; closer steps share a filter
+    long stepKey = std::lround(step * 10000.0);
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto found = cache.find({static_cast<int>(quality), stepKey});
+    if (found != cache.end()) {
+        return found->second;
+    }
+
+    TierSpec spec = tierSpec(quality);
+    double stretch = std::max(1.0, step);
+    int taps = static_cast<int>(std::ceil(spec.taps * stretch / 4.0)) * 4;
+    taps = std::min(taps, kMaxResampleTaps);
+    double cutoff = 0.5 * spec.rolloff / stretch;
+
+    auto bank = std::make_shared<const SincFilterBank>(taps, spec.phases, cutoff, spec.beta, spec.interpolate);
+    cache[{static_cast<int>(quality), stepKey}] = bank;
+    return bank;
+}
+
+void SincBankLadder::build(ResampleQuality quality, double maxStep) {
+    banks_.clear();
+    for (int level = 0; ; level++) {
+        double stretch = std::exp2(level / 4.0);
+        banks_.push_back(getSincFilterBank(quality, stretch));
+        if (stretch >= maxStep) break;
+    }
+}
+
+const SincFilterBank* SincBankLadder::select(double step) const {
+    if (banks_.empty()) return nullptr;
+    // Level k covers steps up to 2^(k/4)
+    int level = (step <= 1.0) ? 0 : static_cast<int>(std::ceil(std::log2(step) * 4.0 - 1e-9));
+    level = std::min(level, static_cast<int>(banks_.size()) - 1);
+    return banks_[level].get();
+}
+
+// Stereo dot product of `taps` coefficients against two source windows
+static inline void dotStereo(const float* coeffs, const float* left, const float* right, int taps,
+                             float& outLeft, float& outRight) {
+#if defined(RESAMPLER_SSE)
+    __m128 sumL = _mm_setzero_ps();
+    __m128 sumR = _mm_setzero_ps();
+    for (int k = 0; k < taps; k += 4) {
+        __m128 c = _mm_loadu_ps(coeffs + k);
+        sumL = _mm_add_ps(sumL, _mm_mul_ps(c, _mm_loadu_ps(left + k)));
+        sumR = _mm_add_ps(sumR, _mm_mul_ps(c, _mm_loadu_ps(right + k)));
+    }
+    // Horizontal add of both accumulators at once
+    __m128 lo = _mm_unpacklo_ps(sumL, sumR); // L0 R0 L1 R1
+    __m128 hi = _mm_unpackhi_ps(sumL, sumR); // L2 R2 L3 R3
+    __m128 pair = _mm_add_ps(lo, hi);
+    pair = _mm_add_ps(pair, _mm_movehl_ps(pair, pair));
+    float result[4];
+    _mm_storeu_ps(result, pair);
+    outLeft = result[0];
+    outRight = result[1];
+#elif defined(RESAMPLER_WASM_SIMD)
+    v128_t sumL = wasm_f32x4_splat(0.0f);
+    v128_t sumR = wasm_f32x4_splat(0.0f);
+    for (int k = 0; k < taps; k += 4) {
+        v128_t c = wasm_v128_load(coeffs + k);
+        sumL = wasm_f32x4_add(sumL, wasm_f32x4_mul(c, wasm_v128_load(left + k)));
+        sumR = wasm_f32x4_add(sumR, wasm_f32x4_mul(c, wasm_v128_load(right + k)));
+    }
+    outLeft = wasm_f32x4_extract_lane(sumL, 0) + wasm_f32x4_extract_lane(sumL, 1) +
+              wasm_f32x4_extract_lane(sumL, 2) + wasm_f32x4_extract_lane(sumL, 3);
+    outRight = wasm_f32x4_extract_lane(sumR, 0) + wasm_f32x4_extract_lane(sumR, 1) +
+               wasm_f32x4_extract_lane(sumR, 2) + wasm_f32x4_extract_lane(sumR, 3);
+#else
+    float sumL[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    float sumR[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int k = 0; k < taps; k += 4) {
+        for (int j = 0; j < 4; j++) {
+            sumL[j] += coeffs[k + j] * left[k + j];
+            sumR[j] += coeffs[k + j] * right[k + j];
+        }
+    }
+    outLeft = (sumL[0] + sumL[1]) + (sumL[2] + sumL[3]);
+    outRight = (sumR[0] + sumR[1]) + (sumR[2] + sumR[3]);
+#endif
+}
+
+void sincInterpolateStereo(const SincFilterBank& bank, const float* left, const float* right,
+                           double frac, float& outLeft, float& outRight) {
+    const int taps = bank.taps();
+    double scaled = frac * bank.phases();
+    int index = static_cast<int>(scaled);
+
+    if (!bank.interpolatesPhases()) {
+        // Nearest phase
+        int nearest = std::min(static_cast<int>(scaled + 0.5), bank.phases());
+        dotStereo(bank.phase(nearest), left, right, taps, outLeft, outRight);
+        return;
+    }
+
+    // Blend the two neighbouring phases; the filter is linear, so blending the
+    // outputs equals filtering with blended coefficients
+    float blend = static_cast<float>(scaled - index);
+    float l0, r0, l1, r1;
+    dotStereo(bank.phase(index), left, right, taps, l0, r0);
+    dotStereo(bank.phase(index + 1), left, right, taps, l1, r1);
+    outLeft = l0 + (l1 - l0) * blend;
+    outRight = r0 + (r1 - r0) * blend;
+}
+
+void resampleStereo(const std::vector<float>& inLeft, const std::vector<float>& inRight,
+                    std::vector<float>& outLeft, std::vector<float>& outRight,
+                    double step, ResampleQuality quality) {
+    std::shared_ptr<const SincFilterBank> bank = getSincFilterBank(quality, step);
+    const int taps = bank->taps();
+    const int half = taps / 2;
+
+    // Pad so every tap window is in range
+    std::vector<float> paddedLeft(inLeft.size() + taps + 1, 0.0f);
+    std::vector<float> paddedRight(inRight.size() + taps + 1, 0.0f);
+    std::copy(inLeft.begin(), inLeft.end(), paddedLeft.begin() + (half - 1));
+    std::copy(inRight.begin(), inRight.end(), paddedRight.begin() + (half - 1));
+
+    size_t outFrames = static_cast<size_t>(std::floor(inLeft.size() / step));
+    outLeft.resize(outFrames);
+    outRight.resize(outFrames);
+    for (size_t n = 0; n < outFrames; n++) {
+        double position = n * step;
+        size_t index = static_cast<size_t>(position);
+        sincInterpolateStereo(*bank, paddedLeft.data() + index, paddedRight.data() + index,
+                              position - index, outLeft[n], outRight[n]);
+    }
+}
+
+// Window index and fraction of output frames n..n+3. Offsets are computed
+// from the chunk start in double precision, so error doesn't accumulate.
+static inline void positions4(double start, double step, size_t n, int* index, float* frac) {
+    for (int j = 0; j < 4; j++) {
+        double offset = start + static_cast<double>(n + j) * step;
+        index[j] = static_cast<int>(offset);
+        frac[j] = static_cast<float>(offset - index[j]);
+    }
+}
+
+// Window taps start at the output position, so index i interpolates i..i+1
+static void renderLinear(const float* left, const float* right, double start, double step,
+                         float* outLeft, float* outRight, size_t frames) {
+    size_t n = 0;
+#if defined(RESAMPLER_VEC4)
+    for (; n + 4 <= frames; n += 4) {
+        int i[4];
+        float frac[4];
+        positions4(start, step, n, i, frac);
+        Vec4 f = vecLoad(frac);
+
+        Vec4 l0 = vecSet(left[i[0]], left[i[1]], left[i[2]], left[i[3]]);
+        Vec4 l1 = vecSet(left[i[0] + 1], left[i[1] + 1], left[i[2] + 1], left[i[3] + 1]);
+        Vec4 r0 = vecSet(right[i[0]], right[i[1]], right[i[2]], right[i[3]]);
+        Vec4 r1 = vecSet(right[i[0] + 1], right[i[1] + 1], right[i[2] + 1], right[i[3] + 1]);
+        vecStore(outLeft + n, vecAdd(l0, vecMul(vecSub(l1, l0), f)));
+        vecStore(outRight + n, vecAdd(r0, vecMul(vecSub(r1, r0), f)));
+    }
+#endif
+    for (; n < frames; n++) {
+        double offset = start + n * step;
+        size_t i = static_cast<size_t>(offset);
+        float f = static_cast<float>(offset - i);
+        outLeft[n] = left[i] + (left[i + 1] - left[i]) * f;
+        outRight[n] = right[i] + (right[i + 1] - right[i]) * f;
+    }
+}
+
+// Catmull-Rom weights for the taps at -1, 0, 1 and 2
+static inline void hermiteWeights(float f, float* w) {
+    float f2 = f * f;
+    float f3 = f2 * f;
+    w[0] = -0.5f * f3 + f2 - 0.5f * f;
+    w[1] = 1.5f * f3 - 2.5f * f2 + 1.0f;
+    w[2] = -1.5f * f3 + 2.0f * f2 + 0.5f * f;
+    w[3] = 0.5f * f3 - 0.5f * f2;
+}
+
+// Window taps start one frame before the output position, so index i
+// interpolates between i+1 and i+2
+static void renderCubic(const float* left, const float* right, double start, double step,
+                        float* outLeft, float* outRight, size_t frames) {
+    size_t n = 0;
+#if defined(RESAMPLER_VEC4)
+    const Vec4 half = vecSplat(0.5f);
+    const Vec4 oneHalf = vecSplat(1.5f);
+    const Vec4 two = vecSplat(2.0f);
+    const Vec4 twoHalf = vecSplat(2.5f);
+    const Vec4 one = vecSplat(1.0f);
+
+    for (; n + 4 <= frames; n += 4) {
+        int i[4];
+        float frac[4];
+        positions4(start, step, n, i, frac);
+
+        // Weights for four outputs at once
+        Vec4 f = vecLoad(frac);
+        Vec4 f2 = vecMul(f, f);
+        Vec4 f3 = vecMul(f2, f);
+        Vec4 w0 = vecSub(f2, vecMul(half, vecAdd(f3, f)));
+        Vec4 w1 = vecAdd(vecSub(vecMul(oneHalf, f3), vecMul(twoHalf, f2)), one);
+        Vec4 w2 = vecAdd(vecSub(vecMul(two, f2), vecMul(oneHalf, f3)), vecMul(half, f));
+        Vec4 w3 = vecMul(half, vecSub(f3, f2));
+
+        const float* channels[2] = {left, right};
+        float* outputs[2] = {outLeft, outRight};
+        for (int ch = 0; ch < 2; ch++) {
+            const float* x = channels[ch];
+            Vec4 xm1 = vecSet(x[i[0]], x[i[1]], x[i[2]], x[i[3]]);
+            Vec4 x0 = vecSet(x[i[0] + 1], x[i[1] + 1], x[i[2] + 1], x[i[3] + 1]);
+            Vec4 x1 = vecSet(x[i[0] + 2], x[i[1] + 2], x[i[2] + 2], x[i[3] + 2]);
+            Vec4 x2 = vecSet(x[i[0] + 3], x[i[1] + 3], x[i[2] + 3], x[i[3] + 3]);
+            Vec4 sum = vecAdd(vecAdd(vecMul(w0, xm1), vecMul(w1, x0)),
+                              vecAdd(vecMul(w2, x1), vecMul(w3, x2)));
+            vecStore(outputs[ch] + n, sum);
+        }
+    }
+#endif
+    for (; n < frames; n++) {
+        double offset = start + n * step;
+        size_t i = static_cast<size_t>(offset);
+        float w[4];
+        hermiteWeights(static_cast<float>(offset - i), w);
+        outLeft[n] = w[0] * left[i] + w[1] * left[i + 1] + w[2] * left[i + 2] + w[3] * left[i + 3];
+        outRight[n] = w[0] * right[i] + w[1] * right[i + 1] + w[2] * right[i + 2] + w[3] * right[i + 3];
+    }
+}
+
+// Window taps start taps/2 - 1 frames before the output position
+static void renderSinc(const SincFilterBank& bank, const float* left, const float* right,
+                       double start, double step, float* outLeft, float* outRight, size_t frames) {
+    for (size_t n = 0; n < frames; n++) {
+        double offset = start + n * step;
+        size_t index = static_cast<size_t>(offset);
+        sincInterpolateStereo(bank, left + index, right + index, offset - index, outLeft[n], outRight[n]);
+    }
+}
+
+StreamResampler::StreamResampler() : mode_(InterpolationMode::Sinc), bank_(nullptr), frac_(0.0) {
+}
+
+void StreamResampler::prepare(size_t maxFrames, double maxStep) {
+    size_t capacity = static_cast<size_t>(std::ceil(maxFrames * maxStep)) + kMaxResampleTaps + 2;
+    window_left_.assign(capacity, 0.0f);
+    window_right_.assign(capacity, 0.0f);
+}
+
+// Load source frames [position - lead, position - lead + count) into the
+// window, zero-padding before the start of the track
+void StreamResampler::fillWindow(const AudioFile& track, size_t position, size_t lead, size_t count) {
+    size_t zeros = std::min((position < lead) ? lead - position : 0, count);
+    std::fill(window_left_.begin(), window_left_.begin() + zeros, 0.0f);
+    std::fill(window_right_.begin(), window_right_.begin() + zeros, 0.0f);
+    track.readFrames(position + zeros - lead, count - zeros,
+                     window_left_.data() + zeros, window_right_.data() + zeros);
+}
+
+size_t StreamResampler::process(const AudioFile& track, size_t position, double step,
+                                float* outLeft, float* outRight, size_t frames) {
+    InterpolationMode mode = (mode_ == InterpolationMode::Sinc && !bank_) ? InterpolationMode::Cubic : mode_;
+    if (window_left_.empty()) {
+        std::fill(outLeft, outLeft + frames, 0.0f);
+        std::fill(outRight, outRight + frames, 0.0f);
+        return 0;
+    }
+
+    // Kernel width and how many of its taps sit before the output position
+    size_t taps, lead;
+    switch (mode) {
+        case InterpolationMode::Linear: taps = 2; lead = 0; break;
+        case InterpolationMode::Cubic: taps = 4; lead = 1; break;
+        default: taps = bank_->taps(); lead = taps / 2 - 1; break;
+    }
+
+    const size_t capacity = window_left_.size();
+    size_t consumed = 0;
+    size_t done = 0;
+
+    while (done < frames) {
+        // Largest chunk whose tap windows fit in the scratch buffers
+        size_t chunk = std::min(frames - done, static_cast<size_t>((capacity - taps - 2) / step));
+        chunk = std::max<size_t>(chunk, 1);
+
+        size_t span = static_cast<size_t>(frac_ + (chunk - 1) * step) + taps;
+        fillWindow(track, position + consumed, lead, std::min(span, capacity));
+
+        const float* left = window_left_.data();
+        const float* right = window_right_.data();
+        switch (mode) {
+            case InterpolationMode::Linear:
+                renderLinear(left, right, frac_, step, outLeft + done, outRight + done, chunk);
+                break;
+            case InterpolationMode::Cubic:
+                renderCubic(left, right, frac_, step, outLeft + done, outRight + done, chunk);
+                break;
+            default:
+                renderSinc(*bank_, left, right, frac_, step, outLeft + done, outRight + done, chunk);
+                break;
+        }
+
+        double advance = frac_ + chunk * step;
+        size_t whole = static_cast<size_t>(advance);
+        frac_ = advance - whole;
+        consumed += whole;
+        done += chunk;
+    }
+    return consumed;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+struct AudioFile;
+
+// Sample-rate conversion quality tiers, trading filter length for CPU
+enum class ResampleQuality : int {
+    Draft = 0,    // 8 taps, nearest of 64 phases
+    Standard = 1, // 16 taps, 256 interpolated phases
+    High = 2      // 32 taps, 512 interpolated phases
+};
+
+// How a deck reads between source frames when its rate isn't exactly 1
+enum class InterpolationMode : int {
+    Linear = 0, // 2 taps
+    Cubic = 1,  // 4-tap cubic Hermite (Catmull-Rom)
+    Sinc = 2    // band-limited, see ResampleQuality
+};
+
+// Kaiser-windowed sinc low-pass sampled at `phases` sub-sample offsets.
+// Every phase is a contiguous run of taps() coefficients (a multiple of 4), so
+// one output sample is a single dot product against the source window.
+class SincFilterBank {
+public:
+    SincFilterBank(int taps, int phases, double cutoff, double kaiserBeta, bool interpolatePhases);
+
+    int taps() const { return taps_; }
+    int phases() const { return phases_; }
+    bool interpolatesPhases() const { return interpolate_; }
+
+    // Coefficients for sub-sample offset index/phases(); index may equal phases()
+    const float* phase(int index) const { return coeffs_.data() + static_cast<size_t>(index) * taps_; }
+
+private:
+    int taps_;
+    int phases_;
+    bool interpolate_;
+    std::vector<float> coeffs_;
+};
+
+// Filter bank for reading `step` source frames per output frame. Downsampling
+// lowers the cutoff and widens the kernel to keep aliasing out. Banks are
+// cached, so this is cheap after the first call, but it may allocate: call it
+// off the audio thread.
+std::shared_ptr<const SincFilterBank> getSincFilterBank(ResampleQuality quality, double step);
+
+// Largest kernel any bank can have; sizes the callback's scratch windows
+const int kMaxResampleTaps = 256;
+
+// Banks for every read rate up to a maximum, a quarter octave apart, so a deck
+// whose pitch moves can switch kernels in the callback without allocating.
+// The banks come from the getSincFilterBank cache and are never freed.
+class SincBankLadder {
+public:
+    // Allocates; call it off the audio thread
+    void build(ResampleQuality quality, double maxStep);
+    bool isBuilt() const { return !banks_.empty(); }
+
+    // Narrowest bank that is alias-free at `step`. Real-time safe.
+    const SincFilterBank* select(double step) const;
+
+private:
+    std::vector<std::shared_ptr<const SincFilterBank>> banks_;
+};
+
+// Interpolate one stereo frame. `left`/`right` point at the first source tap
+// and `frac` is the position in [0, 1) between taps()/2 - 1 and taps()/2.
+void sincInterpolateStereo(const SincFilterBank& bank, const float* left, const float* right,
+                           double frac, float& outLeft, float& outRight);
+
+// Convert a whole decoded track at load time; `step` is input rate / output rate
+void resampleStereo(const std::vector<float>& inLeft, const std::vector<float>& inRight,
+                    std::vector<float>& outLeft, std::vector<float>& outRight,
+                    double step, ResampleQuality quality);
+
+// Fractional playhead for one deck. The deck keeps an integer source
+// position; the fractional remainder between blocks lives here, so reading at
+// any rate (pitch, sample-rate mismatch or both) never drifts.
+class StreamResampler {
+public:
+    StreamResampler();
+
+    // Size the source window for blocks of up to maxFrames at up to maxStep.
+    // Allocates, so call it before the stream starts.
+    void prepare(size_t maxFrames, double maxStep);
+
+    // Both may change between any two calls to process(). Sinc mode needs a
+    // bank, which must outlive its use here.
+    void setMode(InterpolationMode mode) { mode_ = mode; }
+    void setFilterBank(const SincFilterBank* bank) { bank_ = bank; }
+    void reset() { frac_ = 0.0; }
+    double fraction() const { return frac_; }
+
+    // Render `frames` output frames reading `track` from source frame
+    // `position`, advancing `step` source frames per output frame. Returns the
+    // number of whole source frames consumed. Real-time safe.
+    size_t process(const AudioFile& track, size_t position, double step,
+                   float* outLeft, float* outRight, size_t frames);
+
+private:
+    void fillWindow(const AudioFile& track, size_t position, size_t lead, size_t count);
+
+    InterpolationMode mode_;
+    const SincFilterBank* bank_;
+    double frac_;
+    std::vector<float> window_left_;
+    std::vector<float> window_right_;
+};
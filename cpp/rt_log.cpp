@@ -0,0 +1,64 @@
+#include "rt_log.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+
+// Set by the host bridge to receive every log line
+extern "C" {
+    void (*logCallback)(const char* message) = nullptr;
+}
+
+static std::mutex log_mutex;
+
+static void appendArg(std::string& text, const LogArg& arg) {
+    char buffer[32];
+    switch (arg.type) {
+        case LogArg::Signed: snprintf(buffer, sizeof(buffer), "%" PRId64, arg.i); break;
+        case LogArg::Unsigned: snprintf(buffer, sizeof(buffer), "%" PRIu64, arg.u); break;
+        case LogArg::Double: snprintf(buffer, sizeof(buffer), "%g", arg.d); break;
+        case LogArg::Bool: text += arg.b ? "true" : "false"; return;
+        case LogArg::String: text += arg.s ? arg.s : "(null)"; return;
+    }
+    text += buffer;
+}
+
+std::string formatLog(const LogRecord& record) {
+    std::string text;
+    int next = 0;
+    for (const char* p = record.format; *p; p++) {
+        if (p[0] == '{' && p[1] == '}' && next < record.argCount) {
+            appendArg(text, record.args[next++]);
+            p++;
+        } else {
+            text += *p;
+        }
+    }
+    return text;
+}
+
+void writeLog(const LogRecord& record) {
+    static const char* const kPrefixes[] = {"[debug] ", "", "⚠️ ", "❌ "};
+    std::string line = kPrefixes[static_cast<int>(record.level)] + formatLog(record);
+
+    std::lock_guard<std::mutex> lock(log_mutex);
+    std::ostream& out = (record.level >= LogLevel::Warning) ? std::cerr : std::cout;
+    out << line << std::endl;
+    if (logCallback) {
+        logCallback(line.c_str());
+    }
+}
+
+void RtLog::drain() {
+    while (const LogRecord* record = queue_.front()) {
+        writeLog(*record);
+        queue_.pop();
+    }
+
+    uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != reported_dropped_) {
+        logWarning("Audio thread log full, {} messages dropped", dropped - reported_dropped_);
+        reported_dropped_ = dropped;
+    }
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "param_queue.h"
+
+enum class LogLevel : uint8_t {
+    Debug,
+    Info,
+    Warning,
+    Error
+};
+
+// Levels below this are compiled out: everything in debug builds, warnings
+// and errors in release. Define DJ_LOG_MIN_LEVEL (0-3) to override.
+#ifndef DJ_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define DJ_LOG_MIN_LEVEL 2
+#else
+#define DJ_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+// A log argument captured as is, to be formatted later
+struct LogArg {
+    enum Type : uint8_t { Signed, Unsigned, Double, Bool, String };
+    Type type;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        bool b;
+        const char* s;
+    };
+};
+
+// A message not yet formatted: the format string and its arguments. Each
+// "{}" in the format is replaced by the next argument.
+struct LogRecord {
+    static const int kMaxArgs = 6;
+
+    const char* format;
+    LogLevel level;
+    uint8_t argCount;
+    LogArg args[kMaxArgs];
+};
+
+namespace log_detail {
+
+template <typename T>
+inline LogArg capture(T value) {
+    static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "Unsupported log argument type");
+    LogArg arg;
+    if constexpr (std::is_floating_point<T>::value) {
+        arg.type = LogArg::Double;
+        arg.d = static_cast<double>(value);
+    } else if constexpr (std::is_signed<T>::value || std::is_enum<T>::value) {
+        arg.type = LogArg::Signed;
+        arg.i = static_cast<int64_t>(value);
+    } else {
+        arg.type = LogArg::Unsigned;
+        arg.u = static_cast<uint64_t>(value);
+    }
+    return arg;
+}
+
+inline LogArg capture(bool value) {
+    LogArg arg;
+    arg.type = LogArg::Bool;
+    arg.b = value;
+    return arg;
+}
+
+inline LogArg capture(const char* value) {
+    LogArg arg;
+    arg.type = LogArg::String;
+    arg.s = value;
+    return arg;
+}
+
+template <typename... Args>
+inline LogRecord makeRecord(LogLevel level, const char* format, Args... args) {
+    static_assert(sizeof...(Args) <= LogRecord::kMaxArgs, "Too many log arguments");
+    LogRecord record = {};
+    record.format = format;
+    record.level = level;
+    record.argCount = static_cast<uint8_t>(sizeof...(Args));
+    int index = 0;
+    ((record.args[index++] = capture(args)), ...);
+    (void)index;
+    return record;
+}
+
+} // namespace log_detail
+
+// The message with its arguments filled in
+std::string formatLog(const LogRecord& record);
+
+// Format a record and write it to stdout (stderr for warnings and errors)
+// and to logCallback, if the host set one. Thread safe; takes a lock and
+// does console I/O, so never call it on the audio thread.
+void writeLog(const LogRecord& record);
+
+// For any thread but the audio thread: written straight away
+template <typename... Args>
+inline void logDebug(const char* format, Args... args) {
+    if constexpr (DJ_LOG_MIN_LEVEL <= 0) writeLog(log_detail::makeRecord(LogLevel::Debug, format, args...));
+}
+template <typename... Args>
+inline void logInfo(const char* format, Args... args) {
+    if constexpr (DJ_LOG_MIN_LEVEL <= 1) writeLog(log_detail::makeRecord(LogLevel::Info, format, args...));
+}
+template <typename... Args>
+inline void logWarning(const char* format, Args... args) {
+    if constexpr (DJ_LOG_MIN_LEVEL <= 2) writeLog(log_detail::makeRecord(LogLevel::Warning, format, args...));
+}
+template <typename... Args>
+inline void logError(const char* format, Args... args) {
+    writeLog(log_detail::makeRecord(LogLevel::Error, format, args...));
+}
+
+// Log for the audio thread. A message is a fixed-size record pushed onto a
+// preallocated ring, with its arguments copied but not formatted, so logging
+// never allocates, locks or touches the console. Another thread drains the
+// ring with drain(). Formats and string arguments must be string literals
+// (or otherwise outlive the drain). Messages that find the ring full are
+// counted and reported by the next drain.
+class RtLog {
+public:
+    static const size_t kCapacity = 256;
+
+    // Audio thread only
+    template <typename... Args>
+    void debug(const char* format, Args... args) {
+        if constexpr (DJ_LOG_MIN_LEVEL <= 0) push(log_detail::makeRecord(LogLevel::Debug, format, args...));
+    }
+    template <typename... Args>
+    void info(const char* format, Args... args) {
+        if constexpr (DJ_LOG_MIN_LEVEL <= 1) push(log_detail::makeRecord(LogLevel::Info, format, args...));
+    }
+    template <typename... Args>
+    void warning(const char* format, Args... args) {
+        if constexpr (DJ_LOG_MIN_LEVEL <= 2) push(log_detail::makeRecord(LogLevel::Warning, format, args...));
+    }
+    template <typename... Args>
+    void error(const char* format, Args... args) {
+        push(log_detail::makeRecord(LogLevel::Error, format, args...));
+    }
+
+    // Write out everything logged so far with writeLog(); one thread at a time
+    void drain();
+
+private:
+    void push(const LogRecord& record) {
+        if (queue_.push(record)) {
+            queue_.publish();
+        } else {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    SpscQueue<LogRecord, kCapacity> queue_;
+    std::atomic<uint64_t> dropped_{0};
+    uint64_t reported_dropped_ = 0; // drain side only
+};
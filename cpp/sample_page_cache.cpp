@@ -0,0 +1,206 @@
+#include "sample_page_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+PagedPcm::PagedPcm(SamplePageCache& cache)
+    : cache_(cache),
+      data_offset_(0),
+      format_(SampleFormat::Int16),
+      channels_(2),
+      stride_(0),
+      frame_count_(0),
+      page_frames_(0),
+      page_count_(0),
+      epoch_(0),
+      misses_(0),
+      resident_pages_(0) {}
+
+PagedPcm::~PagedPcm() {
+    cache_.release(*this);
+}
+
+size_t PagedPcm::residentBytes() const {
+    return resident_pages_.load(std::memory_order_relaxed) * SamplePageCache::kPageBytes;
+}
+
+void PagedPcm::read(size_t start, size_t count, float* left, float* right) const {
+    size_t available = (start < frame_count_) ? std::min(count, frame_count_ - start) : 0;
+    bool missed = false;
+
+    // Sequentially consistent with the eviction side: either the evictor sees
+    // this read running, or this read sees the page already gone
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    size_t done = 0;
+    while (done < available) {
+        size_t frame = start + done;
+        size_t page = frame / page_frames_;
+        size_t offset = frame - page * page_frames_;
+        size_t n = std::min(available - done, page_frames_ - offset);
+        const uint8_t* data = pages_[page].load(std::memory_order_seq_cst);
+        if (data) {
+            convertToFloat(data + offset * stride_, format_, channels_, stride_, n, left + done, right + done);
+        } else {
+            std::fill(left + done, left + done + n, 0.0f);
+            std::fill(right + done, right + done + n, 0.0f);
+            missed = true;
+        }
+        done += n;
+    }
+    epoch_.fetch_add(1, std::memory_order_release);
+
+    if (missed) misses_.fetch_add(1, std::memory_order_relaxed);
+    if (available < count) {
+        std::fill(left + available, left + count, 0.0f);
+        std::fill(right + available, right + count, 0.0f);
+    }
+}
+
+SamplePageCache::SamplePageCache() : budget_(kDefaultBudgetBytes), clock_(0) {}
+
+void SamplePageCache::setBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ = std::max(bytes, kMinBudgetBytes);
+
+    // Slots are referenced by index, so shrink from the end
+    size_t maxSlots = budget_ / kPageBytes;
+    for (size_t i = maxSlots; i < slots_.size(); i++) {
+        if (slots_[i].owner) evict(slots_[i]);
+    }
+    if (slots_.size() > maxSlots) slots_.resize(maxSlots);
+}
+
+size_t SamplePageCache::budgetBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return budget_;
+}
+
+size_t SamplePageCache::usedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t used = 0;
+    for (const Slot& slot : slots_) {
+        if (slot.owner) used += kPageBytes;
+    }
+    return used;
+}
+
+std::shared_ptr<PagedPcm> SamplePageCache::open(const std::string& path, size_t dataOffset, SampleFormat format,
+                                                int channels, size_t stride, size_t frames, std::string& error) {
+    if (stride == 0 || stride > kPageBytes) {
+        error = "Unsupported frame size for paged reading";
+        return nullptr;
+    }
+    std::shared_ptr<PagedPcm> pcm(new PagedPcm(*this));
+    pcm->file_.open(path, std::ios::binary);
+    if (!pcm->file_) {
+        error = "Failed to open file: " + path;
+        return nullptr;
+    }
+
+    pcm->data_offset_ = dataOffset;
+    pcm->format_ = format;
+    pcm->channels_ = channels;
+    pcm->stride_ = stride;
+    pcm->frame_count_ = frames;
+    pcm->page_frames_ = kPageBytes / stride;
+    pcm->page_count_ = (frames + pcm->page_frames_ - 1) / pcm->page_frames_;
+    pcm->pages_.reset(new std::atomic<const uint8_t*>[pcm->page_count_]());
+    pcm->slots_.reset(new uint32_t[pcm->page_count_]);
+    std::fill(pcm->slots_.get(), pcm->slots_.get() + pcm->page_count_, kNoSlot);
+    return pcm;
+}
+
+void SamplePageCache::fill(PagedPcm& pcm, size_t first, size_t end) {
+    end = std::min(end, pcm.frame_count_);
+    if (first >= end) return;
+    size_t firstPage = first / pcm.page_frames_;
+    size_t lastPage = (end - 1) / pcm.page_frames_;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Pages already in the range are used again now; nothing this call
+    // touches can be evicted by it
+    uint64_t pinnedFrom = clock_ + 1;
+    for (size_t page = firstPage; page <= lastPage; page++) {
+        if (pcm.slots_[page] != kNoSlot) slots_[pcm.slots_[page]].lastUse = ++clock_;
+    }
+
+    for (size_t page = firstPage; page <= lastPage; page++) {
+        if (pcm.slots_[page] != kNoSlot) continue;
+        uint32_t index = claimSlot(pinnedFrom);
+        if (index == kNoSlot) return;
+
+        Slot& slot = slots_[index];
+        if (!loadPage(pcm, page, slot)) return;
+        slot.owner = &pcm;
+        slot.page = page;
+        slot.lastUse = ++clock_;
+        pcm.slots_[page] = index;
+        pcm.resident_pages_.fetch_add(1, std::memory_order_relaxed);
+        pcm.pages_[page].store(slot.data.get(), std::memory_order_release);
+    }
+}
+
+// A free slot, a new one while under budget, or the least recently used
+// page not touched since `pinnedFrom`
+uint32_t SamplePageCache::claimSlot(uint64_t pinnedFrom) {
+    for (size_t i = 0; i < slots_.size(); i++) {
+        if (!slots_[i].owner) return static_cast<uint32_t>(i);
+    }
+    if (slots_.size() < budget_ / kPageBytes) {
+        slots_.push_back(Slot{std::unique_ptr<uint8_t[]>(new uint8_t[kPageBytes]), nullptr, 0, 0});
+        return static_cast<uint32_t>(slots_.size() - 1);
+    }
+
+    uint32_t oldest = kNoSlot;
+    for (size_t i = 0; i < slots_.size(); i++) {
+        if (slots_[i].lastUse >= pinnedFrom) continue;
+        if (oldest == kNoSlot || slots_[i].lastUse < slots_[oldest].lastUse) oldest = static_cast<uint32_t>(i);
+    }
+    if (oldest != kNoSlot) evict(slots_[oldest]);
+    return oldest;
+}
+
+// Unpublish the page, then wait out a read() that may have loaded it before
+// the buffer is used again. Reads take microseconds.
+void SamplePageCache::evict(Slot& slot) {
+    PagedPcm& owner = *slot.owner;
+    owner.pages_[slot.page].store(nullptr, std::memory_order_seq_cst);
+    owner.slots_[slot.page] = kNoSlot;
+    owner.resident_pages_.fetch_sub(1, std::memory_order_relaxed);
+
+    uint32_t epoch = owner.epoch_.load(std::memory_order_seq_cst);
+    if (epoch & 1) {
+        while (owner.epoch_.load(std::memory_order_acquire) == epoch) {
+            std::this_thread::yield();
+        }
+    }
+    slot.owner = nullptr;
+    slot.lastUse = 0;
+}
+
+// The track is being deleted, so nothing reads its pages any more
+void SamplePageCache::release(PagedPcm& pcm) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t page = 0; page < pcm.page_count_; page++) {
+        if (pcm.slots_[page] == kNoSlot) continue;
+        Slot& slot = slots_[pcm.slots_[page]];
+        slot.owner = nullptr;
+        slot.lastUse = 0;
+    }
+}
+
+bool SamplePageCache::loadPage(PagedPcm& pcm, size_t page, Slot& slot) {
+    size_t firstFrame = page * pcm.page_frames_;
+    size_t bytes = std::min(pcm.page_frames_, pcm.frame_count_ - firstFrame) * pcm.stride_;
+
+    pcm.file_.clear();
+    pcm.file_.seekg(static_cast<std::streamoff>(pcm.data_offset_ + firstFrame * pcm.stride_));
+    pcm.file_.read(reinterpret_cast<char*>(slot.data.get()), static_cast<std::streamsize>(bytes));
+    size_t got = static_cast<size_t>(pcm.file_.gcount());
+    if (got == 0) return false;
+
+    // A file cut short since it was opened plays the missing part as silence
+    if (got < bytes) memset(slot.data.get() + got, 0, bytes - got);
+    return true;
+}
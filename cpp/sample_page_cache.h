@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "pcm_convert.h"
+
+class SamplePageCache;
+
+// The PCM of one file, read a page at a time into a SamplePageCache. The
+// audio thread converts resident pages in place; pages are only read from
+// disk and evicted on another thread, so unlike a mapped track the callback
+// never waits on the disk when the prefetch falls behind. It plays silence.
+class PagedPcm {
+public:
+    ~PagedPcm();
+
+    size_t frameCount() const { return frame_count_; }
+
+    // Convert `count` frames from `start`, like AudioFile::readFrames. Frames
+    // on pages that aren't resident read as silence and count as a miss.
+    // Safe to call from the audio thread.
+    void read(size_t start, size_t count, float* left, float* right) const;
+
+    uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+    size_t residentBytes() const;
+
+private:
+    friend class SamplePageCache;
+    explicit PagedPcm(SamplePageCache& cache);
+
+    SamplePageCache& cache_;
+    std::ifstream file_;
+    size_t data_offset_;
+    SampleFormat format_;
+    int channels_;
+    size_t stride_;
+    size_t frame_count_;
+    size_t page_frames_; // Whole frames per page, so no frame straddles two
+    size_t page_count_;
+
+    // Resident page data, or null. Readers bracket their loads with two
+    // increments of epoch_, which is odd while a read() is running, so
+    // eviction can wait out a read that may still hold the old pointer.
+    std::unique_ptr<std::atomic<const uint8_t*>[]> pages_;
+    std::unique_ptr<uint32_t[]> slots_; // Cache slot per page; guarded by the cache's mutex
+    mutable std::atomic<uint32_t> epoch_;
+    mutable std::atomic<uint64_t> misses_;
+    std::atomic<size_t> resident_pages_;
+};
+
+// Fixed-size pages of track PCM shared by every paged track, with the least
+// recently used page evicted first once the budget is reached. Page buffers
+// are reused rather than freed, so a steady set of decks stops allocating.
+// All methods may block on disk reads; none may run on the audio thread.
+class SamplePageCache {
+public:
+    static constexpr size_t kPageBytes = 256 * 1024;
+    static constexpr size_t kDefaultBudgetBytes = 256ull << 20;
+    // Enough for a few seconds around the playhead of every deck at once
+    static constexpr size_t kMinBudgetBytes = 32ull << 20;
+
+    SamplePageCache();
+
+    // Clamped to kMinBudgetBytes. Pages past a smaller budget are dropped
+    // at once.
+    void setBudget(size_t bytes);
+    size_t budgetBytes() const;
+    size_t usedBytes() const;
+
+    // PCM of `path` laid out as given (interleaved little-endian frames of
+    // `stride` bytes from `dataOffset`), with no page resident yet
+    std::shared_ptr<PagedPcm> open(const std::string& path, size_t dataOffset, SampleFormat format, int channels,
+                                   size_t stride, size_t frames, std::string& error);
+
+    // Make frames [first, end) of `pcm` resident, reading missing pages in
+    // order, and mark them recently used
+    void fill(PagedPcm& pcm, size_t first, size_t end);
+
+private:
+    friend class PagedPcm;
+
+    struct Slot {
+        std::unique_ptr<uint8_t[]> data;
+        PagedPcm* owner;
+        size_t page;
+        uint64_t lastUse;
+    };
+
+    static constexpr uint32_t kNoSlot = 0xffffffffu;
+
+    uint32_t claimSlot(uint64_t pinnedFrom);
+    void evict(Slot& slot);
+    void release(PagedPcm& pcm);
+    bool loadPage(PagedPcm& pcm, size_t page, Slot& slot);
+
+    mutable std::mutex mutex_;
+    std::vector<Slot> slots_;
+    size_t budget_;
+    uint64_t clock_;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Sequence lock around a small trivially copyable value, for one writer and
+// any number of readers that may live in other processes. The writer never
+// waits: it makes the sequence odd, stores the payload and makes it even
+// again. A reader copies the payload between two reads of the sequence and
+// retries if the sequence was odd or changed, so it never sees a torn value.
+//
+// The layout is plain data (a 32-bit sequence followed by the payload as
+// 32-bit words), so a reader in another language can follow the same steps.
+template <typename T>
+class SeqlockCell {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqlockCell needs a trivially copyable type");
+
+public:
+    static const size_t kWords = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    SeqlockCell() {
+        for (size_t i = 0; i < kWords; i++) {
+            words_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Writer side; real-time safe
+    void store(const T& value) {
+        uint32_t words[kWords] = {};
+        memcpy(words, &value, sizeof(T));
+
+        uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kWords; i++) {
+            words_[i].store(words[i], std::memory_order_relaxed);
+        }
+        sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Reader side. Returns false if a write was in progress; call again.
+    bool tryLoad(T& value) const {
+        uint32_t before = sequence_.load(std::memory_order_acquire);
+        if (before & 1) return false;
+
+        uint32_t words[kWords];
+        for (size_t i = 0; i < kWords; i++) {
+            words[i] = words_[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence_.load(std::memory_order_relaxed) != before) return false;
+
+        memcpy(&value, words, sizeof(T));
+        return true;
+    }
+
+    // Spins until a consistent copy is read; never use on the audio thread
+    T load() const {
+        T value;
+        while (!tryLoad(value)) {
+        }
+        return value;
+    }
+
+private:
+    std::atomic<uint32_t> sequence_{0};
+    std::atomic<uint32_t> words_[kWords];
+};
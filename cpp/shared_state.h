@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "audio_processor.h"
+#include "deck_layout.h"
+#include "seqlock.h"
+#include "telemetry_ring.h"
+
+// Layout of the /dj_audio_engine shared-memory segment (DJAudioEngine on
+// Windows), which other processes map read-only to follow the engine.
+//
+// The segment starts with a header, then whole cache lines for each region:
+// controls written by the control API, and telemetry written only by the
+// audio callback. Nothing one side writes shares a line with the other, so
+// a reader polling telemetry never slows down either writer. Multi-field
+// telemetry is published through SeqlockCell snapshots (the latest state)
+// and a TelemetryRing (every block's playheads and peaks, plus events).
+// Meter readings (MeterReading in audio_processor.h) are snapshots too.
+//
+// Readers must check magic, version and size before using anything else.
+// The magic is stored last during initialisation and cleared at shutdown.
+const uint32_t kSharedStateMagic = 0x45414A44; // "DJAE" in memory order
+const uint32_t kSharedStateVersion = 5;
+
+struct alignas(kCacheLineSize) SharedStateHeader {
+    std::atomic<uint32_t> magic{0};
+    uint32_t version = kSharedStateVersion;
+    uint32_t size = 0;          // sizeof(AudioState)
+    uint32_t deckCount = kMaxDecks;
+    uint32_t controlsOffset = 0; // byte offsets from the start of the segment
+    uint32_t masterOffset = 0;
+    uint32_t telemetryOffset = 0;
+    uint32_t engineTelemetryOffset = 0;
+    uint32_t ringOffset = 0;
+    uint32_t ringCapacity = TelemetryRing::kCapacity;
+    uint32_t ringRecordSize = sizeof(TelemetryRecord);
+};
+
+// Control region: the last value set through the API, one line group per deck
+struct alignas(kCacheLineSize) SharedDeckControls {
+    std::atomic<bool> playing{false};
+    std::atomic<bool> keyLock{false};
+    std::atomic<bool> sync{false};
+    std::atomic<float> volume{0.8f};
+    std::atomic<float> pitch{0.0f};
+    std::atomic<bool> effects[4]{{false}, {false}, {false}, {false}}; // flanger, filter, echo, reverb
+    std::atomic<float> eq[3]{{0.0f}, {0.0f}, {0.0f}};                 // low, mid, high
+};
+
+struct alignas(kCacheLineSize) SharedMasterControls {
+    std::atomic<float> crossfader{0.5f};
+    std::atomic<float> masterVolume{0.8f};
+    std::atomic<float> headphoneVolume{0.8f};
+    std::atomic<int32_t> syncLeader{1}; // deck number
+};
+
+// Telemetry region, written once per callback. Times are steady-clock
+// nanoseconds (AudioEngine_GetClockNs()).
+struct DeckTelemetry {
+    uint64_t frameClock;     // engine frame at the end of the block
+    uint64_t positionFrames; // playhead, in source frames
+    int64_t audibleTimeNs;   // when positionFrames reaches the speakers
+    double framesPerSecond;  // source frames per second of output, 0 when stopped
+    uint64_t durationFrames; // 0 when nothing is loaded
+    int32_t sampleRate;      // of the loaded track
+    uint32_t playing;
+    uint32_t following;      // tempo set by beat sync
+    float phaseError;        // seconds ahead of the leader's beat
+};
+
+struct EngineTelemetry {
+    uint64_t frameClock;
+    int64_t audibleTimeNs;   // when frameClock reaches the speakers
+    uint64_t callbacks;
+    uint64_t xruns;
+    int32_t sampleRate;
+    int32_t bufferSize;
+};
+
+// Where a deck's playhead is heard, and how fast it moves: enough to find the
+// audible position at any moment between callbacks without asking the engine
+struct PlayheadClock {
+    int64_t anchorTimeNs;    // steady-clock time positionFrames is heard
+    double positionFrames;   // in source frames
+    double framesPerSecond;  // 0 when stopped
+    uint64_t durationFrames; // 0 when nothing is loaded
+    int32_t sampleRate;      // of the loaded track
+    uint32_t playing;
+};
+
+inline PlayheadClock playheadClock(const DeckTelemetry& telemetry) {
+    PlayheadClock clock = {};
+    clock.anchorTimeNs = telemetry.audibleTimeNs;
+    clock.positionFrames = static_cast<double>(telemetry.positionFrames);
+    clock.framesPerSecond = telemetry.framesPerSecond;
+    clock.durationFrames = telemetry.durationFrames;
+    clock.sampleRate = telemetry.sampleRate;
+    clock.playing = telemetry.playing;
+    return clock;
+}
+
+// The playhead heard at `timeNs`. The anchor is usually still ahead by the
+// output latency, so looking back from it is normal; looking further ahead
+// than a few callbacks means the engine stalled, and the playhead holds
+// rather than running on.
+inline double playheadPositionAt(const PlayheadClock& clock, int64_t timeNs) {
+    const int64_t kMaxBehindNs = 1000000000;
+    const int64_t kMaxAheadNs = 100000000;
+    int64_t elapsed = std::min(std::max(timeNs - clock.anchorTimeNs, -kMaxBehindNs), kMaxAheadNs);
+    double position = clock.positionFrames + clock.framesPerSecond * static_cast<double>(elapsed) * 1e-9;
+    return std::min(std::max(position, 0.0), static_cast<double>(clock.durationFrames));
+}
+
+struct alignas(kCacheLineSize) SharedDeckTelemetry {
+    SeqlockCell<DeckTelemetry> snapshot;
+    SeqlockCell<MeterReading> meter;
+};
+
+struct alignas(kCacheLineSize) SharedEngineTelemetry {
+    SeqlockCell<EngineTelemetry> snapshot;
+    SeqlockCell<MeterReading> masterMeter; // after the master volume
+};
+
+struct AudioState {
+    SharedStateHeader header;
+
+    // Indexed by deck number - 1; see deck_layout.h
+    SharedDeckControls decks[kMaxDecks];
+    SharedMasterControls master;
+
+    SharedDeckTelemetry deckTelemetry[kMaxDecks];
+    SharedEngineTelemetry engine;
+    TelemetryRing ring;
+};
@@ -0,0 +1,55 @@
+#include "task_pool.h"
+
+TaskPool::TaskPool() : stopping_(false) {
+}
+
+TaskPool::~TaskPool() {
+    stop();
+}
+
+void TaskPool::start(int threadCount) {
+    if (isRunning()) return;
+    
+    stopping_ = false;
+    for (int i = 0; i < threadCount; i++) {
+        workers_.emplace_back(&TaskPool::workerLoop, this);
+    }
+}
+
+void TaskPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        jobs_.clear();
+    }
+    wake_.notify_all();
+    
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
+
+bool TaskPool::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || workers_.empty()) return false;
+        jobs_.push_back(std::move(job));
+    }
+    wake_.notify_one();
+    return true;
+}
+
+void TaskPool::workerLoop() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+            if (stopping_) return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        job();
+    }
+}
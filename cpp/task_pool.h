@@ -0,0 +1,34 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads running queued jobs in FIFO order.
+// Used for work that must stay off both the audio and the control threads.
+class TaskPool {
+public:
+    TaskPool();
+    ~TaskPool();
+    
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+    
+    void start(int threadCount);
+    void stop(); // Finishes running jobs, drops queued ones
+    
+    bool submit(std::function<void()> job);
+    bool isRunning() const { return !workers_.empty(); }
+    
+private:
+    void workerLoop();
+    
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> jobs_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_;
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// What a TelemetryRecord describes
+enum class TelemetryType : uint16_t {
+    Deck = 1,       // playhead and output peaks of a playing deck for one block
+    Master = 2,     // output peaks of the master bus for one block
+    EndOfTrack = 3, // a deck reached the end of its track (it loops, slots stop)
+    Xrun = 4        // the host reported an underflow or overflow
+};
+
+// One timestamped record. `frameClock` is the engine output frame the record
+// refers to: the end of the block for Deck (the playhead is where the deck
+// will resume) and Master, whose peaks cover the whole block; the start of
+// the block for Xrun; and the first frame played past the end of the track
+// for EndOfTrack, which on a looping key-locked deck can lie in a later block
+// because the time stretcher still holds the end of the track.
+struct TelemetryRecord {
+    uint64_t frameClock;
+    uint64_t position;  // Deck: playhead in source frames; Xrun: xruns so far
+    uint16_t type;      // TelemetryType
+    uint16_t deck;      // 0-based; kTelemetryMasterDeck for engine-wide records
+    uint32_t flags;     // Xrun: PaStreamCallbackFlags
+    float peak[2];      // Deck/Master: absolute peak, left and right
+    float rate;         // Deck: source frames per output frame
+    float reserved;
+};
+
+const uint16_t kTelemetryMasterDeck = 0xFFFF;
+
+// Broadcast ring of telemetry records in shared memory. There is one writer
+// (the audio callback) and any number of readers, each with its own cursor,
+// so reading never consumes anything and needs no syscalls or locks.
+//
+// Every slot carries a sequence stamp: 2n + 1 while record n is being written
+// into it and 2n + 2 once it is complete. `head` is the number of records
+// ever written. A reader that falls more than kCapacity records behind has
+// lost the oldest ones and resumes from the oldest record still present.
+struct TelemetryRing {
+    static const uint32_t kCapacity = 4096;
+    static const size_t kWords = sizeof(TelemetryRecord) / sizeof(uint32_t);
+
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<uint32_t> words[kWords];
+    };
+
+    alignas(64) std::atomic<uint64_t> head{0};
+    alignas(64) Slot slots[kCapacity];
+
+    // Writer side; wait-free and real-time safe
+    void push(const TelemetryRecord& record) {
+        uint32_t words[kWords];
+        memcpy(words, &record, sizeof(record));
+
+        uint64_t index = head.load(std::memory_order_relaxed);
+        Slot& slot = slots[index & (kCapacity - 1)];
+        slot.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kWords; i++) {
+            slot.words[i].store(words[i], std::memory_order_relaxed);
+        }
+        slot.sequence.store(index * 2 + 2, std::memory_order_release);
+        head.store(index + 1, std::memory_order_release);
+    }
+};
+
+static_assert(sizeof(TelemetryRecord) % sizeof(uint32_t) == 0, "TelemetryRecord must be whole words");
+
+// Reader-side cursor into a TelemetryRing. Start at the current head to see
+// only new records, or at 0 to replay whatever the ring still holds.
+class TelemetryReader {
+public:
+    explicit TelemetryReader(uint64_t cursor = 0) : cursor_(cursor), dropped_(0) {}
+
+    static TelemetryReader atHead(const TelemetryRing& ring) {
+        return TelemetryReader(ring.head.load(std::memory_order_acquire));
+    }
+
+    // Copy the next record; returns false once the reader has caught up
+    bool next(const TelemetryRing& ring, TelemetryRecord& record) {
+        for (;;) {
+            uint64_t head = ring.head.load(std::memory_order_acquire);
+            if (cursor_ >= head) return false;
+            if (head - cursor_ > TelemetryRing::kCapacity) {
+                skipTo(head - TelemetryRing::kCapacity);
+            }
+
+            const TelemetryRing::Slot& slot = ring.slots[cursor_ & (TelemetryRing::kCapacity - 1)];
+            uint64_t expected = cursor_ * 2 + 2;
+            uint64_t before = slot.sequence.load(std::memory_order_acquire);
+
+            uint32_t words[TelemetryRing::kWords];
+            for (size_t i = 0; i < TelemetryRing::kWords; i++) {
+                words[i] = slot.words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+
+            if (before == expected && after == expected) {
+                memcpy(&record, words, sizeof(record));
+                cursor_++;
+                return true;
+            }
+
+            // The writer lapped us while we were copying; move past the slot
+            skipTo(cursor_ + 1);
+        }
+    }
+
+    uint64_t cursor() const { return cursor_; }
+    uint64_t dropped() const { return dropped_; } // records lost to overruns
+
+private:
+    void skipTo(uint64_t cursor) {
+        dropped_ += cursor - cursor_;
+        cursor_ = cursor;
+    }
+
+    uint64_t cursor_;
+    uint64_t dropped_;
+};
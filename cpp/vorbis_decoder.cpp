@@ -0,0 +1,72 @@
+// Ogg Vorbis through stb_vorbis (public domain / MIT), built when CMake finds
+// third_party/stb_vorbis.c
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include "audio_decoder.h"
+
+// stb_vorbis defines short macros (L, C, R, ...), so it comes after every
+// other header
+#include "stb_vorbis.c"
+
+class VorbisDecoder : public AudioDecoder {
+public:
+    VorbisDecoder() : vorbis_(nullptr), sample_rate_(0), channels_(0), frames_(0) {}
+    ~VorbisDecoder() override {
+        if (vorbis_) stb_vorbis_close(vorbis_);
+    }
+
+    bool open(const std::string& filepath, std::string& error) {
+        int status = 0;
+        vorbis_ = stb_vorbis_open_filename(filepath.c_str(), &status, nullptr);
+        if (!vorbis_) {
+            error = "Could not open Ogg Vorbis file: " + filepath + " (error " + std::to_string(status) + ")";
+            return false;
+        }
+        stb_vorbis_info info = stb_vorbis_get_info(vorbis_);
+        sample_rate_ = static_cast<int>(info.sample_rate);
+        channels_ = info.channels;
+        frames_ = stb_vorbis_stream_length_in_samples(vorbis_);
+        if (frames_ == 0 || channels_ == 0) {
+            error = "Ogg Vorbis file has no audio: " + filepath;
+            return false;
+        }
+        return true;
+    }
+
+    int sampleRate() const override { return sample_rate_; }
+    int channels() const override { return channels_; }
+    size_t frameCount() const override { return frames_; }
+    const char* formatName() const override { return "Ogg Vorbis"; }
+
+    size_t read(size_t count, float* left, float* right) override {
+        // Asking for two outputs takes the first two channels; mono is copied
+        float* outputs[2] = {left, right};
+        int wanted = std::min(channels_, 2);
+        size_t decoded = 0;
+        while (decoded < count) {
+            float* at[2] = {outputs[0] + decoded, outputs[1] + decoded};
+            int got = stb_vorbis_get_samples_float(vorbis_, wanted, at, static_cast<int>(count - decoded));
+            if (got <= 0) break;
+            decoded += got;
+        }
+        if (channels_ == 1) std::copy(left, left + decoded, right);
+        return decoded;
+    }
+
+    bool seek(size_t frame) override { return stb_vorbis_seek(vorbis_, static_cast<unsigned int>(frame)) != 0; }
+
+private:
+    stb_vorbis* vorbis_;
+    int sample_rate_;
+    int channels_;
+    size_t frames_;
+};
+
+std::unique_ptr<AudioDecoder> openVorbisDecoder(const std::string& filepath, std::string& error) {
+    std::unique_ptr<VorbisDecoder> decoder(new VorbisDecoder());
+    if (!decoder->open(filepath, error)) return nullptr;
+    return decoder;
+}
@@ -1,81 +1,204 @@
 #include "audio_processor.h"
+#include "beat_analyzer.h"
+#include "key_detector.h"
+#include "deck_layout.h"
+#include "waveform.h"
 #include <emscripten.h>
+#include <cstring>
 #include <memory>
 
-// Global processor instances for two decks
-static std::unique_ptr<AudioProcessor> deck1Processor;
-static std::unique_ptr<AudioProcessor> deck2Processor;
+// Processor instances, one per deck and sample slot (deck number - 1)
+static std::unique_ptr<AudioProcessor> deckProcessors[kMaxDecks];
+
+// Key-lock time stretchers, fed by JS ahead of processing
+static std::unique_ptr<TimeStretcher> deckStretchers[kMaxDecks];
+static const int kMaxStretchBlock = 4096;
+
+// Meters after each deck's crossfader gain, and on the mix after the master volume
+static std::unique_ptr<LevelMeter> deckMeters[kMaxDecks];
+static std::unique_ptr<LevelMeter> masterMeter;
+static const int kMeterBlock = 1024;
+
+// Waveform overviews of each deck's current track
+static std::unique_ptr<WaveformPyramid> deckWaveforms[kMaxDecks];
 
 // Global state
 static float crossfaderValue = 0.5f; // 0.0 = deck1 only, 1.0 = deck2 only
 static float masterVolume = 1.0f;
 static int currentSampleRate = 44100;
 
+static AudioProcessor* processorFor(int deck) {
+    return (deck >= 1 && deck <= kMaxDecks) ? deckProcessors[deck - 1].get() : nullptr;
+}
+
+static TimeStretcher* stretcherFor(int deck) {
+    return (deck >= 1 && deck <= kMaxDecks) ? deckStretchers[deck - 1].get() : nullptr;
+}
+
+static LevelMeter* meterFor(int deck) {
+    return (deck >= 1 && deck <= kMaxDecks) ? deckMeters[deck - 1].get() : nullptr;
+}
+
+static WaveformPyramid* waveformFor(int deck) {
+    return (deck >= 1 && deck <= kMaxDecks) ? deckWaveforms[deck - 1].get() : nullptr;
+}
+
+static bool copyReading(const LevelMeter* meter, float* out) {
+    if (!meter || !out) return false;
+    MeterReading reading = meter->getReading();
+    memcpy(out, &reading, sizeof(reading));
+    return true;
+}
+
+// Odd-numbered decks sit on the crossfader's left side and even-numbered ones
+// on its right; sample slots bypass it
+static float crossfaderGain(int deck) {
+    if (isSampleSlot(deck - 1)) return 1.0f;
+    if (deck % 2 == 1) {
+        return (crossfaderValue <= 0.0f) ? 1.0f : (1.0f - crossfaderValue);
+    }
+    return (crossfaderValue >= 0.0f) ? 1.0f : (1.0f + crossfaderValue);
+}
+
+// Run one deck's chain, crossfader gain and meter, or write silence if it is
+// idle; outputs may be null for an idle deck
+static void processDeck(int deck, bool active,
+                        float* inputLeft, float* inputRight,
+                        float* outputLeft, float* outputRight, int numSamples) {
+    AudioProcessor* processor = processorFor(deck);
+    LevelMeter* meter = meterFor(deck);
+    if (active && processor && inputLeft && outputLeft) {
+        processor->processStereo(inputLeft, inputRight, outputLeft, outputRight, numSamples);
+        
+        float gain = crossfaderGain(deck);
+        for (int i = 0; i < numSamples; i++) {
+            outputLeft[i] *= gain;
+            outputRight[i] *= gain;
+        }
+        if (meter) meter->process(outputLeft, outputRight, numSamples);
+    } else {
+        if (outputLeft) {
+            for (int i = 0; i < numSamples; i++) {
+                outputLeft[i] = 0.0f;
+                outputRight[i] = 0.0f;
+            }
+        }
+        if (meter) meter->processSilence(numSamples);
+    }
+}
+
 // Initialize processors
 extern "C" {
     EMSCRIPTEN_KEEPALIVE
     void init_processors(int sampleRate) {
         currentSampleRate = sampleRate;
-        deck1Processor = std::make_unique<AudioProcessor>(sampleRate);
-        deck2Processor = std::make_unique<AudioProcessor>(sampleRate);
+        for (int deck = 0; deck < kMaxDecks; deck++) {
+            deckProcessors[deck] = std::make_unique<AudioProcessor>(sampleRate);
+            deckStretchers[deck] = std::make_unique<TimeStretcher>(sampleRate, kMaxStretchBlock, 2.0f);
+            deckMeters[deck] = std::make_unique<LevelMeter>(sampleRate, kMeterBlock);
+        }
+        masterMeter = std::make_unique<LevelMeter>(sampleRate, kMeterBlock);
     }
     
-    // Deck 1 controls
     EMSCRIPTEN_KEEPALIVE
-    void set_deck1_volume(float volume) {
-        if (deck1Processor) {
-            deck1Processor->setVolume(volume);
-        }
+    int get_deck_count() {
+        return kMaxDecks;
     }
     
+    // Deck controls; decks are numbered 1..get_deck_count()
     EMSCRIPTEN_KEEPALIVE
-    void set_deck1_pitch(float pitch) {
-        if (deck1Processor) {
-            deck1Processor->setPitch(pitch);
+    void set_deck_volume(int deck, float volume) {
+        if (AudioProcessor* processor = processorFor(deck)) {
+            processor->setVolume(volume);
         }
     }
     
     EMSCRIPTEN_KEEPALIVE
-    void set_deck1_eq(int band, float value) {
-        if (deck1Processor) {
-            deck1Processor->setEQ(band, value);
+    void set_deck_pitch(int deck, float pitch) {
+        if (AudioProcessor* processor = processorFor(deck)) {
+            processor->setPitch(pitch);
         }
     }
     
     EMSCRIPTEN_KEEPALIVE
-    void set_deck1_effect(int effect, bool enabled) {
-        if (deck1Processor) {
-            deck1Processor->setEffect(effect, enabled);
+    void set_deck_eq(int deck, int band, float value) {
+        if (AudioProcessor* processor = processorFor(deck)) {
+            processor->setEQ(band, value);
         }
     }
     
-    // Deck 2 controls
     EMSCRIPTEN_KEEPALIVE
-    void set_deck2_volume(float volume) {
-        if (deck2Processor) {
-            deck2Processor->setVolume(volume);
+    void set_deck_effect(int deck, int effect, bool enabled) {
+        if (AudioProcessor* processor = processorFor(deck)) {
+            processor->setEffect(effect, enabled);
         }
     }
     
+    // Two-deck setters kept for worklets and prebuilt modules that predate
+    // the deck-indexed ones
+    EMSCRIPTEN_KEEPALIVE
+    void set_deck1_volume(float volume) { set_deck_volume(1, volume); }
+    
+    EMSCRIPTEN_KEEPALIVE
+    void set_deck1_pitch(float pitch) { set_deck_pitch(1, pitch); }
+    
+    EMSCRIPTEN_KEEPALIVE
+    void set_deck1_eq(int band, float value) { set_deck_eq(1, band, value); }
+    
+    EMSCRIPTEN_KEEPALIVE
+    void set_deck1_effect(int effect, bool enabled) { set_deck_effect(1, effect, enabled); }
+    
+    EMSCRIPTEN_KEEPALIVE
+    void set_deck2_volume(float volume) { set_deck_volume(2, volume); }
+    
+    EMSCRIPTEN_KEEPALIVE
+    void set_deck2_pitch(float pitch) { set_deck_pitch(2, pitch); }
+    
+    EMSCRIPTEN_KEEPALIVE
+    void set_deck2_eq(int band, float value) { set_deck_eq(2, band, value); }
+    
     EMSCRIPTEN_KEEPALIVE
-    void set_deck2_pitch(float pitch) {
-        if (deck2Processor) {
-            deck2Processor->setPitch(pitch);
+    void set_deck2_effect(int effect, bool enabled) { set_deck_effect(2, effect, enabled); }
+    
+    // Key-lock: tempo is source frames per output frame (2^pitch)
+    EMSCRIPTEN_KEEPALIVE
+    void set_deck_tempo(int deck, float tempo) {
+        TimeStretcher* stretcher = stretcherFor(deck);
+        if (stretcher) {
+            stretcher->setTempo(tempo);
         }
     }
     
     EMSCRIPTEN_KEEPALIVE
-    void set_deck2_eq(int band, float value) {
-        if (deck2Processor) {
-            deck2Processor->setEQ(band, value);
+    void reset_deck_stretch(int deck) {
+        TimeStretcher* stretcher = stretcherFor(deck);
+        if (stretcher) {
+            stretcher->reset();
         }
     }
     
+    // Source frames the caller should pass to stretch_deck_audio for
+    // numSamples output frames
+    EMSCRIPTEN_KEEPALIVE
+    int get_stretch_input_frames(int deck, int numSamples) {
+        TimeStretcher* stretcher = stretcherFor(deck);
+        return stretcher ? stretcher->inputWanted(numSamples) : 0;
+    }
+    
+    // Time-stretch inputFrames source frames into numSamples output frames
+    // (at most 4096); returns the number of frames actually produced
     EMSCRIPTEN_KEEPALIVE
-    void set_deck2_effect(int effect, bool enabled) {
-        if (deck2Processor) {
-            deck2Processor->setEffect(effect, enabled);
+    int stretch_deck_audio(
+        int deck,
+        float* inputLeft, float* inputRight, int inputFrames,
+        float* outputLeft, float* outputRight, int numSamples
+    ) {
+        TimeStretcher* stretcher = stretcherFor(deck);
+        if (!stretcher) return 0;
+        if (inputFrames > 0) {
+            stretcher->write(inputLeft, inputRight, inputFrames);
         }
+        return stretcher->process(outputLeft, outputRight, numSamples);
     }
     
     // Global controls
@@ -89,10 +212,42 @@ extern "C" {
         masterVolume = volume;
     }
     
-    // Main processing function
-    // Input: pointers to float arrays in Wasm memory
-    // deck1Input, deck1Output, deck2Input, deck2Output are pointers to float arrays
-    // numSamples is the number of samples per channel
+    // Process and mix every deck. `buffers` holds numSamples frames of left
+    // then right input for each deck in turn (get_deck_count() pairs), and is
+    // processed in place; bit n of activeMask enables deck n + 1. The mix,
+    // scaled by the master volume, goes to outputLeft/outputRight.
+    EMSCRIPTEN_KEEPALIVE
+    void process_decks(float* buffers, int numSamples, int activeMask,
+                       float* outputLeft, float* outputRight) {
+        for (int i = 0; i < numSamples; i++) {
+            outputLeft[i] = 0.0f;
+            outputRight[i] = 0.0f;
+        }
+        
+        for (int deck = 1; deck <= kMaxDecks; deck++) {
+            if (!(activeMask & (1 << (deck - 1)))) {
+                processDeck(deck, false, nullptr, nullptr, nullptr, nullptr, numSamples);
+                continue;
+            }
+            
+            float* left = buffers + static_cast<size_t>(deck - 1) * 2 * numSamples;
+            float* right = left + numSamples;
+            processDeck(deck, true, left, right, left, right, numSamples);
+            for (int i = 0; i < numSamples; i++) {
+                outputLeft[i] += left[i];
+                outputRight[i] += right[i];
+            }
+        }
+        
+        for (int i = 0; i < numSamples; i++) {
+            outputLeft[i] *= masterVolume;
+            outputRight[i] *= masterVolume;
+        }
+        if (masterMeter) masterMeter->process(outputLeft, outputRight, numSamples);
+    }
+    
+    // Two-deck entry point used by the audio worklet: decks 1 and 2 are
+    // processed into their own outputs, then mixed into deck 1's output
     EMSCRIPTEN_KEEPALIVE
     void process_deck_audio(
         float* deck1InputLeft, float* deck1InputRight,
@@ -103,49 +258,10 @@ extern "C" {
         bool deck1Active,
         bool deck2Active
     ) {
-        // Process deck 1
-        if (deck1Active && deck1Processor && deck1InputLeft && deck1OutputLeft) {
-            deck1Processor->processStereo(
-                deck1InputLeft, deck1InputRight,
-                deck1OutputLeft, deck1OutputRight,
-                numSamples
-            );
-            
-            // Apply crossfader to deck 1
-            float deck1Gain = (crossfaderValue <= 0.0f) ? 1.0f : (1.0f - crossfaderValue);
-            for (int i = 0; i < numSamples; i++) {
-                deck1OutputLeft[i] *= deck1Gain;
-                deck1OutputRight[i] *= deck1Gain;
-            }
-        } else if (deck1OutputLeft) {
-            // Clear output if deck not active
-            for (int i = 0; i < numSamples; i++) {
-                deck1OutputLeft[i] = 0.0f;
-                deck1OutputRight[i] = 0.0f;
-            }
-        }
-        
-        // Process deck 2
-        if (deck2Active && deck2Processor && deck2InputLeft && deck2OutputLeft) {
-            deck2Processor->processStereo(
-                deck2InputLeft, deck2InputRight,
-                deck2OutputLeft, deck2OutputRight,
-                numSamples
-            );
-            
-            // Apply crossfader to deck 2
-            float deck2Gain = (crossfaderValue >= 0.0f) ? 1.0f : (1.0f + crossfaderValue);
-            for (int i = 0; i < numSamples; i++) {
-                deck2OutputLeft[i] *= deck2Gain;
-                deck2OutputRight[i] *= deck2Gain;
-            }
-        } else if (deck2OutputLeft) {
-            // Clear output if deck not active
-            for (int i = 0; i < numSamples; i++) {
-                deck2OutputLeft[i] = 0.0f;
-                deck2OutputRight[i] = 0.0f;
-            }
-        }
+        processDeck(1, deck1Active, deck1InputLeft, deck1InputRight,
+                    deck1OutputLeft, deck1OutputRight, numSamples);
+        processDeck(2, deck2Active, deck2InputLeft, deck2InputRight,
+                    deck2OutputLeft, deck2OutputRight, numSamples);
         
         // Mix decks and apply master volume
         if (deck1OutputLeft && deck2OutputLeft) {
@@ -153,7 +269,84 @@ extern "C" {
                 deck1OutputLeft[i] = (deck1OutputLeft[i] + deck2OutputLeft[i]) * masterVolume;
                 deck1OutputRight[i] = (deck1OutputRight[i] + deck2OutputRight[i]) * masterVolume;
             }
+            if (masterMeter) masterMeter->process(deck1OutputLeft, deck1OutputRight, numSamples);
         }
     }
+    
+    // Meter readings as nine floats, laid out like MeterReading: peak L/R,
+    // true peak L/R, RMS L/R (linear), momentary and short-term loudness
+    // (LUFS), then the highest true peak since clear_clip_indicators().
+    // Returns false for an unknown deck or before init_processors.
+    EMSCRIPTEN_KEEPALIVE
+    bool get_deck_meter(int deck, float* out) {
+        return copyReading(meterFor(deck), out);
+    }
+    
+    EMSCRIPTEN_KEEPALIVE
+    bool get_master_meter(float* out) {
+        return copyReading(masterMeter.get(), out);
+    }
+    
+    // Build a deck's waveform overview from its decoded track (single
+    // threaded here); the PCM isn't needed afterwards. Levels hold one point
+    // per 64, 128, ... 65536 frames. Not used by the UI yet: AudioWaveform
+    // still scans getChannelData, and public/audio_processor.wasm predates
+    // these exports.
+    EMSCRIPTEN_KEEPALIVE
+    bool build_deck_waveform(int deck, float* left, float* right, int frames, int sampleRate) {
+        if (deck < 1 || deck > kMaxDecks || !left || !right || frames <= 0) return false;
+        if (!deckWaveforms[deck - 1]) {
+            deckWaveforms[deck - 1] = std::make_unique<WaveformPyramid>();
+        }
+        deckWaveforms[deck - 1]->build(left, right, frames, sampleRate, 1);
+        return true;
+    }
+    
+    EMSCRIPTEN_KEEPALIVE
+    int get_waveform_point_count(int deck, int samplesPerPoint) {
+        WaveformPyramid* waveform = waveformFor(deck);
+        if (!waveform || waveform->empty()) return 0;
+        return static_cast<int>(waveform->pointCount(waveform->levelFor(samplesPerPoint)));
+    }
+    
+    // Copy up to `count` 6-byte points (min, max as int8; rms, low, mid, high
+    // as uint8) from point `first`; returns how many were copied
+    EMSCRIPTEN_KEEPALIVE
+    int get_waveform_points(int deck, int samplesPerPoint, int first, int count, WaveformPoint* out) {
+        WaveformPyramid* waveform = waveformFor(deck);
+        if (!waveform || !out || first < 0 || count <= 0) return 0;
+        return static_cast<int>(waveform->copyPoints(samplesPerPoint, first, count, out));
+    }
+    
+    // Tempo and beatgrid of a decoded track, in its frames. `out` receives a
+    // BeatGrid: bpm, confidence, firstBeat and beatLength as doubles, then
+    // beatCount and firstDownbeat as int32 (40 bytes). Returns false if no
+    // steady pulse was found.
+    EMSCRIPTEN_KEEPALIVE
+    bool analyze_beats(float* left, float* right, int frames, int sampleRate, BeatGrid* out) {
+        if (!left || !right || frames <= 0 || !out) return false;
+        BeatAnalyzer analyzer;
+        analyzer.setSource(left, right, frames, sampleRate);
+        return analyzer.analyze(*out);
+    }
+    
+    // Key of a decoded track. `out` receives a KeyEstimate: key (0..11 major,
+    // 12..23 minor) and Camelot number as int32, confidence as float, then
+    // the key name (6 bytes) and Camelot code (4 bytes) as NUL-terminated
+    // strings (24 bytes in all). Returns false if no key was found.
+    EMSCRIPTEN_KEEPALIVE
+    bool detect_key(float* left, float* right, int frames, int sampleRate, KeyEstimate* out) {
+        if (!left || !right || frames <= 0 || !out) return false;
+        KeyDetector detector;
+        detector.setSource(left, right, frames, sampleRate);
+        return detector.analyze(*out);
+    }
+    
+    EMSCRIPTEN_KEEPALIVE
+    void clear_clip_indicators() {
+        for (int deck = 1; deck <= kMaxDecks; deck++) {
+            if (LevelMeter* meter = meterFor(deck)) meter->clearMaxTruePeak();
+        }
+        if (masterMeter) masterMeter->clearMaxTruePeak();
+    }
 }
-
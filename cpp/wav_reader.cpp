@@ -0,0 +1,179 @@
+#include "wav_reader.h"
+#include <algorithm>
+#include <cstring>
+
+#include "sample_page_cache.h"
+
+static const uint16_t kFormatPcm = 0x0001;
+static const uint16_t kFormatIeeeFloat = 0x0003;
+static const uint16_t kFormatExtensible = 0xFFFE;
+
+static uint16_t readU16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t readU32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static bool resolveSampleFormat(WavInfo& info, std::string& error) {
+    if (info.formatTag == kFormatPcm) {
+        switch (info.bitsPerSample) {
+            case 16: info.sampleFormat = SampleFormat::Int16; return true;
+            case 24: info.sampleFormat = SampleFormat::Int24; return true;
+            case 32: info.sampleFormat = SampleFormat::Int32; return true;
+        }
+    } else if (info.formatTag == kFormatIeeeFloat && info.bitsPerSample == 32) {
+        info.sampleFormat = SampleFormat::Float32;
+        return true;
+    }
+    
+    error = "Unsupported WAV encoding (format " + std::to_string(info.formatTag) +
+            ", " + std::to_string(info.bitsPerSample) + " bits)";
+    return false;
+}
+
+bool parseWavHeader(const uint8_t* data, size_t size, WavInfo& info, std::string& error) {
+    if (size < 12 || memcmp(data, "RIFF", 4) != 0) {
+        error = "Not a valid WAV file (missing RIFF header)";
+        return false;
+    }
+    if (memcmp(data + 8, "WAVE", 4) != 0) {
+        error = "Not a valid WAV file (missing WAVE format)";
+        return false;
+    }
+    
+    bool haveFormat = false;
+    bool haveData = false;
+    size_t offset = 12;
+    
+    while (offset + 8 <= size && !(haveFormat && haveData)) {
+        const uint8_t* chunk = data + offset;
+        uint32_t chunkSize = readU32(chunk + 4);
+        size_t body = offset + 8;
+        size_t available = size - body;
+        
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            if (chunkSize < 16 || available < 16) {
+                error = "Truncated fmt chunk";
+                return false;
+            }
+            const uint8_t* fmt = data + body;
+            info.formatTag = readU16(fmt);
+            info.channels = readU16(fmt + 2);
+            info.sampleRate = readU32(fmt + 4);
+            info.blockAlign = readU16(fmt + 12);
+            info.bitsPerSample = readU16(fmt + 14);
+            
+            // The real format lives in the first two bytes of the subformat GUID
+            if (info.formatTag == kFormatExtensible && chunkSize >= 40 && available >= 40) {
+                info.formatTag = readU16(fmt + 24);
+            }
+            haveFormat = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            info.dataOffset = body;
+            // Files still being recorded often carry a placeholder size
+            info.dataSize = std::min<size_t>(chunkSize, available);
+            haveData = true;
+        }
+        
+        // Chunks are word aligned: odd sizes are followed by a pad byte
+        offset = body + chunkSize + (chunkSize & 1);
+    }
+    
+    if (!haveFormat) {
+        error = "No fmt chunk found in WAV file";
+        return false;
+    }
+    if (!haveData) {
+        error = "No data chunk found in WAV file";
+        return false;
+    }
+    if (info.channels == 0 || info.sampleRate == 0) {
+        error = "Invalid WAV format (no channels or sample rate)";
+        return false;
+    }
+    if (!resolveSampleFormat(info, error)) {
+        return false;
+    }
+    if (info.blockAlign < info.channels * bytesPerSample(info.sampleFormat)) {
+        error = "Invalid WAV block alignment";
+        return false;
+    }
+    return true;
+}
+
+bool readWavFile(const std::string& filepath, AudioFile& audioFile, SampleStorage storage,
+                 int decodeThreads, std::string& error, std::atomic<float>* progress,
+                 SamplePageCache* pageCache) {
+    std::shared_ptr<MappedFile> mapping = std::make_shared<MappedFile>();
+    if (!mapping->open(filepath)) {
+        error = "Failed to open file: " + filepath;
+        return false;
+    }
+    
+    WavInfo info;
+    if (!parseWavHeader(mapping->data(), mapping->size(), info, error)) {
+        return false;
+    }
+    
+    audioFile.sampleRate = info.sampleRate;
+    audioFile.channels = info.channels;
+    audioFile.sampleFormat = info.sampleFormat;
+    audioFile.frameStride = info.blockAlign;
+    audioFile.frameCount = info.frameCount();
+    audioFile.duration = static_cast<float>(audioFile.frameCount) / info.sampleRate;
+    
+    const uint8_t* pcm = mapping->data() + info.dataOffset;
+    size_t total = audioFile.frameCount;
+    // Slices so progress can be reported between them
+    size_t slice = std::max<size_t>(total / 16, 1 << 20);
+    
+    if (storage == SampleStorage::Mapped) {
+        audioFile.mapping = mapping;
+        audioFile.pcmData = pcm;
+    } else if (storage == SampleStorage::Paged) {
+        if (!pageCache) {
+            error = "No page cache for paged loading";
+            return false;
+        }
+        audioFile.paged = pageCache->open(filepath, info.dataOffset, info.sampleFormat, info.channels,
+                                          info.blockAlign, total, error);
+        if (!audioFile.paged) return false;
+    } else if (storage == SampleStorage::Compact) {
+        int channels = std::min<int>(info.channels, 2);
+        size_t stride = channels * bytesPerSample(info.sampleFormat);
+        std::shared_ptr<std::vector<uint8_t>> packed = std::make_shared<std::vector<uint8_t>>(total * stride);
+        for (size_t start = 0; start < total; start += slice) {
+            size_t count = std::min(slice, total - start);
+            const uint8_t* src = pcm + start * info.blockAlign;
+            uint8_t* dst = packed->data() + start * stride;
+            if (stride == info.blockAlign) {
+                memcpy(dst, src, count * stride);
+            } else {
+                for (size_t i = 0; i < count; i++) {
+                    memcpy(dst + i * stride, src + i * info.blockAlign, stride);
+                }
+            }
+            if (progress) progress->store(static_cast<float>(start + count) / total);
+        }
+        audioFile.packedPcm = packed;
+        audioFile.pcmData = packed->data();
+        audioFile.channels = channels;
+        audioFile.frameStride = stride;
+    } else {
+        audioFile.leftChannel.resize(total);
+        audioFile.rightChannel.resize(total);
+        for (size_t start = 0; start < total; start += slice) {
+            size_t count = std::min(slice, total - start);
+            convertToFloatParallel(pcm + start * info.blockAlign, info.sampleFormat, info.channels,
+                                   info.blockAlign, count, audioFile.leftChannel.data() + start,
+                                   audioFile.rightChannel.data() + start, decodeThreads);
+            if (progress) progress->store(static_cast<float>(start + count) / total);
+        }
+    }
+    
+    audioFile.loaded = true;
+    return true;
+}
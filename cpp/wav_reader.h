@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "audio_file.h"
+#include "pcm_convert.h"
+
+// Layout of a WAV file as described by its fmt and data chunks
+struct WavInfo {
+    uint16_t formatTag;      // After resolving WAVE_FORMAT_EXTENSIBLE
+    uint16_t channels;
+    uint32_t sampleRate;
+    uint16_t blockAlign;
+    uint16_t bitsPerSample;
+    SampleFormat sampleFormat;
+    size_t dataOffset;       // From the start of the file
+    size_t dataSize;         // Clamped to the bytes actually present
+    
+    WavInfo()
+        : formatTag(0), channels(0), sampleRate(0), blockAlign(0), bitsPerSample(0)
+        , sampleFormat(SampleFormat::Int16), dataOffset(0), dataSize(0) {}
+    
+    size_t frameCount() const { return blockAlign ? dataSize / blockAlign : 0; }
+};
+
+// Walk the RIFF chunk list of an in-memory WAV file. Unknown chunks (LIST,
+// bext, fact, ...) are skipped, odd-sized chunks honour the RIFF pad byte, and
+// WAVE_FORMAT_EXTENSIBLE is resolved to its PCM or IEEE float subformat.
+bool parseWavHeader(const uint8_t* data, size_t size, WavInfo& info, std::string& error);
+
+class SamplePageCache;
+
+// Map a WAV file and fill `audioFile` with its samples stored as `storage`
+// says. Mapped keeps the mapping for the deck to read in place. Compact
+// copies the PCM out, without padding or channels past the second; Float
+// converts every frame up front using `decodeThreads` threads (0 = all
+// cores). Paged needs `pageCache` and only reads the header now. `progress`,
+// if given, is advanced from 0 to 1 while samples are copied or converted.
+bool readWavFile(const std::string& filepath, AudioFile& audioFile, SampleStorage storage,
+                 int decodeThreads, std::string& error, std::atomic<float>* progress = nullptr,
+                 SamplePageCache* pageCache = nullptr);
@@ -0,0 +1,205 @@
+#include "waveform.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include "audio_processor.h"
+
+// Running sums for one point, kept in float until the level is quantised so
+// coarser levels are reduced from exact values
+struct PointSums {
+    float min;
+    float max;
+    float squares; // sums of squares: whole signal, then each band
+    float low;
+    float mid;
+    float high;
+    uint32_t frames;
+};
+
+static const PointSums kEmptySums = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0};
+
+static PointSums mergeSums(const PointSums& a, const PointSums& b) {
+    PointSums sums;
+    sums.min = std::min(a.min, b.min);
+    sums.max = std::max(a.max, b.max);
+    sums.squares = a.squares + b.squares;
+    sums.low = a.low + b.low;
+    sums.mid = a.mid + b.mid;
+    sums.high = a.high + b.high;
+    sums.frames = a.frames + b.frames;
+    return sums;
+}
+
+static int8_t quantiseSigned(float value) {
+    return static_cast<int8_t>(std::lrint(std::min(std::max(value, -1.0f), 1.0f) * 127.0f));
+}
+
+static uint8_t quantiseLevel(float sumOfSquares, float frames) {
+    return static_cast<uint8_t>(std::lrint(std::min(std::sqrt(sumOfSquares / frames), 1.0f) * 255.0f));
+}
+
+static WaveformPoint quantisePoint(const PointSums& sums) {
+    float frames = static_cast<float>(std::max<uint32_t>(sums.frames, 1));
+    WaveformPoint point;
+    point.min = quantiseSigned(sums.min);
+    point.max = quantiseSigned(sums.max);
+    point.rms = quantiseLevel(sums.squares, frames);
+    point.low = quantiseLevel(sums.low, frames);
+    point.mid = quantiseLevel(sums.mid, frames);
+    point.high = quantiseLevel(sums.high, frames);
+    return point;
+}
+
+// Scan frames [start, end) into finest-level points. `start` is a multiple of
+// kMinSamplesPerPoint, so only the range holding the end of the track can
+// finish with a partial point. The band filters are run over the frames just
+// before `start` first, so a range split across threads has no seam.
+static void scanRange(const WaveformPyramid::FrameReader& read, size_t start, size_t end,
+                      int sampleRate, PointSums* out) {
+    const size_t blockFrames = 4096;
+    const size_t warmupFrames = 4096;
+    const uint32_t pointFrames = WaveformPyramid::kMinSamplesPerPoint;
+
+    // Butterworth sections; the mid band is a highpass and lowpass in series
+    BiquadFilter lowBand;
+    BiquadFilter midLowCut;
+    BiquadFilter midHighCut;
+    BiquadFilter highBand;
+    lowBand.setLowpass(200.0f, 0.7071f, static_cast<float>(sampleRate));
+    midLowCut.setHighpass(200.0f, 0.7071f, static_cast<float>(sampleRate));
+    midHighCut.setLowpass(2000.0f, 0.7071f, static_cast<float>(sampleRate));
+    highBand.setHighpass(2000.0f, 0.7071f, static_cast<float>(sampleRate));
+
+    std::vector<float> left(blockFrames);
+    std::vector<float> right(blockFrames);
+
+    for (size_t pos = (start > warmupFrames) ? start - warmupFrames : 0; pos < start; ) {
+        size_t count = std::min(blockFrames, start - pos);
+        read(pos, count, left.data(), right.data());
+        for (size_t i = 0; i < count; i++) {
+            float mono = (left[i] + right[i]) * 0.5f;
+            lowBand.process(mono);
+            midHighCut.process(midLowCut.process(mono));
+            highBand.process(mono);
+        }
+        pos += count;
+    }
+
+    PointSums current = kEmptySums;
+    for (size_t pos = start; pos < end; ) {
+        size_t count = std::min(blockFrames, end - pos);
+        read(pos, count, left.data(), right.data());
+        for (size_t i = 0; i < count; i++) {
+            float mono = (left[i] + right[i]) * 0.5f;
+            float low = lowBand.process(mono);
+            float mid = midHighCut.process(midLowCut.process(mono));
+            float high = highBand.process(mono);
+
+            if (current.frames == 0) {
+                current.min = current.max = mono;
+            } else {
+                current.min = std::min(current.min, mono);
+                current.max = std::max(current.max, mono);
+            }
+            current.squares += mono * mono;
+            current.low += low * low;
+            current.mid += mid * mid;
+            current.high += high * high;
+
+            if (++current.frames == pointFrames) {
+                *out++ = current;
+                current = kEmptySums;
+            }
+        }
+        pos += count;
+    }
+    if (current.frames > 0) {
+        *out = current;
+    }
+}
+
+WaveformPyramid::WaveformPyramid() : frame_count_(0) {
+}
+
+void WaveformPyramid::build(const float* left, const float* right, size_t frames, int sampleRate,
+                            int threadCount) {
+    buildFrom(frames, sampleRate, threadCount,
+              [left, right](size_t start, size_t count, float* outLeft, float* outRight) {
+                  memcpy(outLeft, left + start, count * sizeof(float));
+                  memcpy(outRight, right + start, count * sizeof(float));
+              });
+}
+
+void WaveformPyramid::buildFrom(size_t frames, int sampleRate, int threadCount, const FrameReader& read) {
+    // Below this a thread costs more to start than it saves
+    const size_t minFramesPerThread = 1 << 18;
+
+    frame_count_ = frames;
+    for (std::vector<WaveformPoint>& level : levels_) {
+        level.clear();
+    }
+    if (frames == 0) return;
+
+    std::vector<PointSums> sums((frames + kMinSamplesPerPoint - 1) / kMinSamplesPerPoint);
+
+    size_t threads = (threadCount > 0) ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+    size_t chunks = std::min(threads, std::max<size_t>(1, frames / minFramesPerThread));
+    size_t perChunk = ((frames + chunks - 1) / chunks + kMinSamplesPerPoint - 1) & ~static_cast<size_t>(kMinSamplesPerPoint - 1);
+
+    std::vector<std::thread> workers;
+    for (size_t start = perChunk; start < frames; start += perChunk) {
+        size_t end = std::min(start + perChunk, frames);
+        workers.emplace_back(scanRange, std::cref(read), start, end, sampleRate,
+                             sums.data() + start / kMinSamplesPerPoint);
+    }
+    scanRange(read, 0, std::min(perChunk, frames), sampleRate, sums.data());
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    // Quantise each level, then halve it for the next
+    for (int level = 0; level < kLevels; level++) {
+        levels_[level].resize(sums.size());
+        std::transform(sums.begin(), sums.end(), levels_[level].begin(), quantisePoint);
+        if (level + 1 == kLevels) break;
+
+        size_t half = (sums.size() + 1) / 2;
+        for (size_t i = 0; i < half; i++) {
+            sums[i] = (i * 2 + 1 < sums.size()) ? mergeSums(sums[i * 2], sums[i * 2 + 1]) : sums[i * 2];
+        }
+        sums.resize(half);
+    }
+}
+
+void WaveformPyramid::restore(size_t frames, const WaveformPoint* const levels[kLevels],
+                              const size_t counts[kLevels]) {
+    frame_count_ = frames;
+    for (int level = 0; level < kLevels; level++) {
+        levels_[level].assign(levels[level], levels[level] + counts[level]);
+    }
+}
+
+int WaveformPyramid::levelFor(int samplesPerPoint) const {
+    double ratio = static_cast<double>(std::max(samplesPerPoint, 1)) / kMinSamplesPerPoint;
+    long level = std::lround(std::log2(ratio));
+    return static_cast<int>(std::min<long>(std::max<long>(level, 0), kLevels - 1));
+}
+
+size_t WaveformPyramid::copyPoints(int samplesPerPoint, size_t first, size_t count, WaveformPoint* out) const {
+    const std::vector<WaveformPoint>& level = levels_[levelFor(samplesPerPoint)];
+    if (first >= level.size()) return 0;
+    count = std::min(count, level.size() - first);
+    memcpy(out, level.data() + first, count * sizeof(WaveformPoint));
+    return count;
+}
+
+size_t WaveformPyramid::byteSize() const {
+    size_t bytes = 0;
+    for (const std::vector<WaveformPoint>& level : levels_) {
+        bytes += level.size() * sizeof(WaveformPoint);
+    }
+    return bytes;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "audio_file.h"
+
+// One waveform column. Amplitudes are of the mono mix (L + R) / 2, scaled so
+// 127 (signed) or 255 (unsigned) is full scale; the band values are the RMS
+// of the signal below 200 Hz, between 200 Hz and 2 kHz and above 2 kHz, for
+// colouring. Six bytes with no padding, so JS can read a buffer of them with
+// a plain Uint8Array.
+struct WaveformPoint {
+    int8_t min;
+    int8_t max;
+    uint8_t rms;
+    uint8_t low;
+    uint8_t mid;
+    uint8_t high;
+};
+
+static_assert(sizeof(WaveformPoint) == 6, "WaveformPoint must stay packed");
+
+// Min/max/RMS mipmap of a whole track, built once at load so drawing and
+// zooming never touch the PCM again. Level 0 has one point per
+// kMinSamplesPerPoint frames and each level above halves the resolution,
+// up to kMaxSamplesPerPoint.
+class WaveformPyramid {
+public:
+    static const int kMinSamplesPerPoint = 64;
+    static const int kMaxSamplesPerPoint = 65536;
+    static const int kLevels = 11;
+
+    // Reads `count` frames starting at `start` into left/right
+    typedef std::function<void(size_t start, size_t count, float* left, float* right)> FrameReader;
+
+    WaveformPyramid();
+
+    // Scan a track (decoded or mapped). The finest level is split across up
+    // to `threadCount` threads (0 uses every hardware thread); the rest is
+    // reduced from it.
+    void build(const AudioFile& track, int threadCount = 0) {
+        buildFrom(track.frameCount, track.sampleRate, threadCount,
+                  [&track](size_t start, size_t count, float* left, float* right) {
+                      track.readFrames(start, count, left, right);
+                  });
+    }
+    void build(const float* left, const float* right, size_t frames, int sampleRate, int threadCount = 0);
+    // Scan on the calling thread from a reader that must be called in order,
+    // such as a decoder
+    void build(size_t frames, int sampleRate, const FrameReader& read) {
+        buildFrom(frames, sampleRate, 1, read);
+    }
+
+    // Take saved levels back, as read from points() and pointCount()
+    void restore(size_t frames, const WaveformPoint* const levels[kLevels], const size_t counts[kLevels]);
+
+    bool empty() const { return frame_count_ == 0; }
+    size_t frameCount() const { return frame_count_; }
+
+    // Level whose resolution is closest to samplesPerPoint, clamped to the range
+    int levelFor(int samplesPerPoint) const;
+    int samplesPerPoint(int level) const { return kMinSamplesPerPoint << level; }
+    size_t pointCount(int level) const { return levels_[level].size(); }
+    const WaveformPoint* points(int level) const { return levels_[level].data(); }
+
+    // Copy up to `count` points from `first` at the level for samplesPerPoint;
+    // returns how many were copied
+    size_t copyPoints(int samplesPerPoint, size_t first, size_t count, WaveformPoint* out) const;
+
+    // Bytes held by all levels
+    size_t byteSize() const;
+
+private:
+    void buildFrom(size_t frames, int sampleRate, int threadCount, const FrameReader& read);
+
+    size_t frame_count_;
+    std::vector<WaveformPoint> levels_[kLevels];
+};
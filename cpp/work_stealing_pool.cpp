@@ -0,0 +1,127 @@
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+
+// Which pool and worker the calling thread belongs to, if any
+static thread_local const WorkStealingPool* tls_pool = nullptr;
+static thread_local int tls_worker = -1;
+
+WorkStealingPool::WorkStealingPool()
+    : queued_(0), unfinished_(0), next_worker_(0), stopping_(false) {
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    stop();
+}
+
+void WorkStealingPool::start(int threadCount) {
+    if (isRunning()) return;
+    if (threadCount <= 0) {
+        threadCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+
+    stopping_ = false;
+    // Every deque exists before any worker may try to steal from it
+    for (int i = 0; i < threadCount; i++) {
+        workers_.emplace_back(new Worker());
+    }
+    for (int i = 0; i < threadCount; i++) {
+        workers_[i]->thread = std::thread(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+void WorkStealingPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+
+    for (std::unique_ptr<Worker>& worker : workers_) {
+        worker->thread.join();
+    }
+    size_t dropped = 0;
+    for (std::unique_ptr<Worker>& worker : workers_) {
+        dropped += worker->jobs.size();
+    }
+    workers_.clear();
+
+    queued_.store(0);
+    if (unfinished_.fetch_sub(dropped) == dropped) {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        idle_.notify_all();
+    }
+}
+
+bool WorkStealingPool::submit(std::function<void()> job) {
+    if (workers_.empty() || stopping_.load()) return false;
+
+    // A worker keeps what it spawns; anyone else deals jobs out in turn
+    int index = tls_pool == this ? tls_worker
+                                 : static_cast<int>(next_worker_.fetch_add(1) % workers_.size());
+    unfinished_.fetch_add(1);
+    {
+        Worker& worker = *workers_[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.jobs.push_back(std::move(job));
+        queued_.fetch_add(1);
+    }
+
+    // Taking the lock orders this wake against a worker checking queued_
+    // just before it sleeps
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+    }
+    wake_.notify_one();
+    return true;
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    idle_.wait(lock, [this] { return unfinished_.load() == 0; });
+}
+
+// Newest job of our own deque, else the oldest of the first other worker
+// that has one
+bool WorkStealingPool::takeJob(int index, std::function<void()>& job) {
+    int count = static_cast<int>(workers_.size());
+    for (int i = 0; i < count; i++) {
+        Worker& worker = *workers_[(index + i) % count];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.jobs.empty()) continue;
+        if (i == 0) {
+            job = std::move(worker.jobs.back());
+            worker.jobs.pop_back();
+        } else {
+            job = std::move(worker.jobs.front());
+            worker.jobs.pop_front();
+        }
+        queued_.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::finishJob() {
+    if (unfinished_.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        idle_.notify_all();
+    }
+}
+
+void WorkStealingPool::workerLoop(int index) {
+    tls_pool = this;
+    tls_worker = index;
+    while (!stopping_.load()) {
+        std::function<void()> job;
+        if (takeJob(index, job)) {
+            job();
+            job = nullptr; // Release captures before the batch counts as done
+            finishJob();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        wake_.wait(lock, [this] { return stopping_.load() || queued_.load() > 0; });
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool of worker threads for batches of jobs that spawn more jobs, such as
+// analysing a library file by file with each file split into passes. Every
+// worker has its own deque: jobs submitted from a worker go on the back of
+// that worker's deque and it takes its own work from the back (newest first,
+// while the data it touches is still warm). An idle worker steals from the
+// front of another's deque, taking the oldest and usually largest job, so
+// load evens out without a shared queue every thread contends on.
+class WorkStealingPool {
+public:
+    WorkStealingPool();
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    void start(int threadCount); // 0 uses every hardware thread
+    void stop();                 // Finishes running jobs, drops queued ones
+
+    bool submit(std::function<void()> job);
+    // Block until every submitted job, including those submitted by jobs,
+    // has finished. Must not be called from a job.
+    void wait();
+
+    bool isRunning() const { return !workers_.empty(); }
+    int threadCount() const { return static_cast<int>(workers_.size()); }
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+        std::thread thread;
+    };
+
+    bool takeJob(int index, std::function<void()>& job);
+    void finishJob();
+    void workerLoop(int index);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> queued_;     // Jobs waiting in any deque
+    std::atomic<size_t> unfinished_; // Jobs queued or running
+    std::atomic<unsigned> next_worker_;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::atomic<bool> stopping_;
+};
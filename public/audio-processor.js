@@ -43,26 +43,22 @@ class DJAudioProcessor extends AudioWorkletProcessor {
         break;
       case 'SET_DECK_VOLUME':
         if (this.wasmInstance) {
-          const deck = data.deck === 1 ? 'deck1' : 'deck2';
-          this.wasmInstance[`_set_${deck}_volume`](data.value);
+          this.callDeckSetter('volume', data.deck, data.value);
         }
         break;
       case 'SET_DECK_PITCH':
         if (this.wasmInstance) {
-          const deck = data.deck === 1 ? 'deck1' : 'deck2';
-          this.wasmInstance[`_set_${deck}_pitch`](data.value);
+          this.callDeckSetter('pitch', data.deck, data.value);
         }
         break;
       case 'SET_DECK_EQ':
         if (this.wasmInstance) {
-          const deck = data.deck === 1 ? 'deck1' : 'deck2';
-          this.wasmInstance[`_set_${deck}_eq`](data.band, data.value);
+          this.callDeckSetter('eq', data.deck, data.band, data.value);
         }
         break;
       case 'SET_DECK_EFFECT':
         if (this.wasmInstance) {
-          const deck = data.deck === 1 ? 'deck1' : 'deck2';
-          this.wasmInstance[`_set_${deck}_effect`](data.effect, data.enabled);
+          this.callDeckSetter('effect', data.deck, data.effect, data.enabled);
         }
         break;
       case 'SET_CROSSFADER':
@@ -87,6 +83,20 @@ class DJAudioProcessor extends AudioWorkletProcessor {
     }
   }
   
+  // Call the deck-indexed setter set_deck_<name>(deck, ...), or the
+  // set_deck1_<name>/set_deck2_<name> exports of a module built before it
+  callDeckSetter(name, deck, ...args) {
+    const indexed = this.wasmInstance[`_set_deck_${name}`];
+    if (typeof indexed === 'function') {
+      indexed(deck, ...args);
+      return;
+    }
+    const perDeck = this.wasmInstance[`_set_deck${deck}_${name}`];
+    if (typeof perDeck === 'function') {
+      perDeck(...args);
+    }
+  }
+  
   async loadWasmModule(wasmBytes, wasmJsCode) {
     try {
       // Execute the Emscripten JS code in the worklet's global scope